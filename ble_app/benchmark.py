@@ -0,0 +1,452 @@
+"""Headless throughput benchmark of the LCS peripheral.
+
+Each run subscribes to the throughput stream for a fixed time, drops the
+warm-up at its start and reports the rate, its percentiles over fixed windows,
+loss, duplicates, reordering and one-way delay percentiles (see
+stream_analyzer.py). Results go to stdout and optionally to CSV and JSON.
+
+Runs are given on the command line or as a JSON list of objects with the same
+fields (name, duration, warmup, phy, tx_power, mtu, interval_ms, conn_mode):
+
+    python benchmark.py --transport mock --duration 10 --phy 2M --json out.json
+    python benchmark.py --runs runs.json --csv results.csv --min-kbps 1000
+
+Transports:
+
+- ble: a peripheral in range, through simplepyble. TX power and the
+  connection parameter mode are written to the LCS; PHY, MTU and interval are
+  chosen by the central's Bluetooth stack and only reported.
+- mock: no radio, a model of the link that streams packets at the rate the
+  PHY, MTU and interval allow, with optional random loss.
+- bsim: a BabbleSim simulation of the peripheral and an HCI UART controller
+  attached to this host with btattach, then measured like ble.
+
+The exit code is 1 if any run is below --min-kbps or loses more than
+--max-loss percent of its packets, so a CI job fails on a regression.
+"""
+import argparse
+import csv
+import json
+import os
+import random
+import re
+import struct
+import subprocess
+import sys
+import threading
+import time
+
+from stream_analyzer import StreamAnalyzer, build_packet
+
+DEVICE_NAME = "LCS Peripheral"
+SERVICE_UUID = "430ebad0-5c25-469e-a162-a1c9dc50a8fd"
+TX_POWER_CHAR_UUID = "430ebad1-5c25-469e-a162-a1c9dc50a8fd"
+THROUGHPUT_CHAR_UUID = "430ebad3-5c25-469e-a162-a1c9dc50a8fd"
+PHY_STATE_CHAR_UUID = "430ebad7-5c25-469e-a162-a1c9dc50a8fd"
+CONN_PARAMS_CHAR_UUID = "430ebad8-5c25-469e-a162-a1c9dc50a8fd"
+THROUGHPUT_STATS_CHAR_UUID = "430ebadb-5c25-469e-a162-a1c9dc50a8fd"
+
+PHY_STATE = struct.Struct("<BBBBbB")
+CONN_PARAMS_STATE = struct.Struct("<BBIHH")
+THROUGHPUT_STATS = struct.Struct("<B9I12I")
+
+CONN_MODES = ["manual", "throughput", "low_power"]
+# BT_GAP_LE_PHY_* as notified in the PHY state
+PHY_NAMES = {1: "1M", 2: "2M", 4: "coded"}
+
+RUN_DEFAULTS = {
+    "name": None,
+    "duration": 10.0,
+    "warmup": 2.0,
+    "phy": "2M",
+    "tx_power": 0,
+    "mtu": 247,
+    "interval_ms": 7.5,
+    "conn_mode": None,
+}
+
+PERCENTILES = (5, 50, 95)
+DELAY_PERCENTILES = (50, 95, 99)
+
+
+def percentile(values, p):
+    """Nearest-rank percentile, None for an empty list."""
+    if not values:
+        return None
+    ordered = sorted(values)
+    rank = max(0, min(len(ordered) - 1, round(p / 100 * len(ordered) + 0.5) - 1))
+    return ordered[rank]
+
+
+class MockTransport:
+    """Streams packets at the rate a link with the run's parameters allows."""
+
+    # Symbol rate of each PHY in bits per microsecond
+    PHY_RATES = {"1M": 1.0, "2M": 2.0, "S2": 0.5, "S8": 0.125}
+    # Preamble, access address and CRC in bytes, and the coded PHY's FEC block 1
+    PHY_OVERHEAD = {"1M": 8, "2M": 9, "S2": 7, "S8": 7}
+    CODED_HEADER_US = {"S2": 336, "S8": 336}
+    T_IFS_US = 150
+    # LL header, L2CAP header and ATT opcode and handle
+    PDU_OVERHEAD = 2 + 4 + 3
+
+    def __init__(self, loss=0.0, seed=None):
+        self.loss = loss
+        self.random = random.Random(seed)
+        self.thread = None
+        self.stop_event = threading.Event()
+
+    def open(self):
+        pass
+
+    def close(self):
+        self.stop()
+
+    def _air_time_us(self, phy, length):
+        return (self.CODED_HEADER_US.get(phy, 0) +
+                (self.PHY_OVERHEAD[phy] + length) * 8 / self.PHY_RATES[phy])
+
+    def configure(self, run):
+        phy = run["phy"] if run["phy"] in self.PHY_RATES else "1M"
+        self.payload_len = run["mtu"] - 3
+        self.interval_us = run["interval_ms"] * 1000
+
+        # A data packet and the empty acknowledgement, each followed by T_IFS
+        pair_us = (self._air_time_us(phy, self.payload_len + self.PDU_OVERHEAD) +
+                   self._air_time_us(phy, 2) + 2 * self.T_IFS_US)
+        self.per_event = max(1, int(self.interval_us // pair_us))
+        self.pair_us = pair_us
+        return {"phy": phy, "mtu": run["mtu"], "interval_ms": run["interval_ms"]}
+
+    def start(self, on_packet):
+        self.stop_event.clear()
+        self.thread = threading.Thread(target=self._stream, args=(on_packet,), daemon=True)
+        self.thread.start()
+
+    def _stream(self, on_packet):
+        seq = 0
+        next_event = time.monotonic()
+        while not self.stop_event.is_set():
+            for i in range(self.per_event):
+                packet = build_packet(seq, self.payload_len)
+                seq += 1
+                if self.random.random() < self.loss:
+                    continue
+                # Received at the end of its slot within the event
+                on_packet(packet, time.monotonic_ns() // 1000 + int((i + 1) * self.pair_us))
+            next_event += self.interval_us / 1e6
+            time.sleep(max(0.0, next_event - time.monotonic()))
+
+    def stop(self):
+        self.stop_event.set()
+        if self.thread:
+            self.thread.join()
+            self.thread = None
+
+    def device_stats(self):
+        return None
+
+
+class BleTransport:
+    def __init__(self, name=DEVICE_NAME, adapter_index=0):
+        self.name = name
+        self.adapter_index = adapter_index
+        self.peripheral = None
+
+    def _adapter(self):
+        import simplepyble
+
+        adapters = simplepyble.Adapter.get_adapters()
+        if len(adapters) <= self.adapter_index:
+            raise RuntimeError("Bluetooth adapter not found")
+        return adapters[self.adapter_index]
+
+    def open(self):
+        adapter = self._adapter()
+        adapter.scan_for(2500)
+        for peripheral in adapter.scan_get_results():
+            if peripheral.identifier() == self.name:
+                peripheral.connect()
+                self.peripheral = peripheral
+                return
+        raise RuntimeError(f"Device '{self.name}' not found")
+
+    def close(self):
+        if self.peripheral and self.peripheral.is_connected():
+            self.peripheral.disconnect()
+
+    def _read(self, uuid):
+        try:
+            return bytes(self.peripheral.read(SERVICE_UUID, uuid))
+        except Exception:
+            return None
+
+    def configure(self, run):
+        p = self.peripheral
+        p.write_request(SERVICE_UUID, TX_POWER_CHAR_UUID, struct.pack("<b", run["tx_power"]))
+        if run["conn_mode"]:
+            p.write_request(SERVICE_UUID, CONN_PARAMS_CHAR_UUID,
+                            bytes([CONN_MODES.index(run["conn_mode"])]))
+            # Give the central time to accept the new parameters
+            time.sleep(1.0)
+        try:
+            p.write_request(SERVICE_UUID, THROUGHPUT_STATS_CHAR_UUID, b"\x00")
+        except Exception:
+            pass
+
+        applied = {"phy": None, "mtu": p.mtu(), "interval_ms": None}
+        data = self._read(PHY_STATE_CHAR_UUID)
+        if data:
+            _, phy, coded_s8, _, _, _ = PHY_STATE.unpack_from(data)
+            applied["phy"] = ("S8" if coded_s8 else "S2") if phy == 4 else PHY_NAMES.get(phy)
+        data = self._read(CONN_PARAMS_CHAR_UUID)
+        if data:
+            applied["interval_ms"] = CONN_PARAMS_STATE.unpack_from(data)[2] / 1000
+        return applied
+
+    def start(self, on_packet):
+        self.peripheral.notify(SERVICE_UUID, THROUGHPUT_CHAR_UUID,
+                               lambda data: on_packet(bytes(data), None))
+
+    def stop(self):
+        self.peripheral.unsubscribe(SERVICE_UUID, THROUGHPUT_CHAR_UUID)
+
+    def device_stats(self):
+        data = self._read(THROUGHPUT_STATS_CHAR_UUID)
+        if not data:
+            return None
+        fields = THROUGHPUT_STATS.unpack(data)
+        keys = ["link_index", "duration_ms", "bytes_queued", "packets_queued",
+                "bytes_completed", "packets_completed", "nomem_stalls", "errors",
+                "latency_avg_us", "latency_max_us"]
+        stats = dict(zip(keys, fields))
+        stats["latency_hist"] = list(fields[len(keys):])
+        return stats
+
+
+class BsimTransport(BleTransport):
+    """Peripheral and controller in BabbleSim, the controller on a host HCI.
+
+    The peripheral is the nrf52_bsim build of this repository, the controller
+    Zephyr's hci_uart sample for nrf52_bsim. Its UART is a pseudoterminal,
+    which btattach turns into a new adapter of the host's Bluetooth stack.
+    Needs BSIM_OUT_PATH and permission to run btattach.
+    """
+
+    def __init__(self, peripheral_exe, hci_exe, sim_id="lcs_benchmark", extra_args=()):
+        super().__init__()
+        self.peripheral_exe = peripheral_exe
+        self.hci_exe = hci_exe
+        self.sim_id = sim_id
+        self.extra_args = list(extra_args)
+        self.processes = []
+
+    def _spawn(self, args, **kwargs):
+        process = subprocess.Popen(args, **kwargs)
+        self.processes.append(process)
+        return process
+
+    def open(self):
+        import simplepyble
+
+        bin_dir = os.path.join(os.environ["BSIM_OUT_PATH"], "bin")
+        self._spawn([os.path.join(bin_dir, "bs_2G4_phy_v1"), f"-s={self.sim_id}", "-D=2"],
+                    cwd=bin_dir)
+        self._spawn([self.peripheral_exe, f"-s={self.sim_id}", "-d=0"] + self.extra_args)
+        hci = self._spawn([self.hci_exe, f"-s={self.sim_id}", "-d=1", "-uart0_pty"] +
+                          self.extra_args, stdout=subprocess.PIPE, text=True)
+
+        pty = None
+        for line in hci.stdout:
+            match = re.search(r"(/dev/pts/\d+)", line)
+            if match:
+                pty = match.group(1)
+                break
+        if not pty:
+            raise RuntimeError("HCI UART pseudoterminal not found")
+        threading.Thread(target=hci.stdout.read, daemon=True).start()
+
+        before = len(simplepyble.Adapter.get_adapters())
+        self._spawn(["btattach", "-B", pty, "-P", "h4", "-S", "1000000"])
+        deadline = time.monotonic() + 10
+        while len(simplepyble.Adapter.get_adapters()) == before:
+            if time.monotonic() > deadline:
+                raise RuntimeError("btattach did not add an adapter")
+            time.sleep(0.2)
+        self.adapter_index = before
+        super().open()
+
+    def close(self):
+        try:
+            super().close()
+        finally:
+            for process in reversed(self.processes):
+                process.terminate()
+                process.wait()
+            self.processes = []
+
+
+def measure(transport, run, window_s):
+    """Run one benchmark and return its result as a flat dict."""
+    applied = transport.configure(run)
+    analyzer = StreamAnalyzer(keep_delays=True)
+    windows = []
+    lock = threading.Lock()
+    state = {"measuring": False, "window_start": None, "window_bytes": 0,
+             "bytes": 0, "first": None, "last": None}
+
+    def on_packet(packet, arrival_us):
+        now = time.monotonic()
+        with lock:
+            if not state["measuring"]:
+                return
+            analyzer.update(packet, arrival_us)
+            state["bytes"] += len(packet)
+            state["first"] = state["first"] or now
+            state["last"] = now
+            if state["window_start"] is None:
+                state["window_start"] = now
+            elif now - state["window_start"] >= window_s:
+                windows.append(state["window_bytes"] * 8 / (now - state["window_start"]) / 1000)
+                state["window_start"] = now
+                state["window_bytes"] = 0
+            state["window_bytes"] += len(packet)
+
+    transport.start(on_packet)
+    try:
+        time.sleep(run["warmup"])
+        with lock:
+            state["measuring"] = True
+        time.sleep(run["duration"])
+        with lock:
+            state["measuring"] = False
+    finally:
+        transport.stop()
+
+    elapsed = (state["last"] - state["first"]) if state["first"] else 0
+    delays = analyzer.delays_us() if analyzer.received else []
+    sent = analyzer.received + analyzer.lost
+    result = {key: run[key] for key in RUN_DEFAULTS}
+    result.update({f"applied_{key}": value for key, value in applied.items()})
+    result.update({
+        "packets": analyzer.received,
+        "bytes": state["bytes"],
+        "kbps": state["bytes"] * 8 / elapsed / 1000 if elapsed else 0.0,
+        "lost": analyzer.lost,
+        "loss_pct": 100 * analyzer.lost / sent if sent else 0.0,
+        "gaps": analyzer.gaps,
+        "duplicates": analyzer.duplicates,
+        "reordered": analyzer.reordered,
+        "bad": analyzer.bad,
+        "jitter_ms": analyzer.jitter / 1000,
+    })
+    for p in PERCENTILES:
+        result[f"kbps_p{p}"] = percentile(windows, p)
+    for p in DELAY_PERCENTILES:
+        delay = percentile(delays, p)
+        result[f"delay_p{p}_ms"] = delay / 1000 if delay is not None else None
+    return result
+
+
+def load_runs(args):
+    if args.runs:
+        with open(args.runs) as f:
+            specs = json.load(f)
+    else:
+        specs = [{key: getattr(args, key) for key in RUN_DEFAULTS if getattr(args, key) is not None}]
+
+    runs = []
+    for i, spec in enumerate(specs):
+        unknown = set(spec) - set(RUN_DEFAULTS)
+        if unknown:
+            sys.exit(f"Run {i}: unknown fields {', '.join(sorted(unknown))}")
+        run = dict(RUN_DEFAULTS, **spec)
+        if run["conn_mode"] and run["conn_mode"] not in CONN_MODES:
+            sys.exit(f"Run {i}: conn_mode must be one of {', '.join(CONN_MODES)}")
+        run["name"] = run["name"] or f"run{i}"
+        runs.append(run)
+    return runs
+
+
+def make_transport(args):
+    if args.transport == "mock":
+        return MockTransport(loss=args.mock_loss / 100, seed=args.seed)
+    if args.transport == "bsim":
+        if not args.bsim_peripheral or not args.bsim_hci:
+            sys.exit("--bsim-peripheral and --bsim-hci are required")
+        return BsimTransport(args.bsim_peripheral, args.bsim_hci,
+                             extra_args=args.bsim_arg or [])
+    return BleTransport(args.device, args.adapter)
+
+
+def write_results(results, args):
+    if args.csv and results:
+        # Device counters are nested, they only go to the JSON output
+        rows = [{k: v for k, v in r.items() if k != "device"} for r in results]
+        with open(args.csv, "w", newline="") as f:
+            writer = csv.DictWriter(f, fieldnames=list(rows[0]))
+            writer.writeheader()
+            writer.writerows(rows)
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump(results, f, indent=2)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--transport", choices=["ble", "mock", "bsim"], default="ble")
+    parser.add_argument("--runs", help="JSON file with a list of runs")
+    parser.add_argument("--name", dest="name", default=None, help="name of the run")
+    parser.add_argument("--duration", type=float, help="measured seconds per run")
+    parser.add_argument("--warmup", type=float, help="seconds dropped before measuring")
+    parser.add_argument("--phy", choices=["1M", "2M", "S2", "S8"])
+    parser.add_argument("--tx-power", dest="tx_power", type=int, help="dBm")
+    parser.add_argument("--mtu", type=int)
+    parser.add_argument("--interval-ms", dest="interval_ms", type=float)
+    parser.add_argument("--conn-mode", dest="conn_mode", choices=CONN_MODES)
+    parser.add_argument("--window", type=float, default=1.0,
+                        help="seconds per rate sample for the percentiles")
+    parser.add_argument("--csv", help="write one row per run")
+    parser.add_argument("--json", help="write a list of results")
+    parser.add_argument("--min-kbps", type=float, help="fail if a run is slower")
+    parser.add_argument("--max-loss", type=float, help="fail if a run loses more, in percent")
+    parser.add_argument("--device", default=DEVICE_NAME, help="advertised name (ble)")
+    parser.add_argument("--adapter", type=int, default=0, help="adapter index (ble)")
+    parser.add_argument("--mock-loss", type=float, default=0.0, help="percent (mock)")
+    parser.add_argument("--seed", type=int, help="random seed (mock)")
+    parser.add_argument("--bsim-peripheral", help="peripheral nrf52_bsim executable (bsim)")
+    parser.add_argument("--bsim-hci", help="hci_uart nrf52_bsim executable (bsim)")
+    parser.add_argument("--bsim-arg", action="append", help="extra argument to both devices")
+    args = parser.parse_args()
+
+    runs = load_runs(args)
+    transport = make_transport(args)
+    results = []
+    failed = False
+
+    transport.open()
+    try:
+        for run in runs:
+            result = measure(transport, run, args.window)
+            result["device"] = transport.device_stats()
+            results.append(result)
+
+            ok = ((args.min_kbps is None or result["kbps"] >= args.min_kbps) and
+                  (args.max_loss is None or result["loss_pct"] <= args.max_loss))
+            failed |= not ok
+            print(f"{run['name']}: {result['kbps']:.1f} kbps "
+                  f"(p5 {result['kbps_p5'] or 0:.1f}, p95 {result['kbps_p95'] or 0:.1f}), "
+                  f"lost {result['lost']}, dup {result['duplicates']}, "
+                  f"reordered {result['reordered']}, bad {result['bad']}, "
+                  f"delay p95 {result['delay_p95_ms'] or 0:.2f} ms"
+                  f"{'' if ok else '  FAIL'}")
+    finally:
+        transport.close()
+
+    write_results(results, args)
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,95 @@
+"""Decode binary log files written by the LCS_LOG_BACKEND_BIN backend.
+
+Each file is a sequence of chunks: a little endian {magic, length} header,
+length bytes of dictionary log messages, then 0xff padding up to the littlefs
+program size. The messages are handed to Zephyr's dictionary log parser
+together with the log_dictionary.json of the build that wrote them.
+
+    python decode_logs.py build/zephyr/log_dictionary.json blog.0000 blog.0001
+"""
+import argparse
+import os
+import struct
+import subprocess
+import sys
+import tempfile
+
+CHUNK_MAGIC = 0x4C42
+CHUNK_HEADER = struct.Struct("<HH")
+
+
+def file_index(path):
+    """Order files by the number after 'blog.'."""
+    suffix = os.path.basename(path).rpartition(".")[2]
+    return int(suffix) if suffix.isdigit() else -1
+
+
+def read_chunks(data, align):
+    """Yield the message payload of every complete chunk in data."""
+    offset = 0
+    while offset + CHUNK_HEADER.size <= len(data):
+        magic, length = CHUNK_HEADER.unpack_from(data, offset)
+        if magic != CHUNK_MAGIC:
+            # Erased flash or a torn write, nothing valid follows
+            break
+
+        start = offset + CHUNK_HEADER.size
+        if start + length > len(data):
+            break
+
+        yield data[start:start + length]
+        offset += -(-(CHUNK_HEADER.size + length) // align) * align
+
+
+def extract(paths, align):
+    messages = bytearray()
+    for path in sorted(paths, key=file_index):
+        with open(path, "rb") as f:
+            data = f.read()
+
+        chunks = list(read_chunks(data, align))
+        print(f"{path}: {len(chunks)} chunks, {sum(map(len, chunks))} bytes",
+              file=sys.stderr)
+        for chunk in chunks:
+            messages += chunk
+    return bytes(messages)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("database", help="log_dictionary.json of the build")
+    parser.add_argument("files", nargs="+", help="blog.XXXX files, in any order")
+    parser.add_argument("--align", type=int, default=16,
+                        help="littlefs prog-size the files were written with")
+    parser.add_argument("--zephyr-base", default=os.environ.get("ZEPHYR_BASE"),
+                        help="Zephyr tree providing the dictionary log parser")
+    parser.add_argument("--raw", metavar="FILE",
+                        help="only write the extracted messages to FILE")
+    args = parser.parse_args()
+
+    messages = extract(args.files, args.align)
+
+    if args.raw:
+        with open(args.raw, "wb") as f:
+            f.write(messages)
+        return
+
+    if not args.zephyr_base:
+        sys.exit("Set ZEPHYR_BASE or pass --zephyr-base")
+
+    log_parser = os.path.join(args.zephyr_base, "scripts", "logging", "dictionary",
+                              "log_parser.py")
+
+    with tempfile.NamedTemporaryFile(suffix=".bin", delete=False) as f:
+        f.write(messages)
+        raw_path = f.name
+
+    try:
+        subprocess.run([sys.executable, log_parser, args.database, raw_path], check=True)
+    finally:
+        os.unlink(raw_path)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,259 @@
+"""Download log files and telemetry over the LCS log transfer characteristics.
+
+The control point takes {op, offset, ...} and streams the requested object as
+{offset, payload, crc16} notifications on the data characteristic. Every chunk
+is checked against its CRC and expected offset; on a bad chunk, a stall or a
+reconnect the object is requested again from the last good offset, and files
+already partly on disk are resumed rather than downloaded again.
+
+    python download_logs.py --out logs
+    python download_logs.py --telemetry --start-ms 0 --end-ms 600000 --out logs
+"""
+import argparse
+import os
+import queue
+import struct
+import sys
+import time
+
+DEVICE_NAME = "LCS Peripheral"
+SERVICE_UUID = "430ebad0-5c25-469e-a162-a1c9dc50a8fd"
+CP_CHAR_UUID = "430ebad9-5c25-469e-a162-a1c9dc50a8fd"
+DATA_CHAR_UUID = "430ebada-5c25-469e-a162-a1c9dc50a8fd"
+
+OP_LIST = 0x01
+OP_FILE = 0x02
+OP_TELEMETRY = 0x03
+OP_ABORT = 0x04
+
+RSP_START = 0x80
+RSP_DONE = 0x81
+
+ECANCELED = 125
+SIZE_UNKNOWN = 0xFFFFFFFF
+
+RSP = struct.Struct("<BBbI")
+CHUNK_HEADER = struct.Struct("<I")
+CRC = struct.Struct("<H")
+
+TELEMETRY_RECORD = struct.Struct("<IIBBbbBBHHHHH")
+TELEMETRY_TYPES = ["conn", "disc", "sample", "txpwr", "phy", "params"]
+TELEMETRY_HEADER = ("seq,time_ms,type,conn,rssi,tx_power,phy,reason,interval,"
+                    "latency,events,rx_packets,crc_errors")
+
+
+def crc16_ccitt(data, seed=0xFFFF):
+    """Same as Zephyr's crc16_ccitt(): reflected polynomial 0x1021."""
+    crc = seed
+    for byte in data:
+        e = (crc ^ byte) & 0xFF
+        f = (e ^ (e << 4)) & 0xFF
+        crc = (crc >> 8) ^ (f << 8) ^ (f << 3) ^ (f >> 4)
+    return crc & 0xFFFF
+
+
+class TransferError(Exception):
+    pass
+
+
+class LogTransfer:
+    def __init__(self, peripheral, timeout=5.0, retries=10):
+        self.peripheral = peripheral
+        self.timeout = timeout
+        self.retries = retries
+        self.events = queue.Queue()
+
+        peripheral.notify(SERVICE_UUID, CP_CHAR_UUID,
+                          lambda data: self.events.put(("cp", bytes(data))))
+        peripheral.notify(SERVICE_UUID, DATA_CHAR_UUID,
+                          lambda data: self.events.put(("data", bytes(data))))
+
+    def close(self):
+        try:
+            self.peripheral.write_request(SERVICE_UUID, CP_CHAR_UUID, bytes([OP_ABORT]))
+            self.peripheral.unsubscribe(SERVICE_UUID, CP_CHAR_UUID)
+            self.peripheral.unsubscribe(SERVICE_UUID, DATA_CHAR_UUID)
+        except Exception:
+            pass
+
+    def _request(self, op, offset, args):
+        # Drop everything left from the previous request
+        while not self.events.empty():
+            self.events.get_nowait()
+        self.peripheral.write_request(SERVICE_UUID, CP_CHAR_UUID,
+                                      struct.pack("<BI", op, offset) + args)
+
+    def fetch(self, op, args=b"", data=None, progress=None):
+        """Return the whole object, appending to data if it holds a prefix.
+
+        data is extended in place, so after an error it holds what was received.
+        """
+        data = bytearray() if data is None else data
+        retries = self.retries
+
+        while True:
+            self._request(op, len(data), args)
+            started = False
+            size = SIZE_UNKNOWN
+            restart = False
+
+            while not restart:
+                try:
+                    kind, payload = self.events.get(timeout=self.timeout)
+                except queue.Empty:
+                    print(f"\nStalled at offset {len(data)}", file=sys.stderr)
+                    restart = True
+                    break
+
+                if kind == "cp":
+                    rsp, rsp_op, status, value = RSP.unpack_from(payload)
+                    if rsp_op != op:
+                        continue
+                    if rsp == RSP_START:
+                        started = status == 0
+                        size = value
+                        if status:
+                            raise TransferError(f"start failed: {status}")
+                    elif rsp == RSP_DONE:
+                        if status not in (0, -ECANCELED):
+                            raise TransferError(f"transfer failed at {value}: {status}")
+                        if started and status == 0 and value == len(data):
+                            return bytes(data)
+                        # Chunks went missing or a stale transfer ended
+                        restart = started
+                    continue
+
+                if not started:
+                    continue
+
+                body, (crc,) = payload[:-CRC.size], CRC.unpack_from(payload, len(payload) - CRC.size)
+                (offset,) = CHUNK_HEADER.unpack_from(body)
+                if crc16_ccitt(body) != crc:
+                    print(f"\nBad CRC at offset {offset}", file=sys.stderr)
+                    restart = True
+                elif offset != len(data):
+                    print(f"\nExpected offset {len(data)}, got {offset}", file=sys.stderr)
+                    restart = True
+                else:
+                    data += body[CHUNK_HEADER.size:]
+                    if progress:
+                        progress(len(data), size)
+
+            retries -= 1
+            if retries < 0:
+                raise TransferError(f"giving up at offset {len(data)}")
+
+    def list_files(self):
+        listing = self.fetch(OP_LIST).decode()
+        files = []
+        for line in listing.splitlines():
+            name, _, size = line.rpartition(" ")
+            files.append((name, int(size)))
+        return files
+
+
+def print_progress(done, size):
+    total = f"/{size}" if size != SIZE_UNKNOWN else ""
+    print(f"\r  {done}{total} bytes", end="", flush=True)
+
+
+def download_files(transfer, out_dir):
+    files = transfer.list_files()
+    print(f"{len(files)} files")
+
+    for name, size in files:
+        path = os.path.join(out_dir, name)
+        partial = b""
+        if os.path.exists(path):
+            with open(path, "rb") as f:
+                partial = f.read()
+            if len(partial) >= size:
+                print(f"{name}: up to date")
+                continue
+
+        print(f"{name}: {size} bytes, resuming at {len(partial)}")
+        start = time.time()
+        data = bytearray(partial)
+        try:
+            transfer.fetch(OP_FILE, name.encode(), data, print_progress)
+        finally:
+            # Keep what arrived so an interrupted download can be resumed
+            with open(path, "ab") as f:
+                f.write(data[len(partial):])
+        elapsed = time.time() - start
+        print(f"\n  {(len(data) - len(partial)) * 8 / elapsed / 1000:.1f} kbps")
+
+
+def download_telemetry(transfer, out_dir, start_ms, end_ms):
+    data = transfer.fetch(OP_TELEMETRY, struct.pack("<II", start_ms, end_ms),
+                          progress=print_progress)
+    print()
+
+    with open(os.path.join(out_dir, "telemetry.bin"), "wb") as f:
+        f.write(data)
+
+    with open(os.path.join(out_dir, "telemetry.csv"), "w") as f:
+        print(TELEMETRY_HEADER, file=f)
+        for record in TELEMETRY_RECORD.iter_unpack(data):
+            fields = list(record)
+            fields[2] = TELEMETRY_TYPES[fields[2]] if fields[2] < len(TELEMETRY_TYPES) else "?"
+            print(",".join(map(str, fields)), file=f)
+
+    print(f"{len(data) // TELEMETRY_RECORD.size} telemetry records")
+
+
+def connect(name):
+    # Imported here so the packet helpers work without a Bluetooth stack
+    import simplepyble
+
+    adapters = simplepyble.Adapter.get_adapters()
+    if not adapters:
+        sys.exit("No Bluetooth adapters found.")
+
+    adapter = adapters[0]
+    print(f"Scanning for '{name}' on {adapter.identifier()}...")
+    adapter.scan_for(2500)
+    for peripheral in adapter.scan_get_results():
+        if peripheral.identifier() == name:
+            peripheral.connect()
+            print(f"Connected, MTU {peripheral.mtu()}")
+            return peripheral
+
+    sys.exit(f"Device '{name}' not found.")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--name", default=DEVICE_NAME, help="advertised device name")
+    parser.add_argument("--out", default=".", help="directory to store the downloads in")
+    parser.add_argument("--telemetry", action="store_true",
+                        help="download telemetry records instead of log files")
+    parser.add_argument("--start-ms", type=int, default=0,
+                        help="oldest telemetry timestamp to download")
+    parser.add_argument("--end-ms", type=int, default=0,
+                        help="newest telemetry timestamp to download, 0 for all")
+    parser.add_argument("--timeout", type=float, default=5.0,
+                        help="seconds without data before resuming")
+    args = parser.parse_args()
+
+    os.makedirs(args.out, exist_ok=True)
+    peripheral = connect(args.name)
+    transfer = LogTransfer(peripheral, timeout=args.timeout)
+
+    try:
+        if args.telemetry:
+            download_telemetry(transfer, args.out, args.start_ms, args.end_ms)
+        else:
+            download_files(transfer, args.out)
+    except TransferError as e:
+        sys.exit(f"\nDownload failed: {e}")
+    except KeyboardInterrupt:
+        print("\nInterrupted, run again to resume")
+    finally:
+        transfer.close()
+        peripheral.disconnect()
+
+
+if __name__ == "__main__":
+    main()
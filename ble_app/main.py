@@ -1,17 +1,26 @@
+import argparse
 import simplepyble
+import struct
+import threading
 import time
 from datetime import datetime
 from collections import deque
 
+from stream_analyzer import StreamAnalyzer, build_packet
+
 # Constants
 DEVICE_NAME = "LCS Peripheral"
 TARGET_SERVICE_UUID = "430ebad0-5c25-469e-a162-a1c9dc50a8fd"      # Service UUID
 TARGET_CHAR_UUID = "430ebad3-5c25-469e-a162-a1c9dc50a8fd"         # Characteristic UUID
+RSSI_HISTORY_CHAR_UUID = "430ebad5-5c25-469e-a162-a1c9dc50a8fd"   # RSSI history characteristic
+THROUGHPUT_STATS_CHAR_UUID = "430ebadb-5c25-469e-a162-a1c9dc50a8fd"  # Device side throughput statistics
+THROUGHPUT_RX_STATS_CHAR_UUID = "430ebadc-5c25-469e-a162-a1c9dc50a8fd"  # Data received by the device
 GATT_SERVICE_UUID = "00001801-0000-1000-8000-00805f9b34fb"        # Generic Attribute Service
 SERVICE_CHANGED_CHAR_UUID = "00002a05-0000-1000-8000-00805f9b34fb"  # Service Changed characteristic
 
 class ThroughputCalculator:
-    def __init__(self, window_size=1.0, average_window=10):
+    def __init__(self, window_size=1.0, average_window=10, analyzer=None):
+        self.analyzer = analyzer
         self.window_size = window_size
         self.bytes_in_window = 0
         self.packets_in_window = 0
@@ -67,6 +76,83 @@ class ThroughputCalculator:
         print(f"  {self.total_bytes / 1024:.2f} KB")
         print(f"  {self.total_packets} packets")
         print(f"  Running time: {total_time:.1f} seconds")
+        if self.analyzer:
+            self.analyzer.print_statistics()
+
+RSSI_HISTORY_HEADER = struct.Struct("<IHBb")
+
+def decode_rssi_history(data):
+    """Decode one RSSI history batch into a list of (timestamp_ms, rssi)."""
+    timestamp_ms, period_ms, count, rssi = RSSI_HISTORY_HEADER.unpack_from(data)
+    deltas = struct.unpack_from(f"<{count - 1}b", data, RSSI_HISTORY_HEADER.size)
+
+    samples = [(timestamp_ms, rssi)]
+    for i, delta in enumerate(deltas, start=1):
+        rssi += delta
+        samples.append((timestamp_ms + i * period_ms, rssi))
+    return samples
+
+THROUGHPUT_STATS = struct.Struct("<B9I12I")
+
+def print_device_stats(peripheral):
+    """Print the peripheral's own counters next to the ones measured here."""
+    try:
+        data = bytes(peripheral.read(TARGET_SERVICE_UUID, THROUGHPUT_STATS_CHAR_UUID))
+    except Exception as e:
+        print(f"Device statistics not available: {str(e)}")
+        return
+
+    (link, duration_ms, bytes_queued, packets_queued, bytes_completed, packets_completed,
+     nomem_stalls, errors, latency_avg_us, latency_max_us, *hist) = THROUGHPUT_STATS.unpack(data)
+    print(f"\nDevice statistics (link {link}, {duration_ms} ms):")
+    print(f"  Queued:    {packets_queued} packets, {bytes_queued} bytes")
+    print(f"  Completed: {packets_completed} packets, {bytes_completed} bytes, "
+          f"{bytes_completed * 8 / max(duration_ms, 1):.2f} kbps")
+    print(f"  Buffer stalls: {nomem_stalls}, errors: {errors}")
+    print(f"  Completion latency: avg {latency_avg_us} us, max {latency_max_us} us")
+    bounds = ["<1"] + [f"<{1 << i}" for i in range(1, len(hist) - 1)] + [f">={1 << (len(hist) - 2)}"]
+    print("  " + ", ".join(f"{b} ms: {n}" for b, n in zip(bounds, hist) if n))
+
+THROUGHPUT_RX_STATS = struct.Struct("<BB8I")
+RX_PATHS = ["GATT writes", "L2CAP channel"]
+
+def print_device_rx_stats(peripheral):
+    """Print what the peripheral received on each path."""
+    try:
+        data = bytes(peripheral.read(TARGET_SERVICE_UUID, THROUGHPUT_RX_STATS_CHAR_UUID))
+    except Exception as e:
+        print(f"Device receive statistics not available: {str(e)}")
+        return
+
+    for fields in THROUGHPUT_RX_STATS.iter_unpack(data):
+        link, path, duration_ms, rx_bytes, packets, last_seq, gaps, lost, late, bad = fields
+        if not packets and not bad:
+            continue
+        print(f"\nDevice received over {RX_PATHS[path]} (link {link}, {duration_ms} ms):")
+        print(f"  {packets} packets, {rx_bytes} bytes, "
+              f"{rx_bytes * 8 / max(duration_ms, 1):.2f} kbps")
+        print(f"  Gaps: {gaps}, lost: {lost}, late: {late}, bad: {bad}, "
+              f"highest sequence number {last_seq}")
+
+def start_uplink(peripheral, stop, crc=False):
+    """Write throughput packets without response until stop is set."""
+    payload_len = peripheral.mtu() - 3
+
+    def writer():
+        sequence = 0
+        while not stop.is_set():
+            payload = build_packet(sequence, payload_len, crc)
+            try:
+                peripheral.write_command(TARGET_SERVICE_UUID, TARGET_CHAR_UUID, payload)
+            except Exception as e:
+                print(f"Uplink write failed: {str(e)}")
+                return
+            sequence += 1
+
+    thread = threading.Thread(target=writer, daemon=True)
+    thread.start()
+    print(f"Writing {payload_len} byte payloads to the peripheral")
+    return thread
 
 def explore_services(peripheral):
     print("\nExploring all services and characteristics:")
@@ -82,10 +168,12 @@ def explore_services(peripheral):
 
 def setup_notifications(peripheral):
     print("\nSetting up notifications...")
-    throughput_calc = ThroughputCalculator(window_size=0.1)  # 100ms windows
+    analyzer = StreamAnalyzer()
+    throughput_calc = ThroughputCalculator(window_size=0.1, analyzer=analyzer)  # 100ms windows
     
     def notification_handler(data):
         data_bytes = bytes(data)
+        analyzer.update(data_bytes)
         throughput_calc.update(len(data_bytes))
             
     try:
@@ -99,7 +187,31 @@ def setup_notifications(peripheral):
         print(f"Failed to subscribe: {str(e)}")
         raise
 
+    def rssi_history_handler(data):
+        samples = decode_rssi_history(bytes(data))
+        rssi_values = [rssi for _, rssi in samples]
+        print(f"\nRSSI history: {len(samples)} samples from {samples[0][0]} ms, "
+              f"min {min(rssi_values)} max {max(rssi_values)} dBm")
+
+    try:
+        peripheral.notify(
+            TARGET_SERVICE_UUID,
+            RSSI_HISTORY_CHAR_UUID,
+            rssi_history_handler
+        )
+        print("Subscribed to RSSI history")
+    except Exception as e:
+        print(f"RSSI history not available: {str(e)}")
+
 def main():
+    parser = argparse.ArgumentParser(description="LCS throughput test")
+    parser.add_argument("--uplink", action="store_true",
+                        help="also write to the throughput characteristic without response")
+    parser.add_argument("--crc", action="store_true",
+                        help="set the CRC of every packet written with --uplink")
+    args = parser.parse_args()
+    stop_uplink = threading.Event()
+
     try:
         # Get adapter
         adapters = simplepyble.Adapter.get_adapters()
@@ -133,6 +245,8 @@ def main():
 
         explore_services(target_peripheral)
         setup_notifications(target_peripheral)
+        if args.uplink:
+            start_uplink(target_peripheral, stop_uplink, args.crc)
         
         print("\nMonitoring throughput. Press Ctrl+C to exit...")
         while True:
@@ -140,12 +254,18 @@ def main():
 
     except KeyboardInterrupt:
         print("\nUser interrupted. Cleaning up...")
+        stop_uplink.set()
+        if 'target_peripheral' in locals() and target_peripheral.is_connected():
+            print_device_stats(target_peripheral)
+            print_device_rx_stats(target_peripheral)
     except Exception as e:
         print(f"An error occurred: {str(e)}")
     finally:
+        stop_uplink.set()
         if 'target_peripheral' in locals() and target_peripheral.is_connected():
             try:
                 target_peripheral.unsubscribe(TARGET_SERVICE_UUID, TARGET_CHAR_UUID)
+                target_peripheral.unsubscribe(TARGET_SERVICE_UUID, RSSI_HISTORY_CHAR_UUID)
             except:
                 pass
             target_peripheral.disconnect()
@@ -0,0 +1,130 @@
+"""Throughput packet format and a receiver side analyzer of the stream.
+
+Every throughput packet starts with {seq, timestamp_us, flags, crc16}, little
+endian, followed by a filler (struct throughput_pkt_hdr in
+lcs/include/throughput.h). timestamp_us is the sender's clock when it queued
+the packet. With the CRC flag set, the CRC-16-CCITT covers the header up to
+the CRC followed by the filler.
+
+The analyzer counts lost, duplicated, reordered and corrupted packets, and the
+one-way delay of each packet above the smallest seen. The two clocks are not
+synchronised, so the delay is relative and drifts slowly over long runs; the
+jitter (RFC 3550 interarrival jitter) is not affected by the offset.
+"""
+import struct
+import time
+
+from download_logs import crc16_ccitt
+
+PACKET_HEADER = struct.Struct("<IIHH")
+PACKET_CRC_LEN = 10
+FLAG_CRC = 0x0001
+
+# Sequence numbers further behind the highest one are no longer tracked
+REORDER_WINDOW = 4096
+
+
+def packet_crc(packet):
+    return crc16_ccitt(packet[PACKET_HEADER.size:], crc16_ccitt(packet[:PACKET_CRC_LEN]))
+
+
+def build_packet(seq, length, crc=False):
+    """Build a packet as the peripheral does, stamped with the local clock."""
+    timestamp_us = (time.monotonic_ns() // 1000) & 0xFFFFFFFF
+    filler = bytes(i & 0xFF for i in range(PACKET_HEADER.size, length))
+    packet = bytearray(PACKET_HEADER.pack(seq, timestamp_us, FLAG_CRC if crc else 0, 0) + filler)
+    if crc:
+        struct.pack_into("<H", packet, PACKET_CRC_LEN, packet_crc(packet))
+    return bytes(packet)
+
+
+class StreamAnalyzer:
+    def __init__(self, keep_delays=False):
+        # Transit time of every packet, for percentiles
+        self.transits = [] if keep_delays else None
+        self.highest = None
+        self.missing = set()
+        self.received = 0
+        self.gaps = 0
+        self.lost = 0
+        self.duplicates = 0
+        self.reordered = 0
+        self.bad = 0
+
+        self.last_timestamp = None
+        self.timestamp_wraps = 0
+        self.prev_transit = None
+        self.min_transit = None
+        self.max_delay = 0
+        self.delay_sum = 0
+        self.jitter = 0.0
+
+    def update(self, packet, arrival_us=None):
+        if arrival_us is None:
+            arrival_us = time.monotonic_ns() // 1000
+
+        if len(packet) < PACKET_HEADER.size:
+            self.bad += 1
+            return
+        seq, timestamp_us, flags, crc = PACKET_HEADER.unpack_from(packet)
+        if flags & FLAG_CRC and packet_crc(packet) != crc:
+            self.bad += 1
+            return
+
+        self.received += 1
+        self._update_sequence(seq)
+        self._update_delay(timestamp_us, arrival_us)
+
+    def _update_sequence(self, seq):
+        if self.highest is None:
+            self.highest = seq
+        elif seq > self.highest:
+            if seq != self.highest + 1:
+                self.gaps += 1
+                self.lost += seq - self.highest - 1
+                self.missing.update(range(max(self.highest + 1, seq - REORDER_WINDOW), seq))
+            self.highest = seq
+            if len(self.missing) > REORDER_WINDOW:
+                self.missing = {s for s in self.missing if s > seq - REORDER_WINDOW}
+        elif seq in self.missing:
+            self.missing.remove(seq)
+            self.reordered += 1
+            self.lost -= 1
+        else:
+            self.duplicates += 1
+
+    def _update_delay(self, timestamp_us, arrival_us):
+        # The sender's 32-bit microsecond clock wraps every 71 minutes
+        if self.last_timestamp is not None and timestamp_us < self.last_timestamp - (1 << 31):
+            self.timestamp_wraps += 1
+        self.last_timestamp = timestamp_us
+
+        transit = arrival_us - (timestamp_us + (self.timestamp_wraps << 32))
+        if self.min_transit is None or transit < self.min_transit:
+            # Every delay so far was measured against a larger minimum
+            if self.min_transit is not None:
+                self.delay_sum += (self.min_transit - transit) * (self.received - 1)
+                self.max_delay += self.min_transit - transit
+            self.min_transit = transit
+        delay = transit - self.min_transit
+        if self.transits is not None:
+            self.transits.append(transit)
+        self.delay_sum += delay
+        self.max_delay = max(self.max_delay, delay)
+
+        if self.prev_transit is not None:
+            self.jitter += (abs(transit - self.prev_transit) - self.jitter) / 16
+        self.prev_transit = transit
+
+    def delays_us(self):
+        """One-way delay of every packet above the smallest, needs keep_delays."""
+        return [transit - self.min_transit for transit in self.transits]
+
+    def print_statistics(self):
+        print("Stream:")
+        print(f"  {self.received} packets, highest sequence number {self.highest}")
+        print(f"  Lost: {self.lost} in {self.gaps} gaps, duplicates: {self.duplicates}, "
+              f"reordered: {self.reordered}, bad: {self.bad}")
+        if self.received:
+            print(f"  One-way delay above minimum: avg {self.delay_sum / self.received / 1000:.2f} ms, "
+                  f"max {self.max_delay / 1000:.2f} ms, jitter {self.jitter / 1000:.2f} ms")
@@ -1,7 +0,0 @@
-#ifndef CENTRAL_PERIPHERAL_H__
-#define CENTRAL_PERIPHERAL_H__
-#include <stdint.h>
-
-int write_tx_power_peripheral(int8_t tx_power_value);
-
-#endif
@@ -0,0 +1,26 @@
+#ifndef HANDLE_CACHE_H__
+#define HANDLE_CACHE_H__
+
+#include <stdint.h>
+#include <zephyr/bluetooth/addr.h>
+
+#include "link_control_service.h"
+
+#define HANDLE_CACHE_DB_HASH_LEN 16
+
+// LCS attribute handles of a peer, valid while its GATT Database Hash matches
+struct lcs_handle_cache {
+	uint8_t db_hash[HANDLE_CACHE_DB_HASH_LEN];
+	struct lcs_handles handles;
+};
+
+// Load the cached handles of a peer, returns -ENOENT if none are stored
+int handle_cache_load(const bt_addr_le_t *addr, struct lcs_handle_cache *cache);
+
+// Persist the handles of a peer
+int handle_cache_store(const bt_addr_le_t *addr, const struct lcs_handle_cache *cache);
+
+// Drop the cached handles of a peer
+int handle_cache_delete(const bt_addr_le_t *addr);
+
+#endif
@@ -1,6 +1,7 @@
 
 #include <zephyr/types.h>
 #include <stdlib.h>
+#include <strings.h>
 #include <stddef.h>
 #include <zephyr/kernel.h>
 #include <zephyr/bluetooth/bluetooth.h>
@@ -14,22 +15,103 @@
 #include <zephyr/logging/log.h>
 #include <zephyr/shell/shell.h>
 #include <zephyr/fs/fs.h>
+#include <bluetooth/gatt_dm.h>
 
 #include "link_control.h"
 #include "link_control_service.h"
+#include "central_peripheral.h"
+#include "handle_cache.h"
+#include "rssi_sampler.h"
+#include "rssi_history.h"
+#include "tx_power_ctrl.h"
+#include "phy_policy.h"
+#include "conn_params.h"
+#include "link_setup.h"
+#include "fast_reconnect.h"
+#include "telemetry.h"
+#include "log_backend_bin.h"
+#include "relay.h"
 
 LOG_MODULE_REGISTER(link_control_central);
 
 static void start_scan(void);
-static struct bt_uuid_128 discover_uuid = BT_UUID_INIT_128(0);
 static struct bt_conn *central_conn;
-struct bt_conn *peripheral_conn;
-static uint16_t tx_power_handle;
-static uint16_t rssi_handle;
-static struct bt_gatt_subscribe_params subscribe_params;
+static struct bt_conn *pending_conn;
+
+#if IS_ENABLED(CONFIG_LCS_FAST_RECONNECT)
+#define RECONNECT_SCAN_INTERVAL CONFIG_LCS_FAST_RECONNECT_SCAN_INTERVAL
+#define RECONNECT_SCAN_WINDOW   CONFIG_LCS_FAST_RECONNECT_SCAN_WINDOW
+#define RECONNECT_SLICE_MS      CONFIG_LCS_FAST_RECONNECT_SCAN_SLICE_MS
+#else
+#define RECONNECT_SCAN_INTERVAL BT_GAP_SCAN_FAST_INTERVAL
+#define RECONNECT_SCAN_WINDOW   BT_GAP_SCAN_FAST_WINDOW
+#define RECONNECT_SLICE_MS      0
+#endif
+
+/* Shortest connection interval the spec allows, 7.5 ms in 1.25 ms units */
+#define CONN_INTERVAL_MIN 6
+
+/* Scanning with the filter accept list for lost peripherals */
+static bool reconnect_scan;
+/* The next scan looks for new peripherals, the lost ones had their turn */
+static bool discovery_turn;
+
+static void reconnect_scan_timeout(struct k_work *work)
+{
+    /* Lost peers given up on since are dropped from the list */
+    discovery_turn = reconnect_scan;
+    start_scan();
+}
+
+static K_WORK_DELAYABLE_DEFINE(reconnect_scan_work, reconnect_scan_timeout);
+
+/* One slot is kept for the upstream central */
+#define MAX_PERIPHERAL_LINKS (CONFIG_BT_MAX_CONN - 1)
+
+/* Link control state of one connected peripheral, indexed by bt_conn_index() */
+struct peripheral_link {
+    struct bt_conn *conn;
+    struct lcs_handles handles;
+    bool discovery_pending;
+    bool subscribed;
+    bool db_hash_valid;
+    uint8_t db_hash[HANDLE_CACHE_DB_HASH_LEN];
+    int8_t tx_power;
+    int8_t peripheral_tx_power;
+    int8_t rssi;
+    struct bt_gatt_subscribe_params subscribe_params;
+    struct bt_gatt_write_params write_params;
+    struct bt_gatt_read_params read_params;
+};
+
+static struct peripheral_link links[CONFIG_BT_MAX_CONN];
 
 int8_t current_tx_power = 0;
 
+static struct peripheral_link *link_get(struct bt_conn *conn)
+{
+    struct peripheral_link *link = &links[bt_conn_index(conn)];
+
+    return link->conn == conn ? link : NULL;
+}
+
+static size_t link_count(void)
+{
+    size_t count = 0;
+
+    for (size_t i = 0; i < ARRAY_SIZE(links); i++) {
+        if (links[i].conn) {
+            count++;
+        }
+    }
+    return count;
+}
+
+static bool link_slots_full(void)
+{
+    return link_count() + (pending_conn ? 1 : 0) >= MAX_PERIPHERAL_LINKS;
+}
+
 #define NAME_LEN 256
 #define DEVICE_NAME CONFIG_BT_DEVICE_NAME
 #define DEVICE_NAME_LEN (sizeof(DEVICE_NAME) - 1)
@@ -49,13 +131,9 @@ static void start_advertising(void) {
         LOG_ERR("Advertising failed to start (err %d)", err);
         return;
     }
-    set_tx_power(BT_HCI_VS_LL_HANDLE_TYPE_ADV, 0, current_tx_power);
+    set_tx_power_async(BT_HCI_VS_LL_HANDLE_TYPE_ADV, 0, current_tx_power, NULL, NULL);
 }
 
-struct link_control_handles {
-    uint16_t tx_power_handle;
-};
-
 static bool data_cb(struct bt_data *data, void *user_data) {
     int err;
     struct bt_uuid *uuid = user_data;
@@ -74,14 +152,47 @@ static bool data_cb(struct bt_data *data, void *user_data) {
     }
 }
 
+static void connect_peripheral(const bt_addr_le_t *addr)
+{
+    char addr_str[BT_ADDR_LE_STR_LEN];
+    struct bt_le_conn_param param = *BT_LE_CONN_PARAM_DEFAULT;
+    struct fast_reconnect_params cached;
+    int err;
+
+    bt_addr_le_to_str(addr, addr_str, sizeof(addr_str));
+
+    err = bt_le_scan_stop();
+    if (err) {
+        LOG_ERR("Stop LE scan failed (err %d)", err);
+        return;
+    }
+
+    /*
+     * A peripheral coming back starts at the interval its last link ended
+     * with. A long idle interval is capped, link setup runs its LL
+     * procedures first and the connection parameter mode picks it again.
+     */
+    if (IS_ENABLED(CONFIG_LCS_FAST_RECONNECT) && !fast_reconnect_get(addr, &cached)) {
+        param.interval_min = CLAMP(cached.interval_us / 1250, CONN_INTERVAL_MIN,
+                                   BT_GAP_INIT_CONN_INT_MAX);
+        param.interval_max = param.interval_min;
+    }
+
+    err = bt_conn_le_create(addr, BT_CONN_LE_CREATE_CONN, &param, &pending_conn);
+    if (err < 0) {
+        LOG_ERR("Create conn to %s failed (%d)", addr_str, err);
+        start_scan();
+    } else {
+        LOG_INF("Connection initiated to %s", addr_str);
+    }
+}
+
 static void device_found(const bt_addr_le_t *addr, int8_t rssi, uint8_t type,
              struct net_buf_simple *ad)
 {
-    char addr_str[BT_ADDR_LE_STR_LEN];
     struct bt_uuid service_uuid;
-    int err;
 
-    if (peripheral_conn) {
+    if (pending_conn || link_slots_full()) {
         return;
     }
 
@@ -91,35 +202,117 @@ static void device_found(const bt_addr_le_t *addr, int8_t rssi, uint8_t type,
         return;
     }
 
-    bt_addr_le_to_str(addr, addr_str, sizeof(addr_str));
+    /* Only lost peripherals pass the filter accept list, no need to parse */
+    if (reconnect_scan) {
+        connect_peripheral(addr);
+        return;
+    }
+
+    /*
+     * Directed advertising carries no data to match the service on, so
+     * the normal scan only follows it for peers fast reconnect remembers.
+     */
+    if (type == BT_GAP_ADV_TYPE_ADV_DIRECT_IND) {
+        struct fast_reconnect_params cached;
+        struct bt_conn *existing;
+
+        if (!IS_ENABLED(CONFIG_LCS_FAST_RECONNECT) || fast_reconnect_get(addr, &cached)) {
+            return;
+        }
+
+        existing = bt_conn_lookup_addr_le(BT_ID_DEFAULT, addr);
+        if (existing) {
+            bt_conn_unref(existing);
+            return;
+        }
+
+        connect_peripheral(addr);
+        return;
+    }
+
     bt_data_parse(ad, data_cb, &service_uuid);
 
     if (!bt_uuid_cmp(&service_uuid, BT_UUID_LCS)) {
+        struct bt_conn *existing = bt_conn_lookup_addr_le(BT_ID_DEFAULT, addr);
+
+        if (existing) {
+            bt_conn_unref(existing);
+            return;
+        }
+
         char uuid_str[NAME_LEN];
         bt_uuid_to_str(&service_uuid, uuid_str, sizeof(uuid_str));
         LOG_INF("Found service: %s", uuid_str);
 
-        err = bt_le_scan_stop();
-        if (err) {
-            LOG_ERR("Stop LE scan failed (err %d)", err);
-            return;
-        }
+        connect_peripheral(addr);
+    }
+}
 
-        err = bt_conn_le_create(addr, BT_CONN_LE_CREATE_CONN,
-                    BT_LE_CONN_PARAM_DEFAULT, &peripheral_conn);
-        if (err < 0) {
-            LOG_ERR("Create conn to %s failed (%d)", addr_str, err);
-            start_scan();
-        } else {
-            LOG_INF("Connection initiated to %s", addr_str);
-        }
+/* Scan for lost peripherals only, -ENOENT if there are none */
+static int start_reconnect_scan(void)
+{
+    bt_addr_le_t lost[MAX_PERIPHERAL_LINKS];
+    size_t count = fast_reconnect_pending(lost, ARRAY_SIZE(lost));
+    int err;
+
+    if (!count) {
+        return -ENOENT;
     }
+
+    /* The list cannot change while a scan uses it */
+    bt_le_scan_stop();
+    reconnect_scan = false;
+
+    err = bt_le_filter_accept_list_clear();
+    for (size_t i = 0; i < count && !err; i++) {
+        err = bt_le_filter_accept_list_add(&lost[i]);
+    }
+    if (!err) {
+        err = bt_le_scan_start(BT_LE_SCAN_PARAM(BT_LE_SCAN_TYPE_PASSIVE,
+                                                BT_LE_SCAN_OPT_FILTER_ACCEPT_LIST,
+                                                RECONNECT_SCAN_INTERVAL,
+                                                RECONNECT_SCAN_WINDOW),
+                               device_found);
+    }
+    if (err) {
+        LOG_WRN("Reconnect scan failed to start (err %d)", err);
+        return err;
+    }
+
+    reconnect_scan = true;
+    k_work_reschedule(&reconnect_scan_work, K_MSEC(RECONNECT_SLICE_MS));
+    LOG_INF("Scanning for %zu lost peripheral(s)", count);
+    return 0;
 }
 
 static void start_scan(void)
 {
     int err;
+    if (pending_conn || link_slots_full()) {
+        return;
+    }
+
+    /*
+     * While peripherals are lost, the accept list scan and the normal scan
+     * take turns, so new peripherals are still found in the meantime.
+     */
+    if (IS_ENABLED(CONFIG_LCS_FAST_RECONNECT)) {
+        if (!discovery_turn && !start_reconnect_scan()) {
+            return;
+        }
+        if (discovery_turn) {
+            k_work_reschedule(&reconnect_scan_work, K_MSEC(RECONNECT_SLICE_MS));
+        }
+        if (reconnect_scan) {
+            bt_le_scan_stop();
+            reconnect_scan = false;
+        }
+    }
+
     err = bt_le_scan_start(BT_LE_SCAN_ACTIVE, device_found);
+    if (err == -EALREADY) {
+        return;
+    }
     if (err < 0) {
         LOG_ERR("Scanning failed to start (err %d)", err);
         return;
@@ -127,9 +320,6 @@ static void start_scan(void)
     LOG_INF("Scanning successfully started");
 }
 
-static struct bt_gatt_discover_params discover_params;
-static struct bt_gatt_write_params write_params;
-
 static void write_func(struct bt_conn *conn, uint8_t err,
                        struct bt_gatt_write_params *params)
 {
@@ -140,28 +330,118 @@ static void write_func(struct bt_conn *conn, uint8_t err,
     }
 }
 
-int write_tx_power_peripheral(int8_t tx_power_value)
+static int write_tx_power_link(struct peripheral_link *link, int8_t tx_power_value)
 {
-    int err;
-	
-	if (peripheral_conn != NULL) {
-		write_params.data = &tx_power_value;
-		write_params.length = sizeof(tx_power_value);
-		write_params.handle = tx_power_handle;
-		write_params.offset = 0;
-		write_params.func = write_func;
-
-		err = bt_gatt_write(peripheral_conn, &write_params);
-		if (err) {
-			LOG_ERR("Write failed (err %d)", err);
-			return err;
-		}
-	} else {
-		return -EINVAL;
+	int err;
+
+	if (!link->handles.tx_power) {
+		return -EAGAIN;
+	}
+
+	link->peripheral_tx_power = tx_power_value;
+	link->write_params.data = &link->peripheral_tx_power;
+	link->write_params.length = sizeof(link->peripheral_tx_power);
+	link->write_params.handle = link->handles.tx_power;
+	link->write_params.offset = 0;
+	link->write_params.func = write_func;
+
+	err = bt_gatt_write(link->conn, &link->write_params);
+	if (err) {
+		LOG_ERR("Write failed (err %d)", err);
+		return err;
 	}
 	return 0;
 }
 
+int write_tx_power_peripheral(uint8_t link_index, int8_t tx_power_value)
+{
+	int err = -EINVAL;
+
+	if (link_index != LINK_INDEX_ALL) {
+		if (link_index >= ARRAY_SIZE(links) || !links[link_index].conn) {
+			return -EINVAL;
+		}
+		return write_tx_power_link(&links[link_index], tx_power_value);
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(links); i++) {
+		if (links[i].conn) {
+			err = write_tx_power_link(&links[i], tx_power_value);
+		}
+	}
+	return err;
+}
+
+int configure_tx_power_ctrl(uint8_t link_index, bool enabled, int8_t rssi_low,
+                            int8_t rssi_high)
+{
+	int err = -EINVAL;
+
+	if (!IS_ENABLED(CONFIG_LCS_TX_POWER_CTRL)) {
+		return -ENOTSUP;
+	}
+
+	if (link_index != LINK_INDEX_ALL) {
+		if (link_index >= ARRAY_SIZE(links) || !links[link_index].conn) {
+			return -EINVAL;
+		}
+		return tx_power_ctrl_configure(links[link_index].conn, enabled, rssi_low,
+					       rssi_high);
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(links); i++) {
+		if (links[i].conn) {
+			err = tx_power_ctrl_configure(links[i].conn, enabled, rssi_low,
+						      rssi_high);
+		}
+	}
+	return err;
+}
+
+size_t get_tx_power_ctrl_all(struct tx_power_ctrl_link_cfg *cfgs, size_t max)
+{
+	size_t count = 0;
+
+	if (!IS_ENABLED(CONFIG_LCS_TX_POWER_CTRL)) {
+		return 0;
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(links) && count < max; i++) {
+		if (!links[i].conn ||
+		    tx_power_ctrl_get(links[i].conn, &cfgs[count].cfg)) {
+			continue;
+		}
+		cfgs[count++].link_index = i;
+	}
+	return count;
+}
+
+int configure_conn_params(uint8_t link_index, uint8_t mode)
+{
+	int err = -EINVAL;
+
+	if (!IS_ENABLED(CONFIG_LCS_CONN_PARAMS)) {
+		return -ENOTSUP;
+	}
+
+	if (link_index != LINK_INDEX_ALL) {
+		if (central_conn && link_index == bt_conn_index(central_conn)) {
+			return conn_params_set_mode(central_conn, mode);
+		}
+		if (link_index >= ARRAY_SIZE(links) || !links[link_index].conn) {
+			return -EINVAL;
+		}
+		return conn_params_set_mode(links[link_index].conn, mode);
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(links); i++) {
+		if (links[i].conn) {
+			err = conn_params_set_mode(links[i].conn, mode);
+		}
+	}
+	return err;
+}
+
 static uint8_t rssi_notify_cb(struct bt_conn *conn,
                               struct bt_gatt_subscribe_params *params,
                               const void *data, uint16_t length)
@@ -174,103 +454,293 @@ static uint8_t rssi_notify_cb(struct bt_conn *conn,
         return BT_GATT_ITER_STOP;
     }
 
-	int8_t rssi = *(int8_t *)data;
+	struct peripheral_link *link = link_get(conn);
+	int8_t rssi;
+
+	if (!link) {
+		return BT_GATT_ITER_STOP;
+	}
+
+	/* Only the leading rssi byte is used, {rssi, link_index} also arrives */
+	if (length < sizeof(rssi)) {
+		return BT_GATT_ITER_CONTINUE;
+	}
+	rssi = *(const int8_t *)data;
+
+	link->rssi = rssi;
+    LOG_INF("Received RSSI notification: %d (link %u)", rssi, bt_conn_index(conn));
+	update_peripheral_rssi(central_conn, rssi, bt_conn_index(conn));
+
+	/* The peripheral measures our signal, which is what our TX power affects */
+	if (IS_ENABLED(CONFIG_LCS_TX_POWER_CTRL)) {
+		tx_power_ctrl_update(conn, rssi);
+	}
+
+	struct conn_event_counters counters;
+	bool have_counters = IS_ENABLED(CONFIG_LCS_RSSI_EVENT_REPORTS) &&
+			     rssi_sampler_get_counters(conn, &counters) == 0;
+
+	if (IS_ENABLED(CONFIG_LCS_PHY_POLICY)) {
+		struct phy_policy_sample sample = { .rssi = rssi };
+
+		/* Errors are counted on what we receive, RSSI on what the peripheral receives */
+		if (have_counters) {
+			sample.rx_packets = counters.rx_packets;
+			sample.crc_errors = counters.crc_errors;
+		}
+		phy_policy_update(conn, &sample);
+	}
 
-    LOG_INF("Received RSSI notification: %d", rssi);
-	update_peripheral_rssi(central_conn, rssi);
+	if (IS_ENABLED(CONFIG_LCS_TELEMETRY)) {
+		telemetry_sample(conn, rssi, have_counters ? &counters : NULL);
+	}
 
     return BT_GATT_ITER_CONTINUE;
 }
 
-static uint8_t discover_func(struct bt_conn *conn,
-                             const struct bt_gatt_attr *attr,
-                             struct bt_gatt_discover_params *params)
+static void link_subscribe(struct peripheral_link *link)
 {
-    int err;
+	int err;
 
-    if (!attr) {
-        LOG_INF("Discover complete");
-        (void)memset(params, 0, sizeof(*params));
-        return BT_GATT_ITER_STOP;
-    }
+	link->subscribe_params.notify = rssi_notify_cb;
+	link->subscribe_params.value = BT_GATT_CCC_NOTIFY;
+	link->subscribe_params.value_handle = link->handles.rssi;
+	link->subscribe_params.ccc_handle = link->handles.rssi_ccc;
 
-    LOG_INF("[ATTRIBUTE] handle %u", attr->handle);
+	err = bt_gatt_subscribe(link->conn, &link->subscribe_params);
+	if (err && err != -EALREADY) {
+		LOG_ERR("Subscribe failed (err %d)", err);
+	} else {
+		link->subscribed = true;
+		LOG_INF("[SUBSCRIBED]");
+	}
+}
 
-	char str[BT_UUID_STR_LEN];
+static void link_discover(struct peripheral_link *link);
 
-	bt_uuid_to_str(attr->uuid, str, sizeof(str));
-	LOG_INF("UUID: %s", str);
+/* Value handle of an LCS characteristic and, if requested, its CCC handle */
+static uint16_t dm_value_handle(struct bt_gatt_dm *dm, const struct bt_uuid *uuid,
+				uint16_t *ccc_handle)
+{
+	const struct bt_gatt_dm_attr *chrc = bt_gatt_dm_char_by_uuid(dm, uuid);
+	const struct bt_gatt_dm_attr *desc;
 
-    if (bt_uuid_cmp(discover_params.uuid, BT_UUID_LCS) == 0) {
-        // Service discovered, now discover characteristics
-		memcpy(&discover_uuid, BT_UUID_LCS_TX_PWR_PERIPHERAL, sizeof(discover_uuid));
-		discover_params.uuid = &discover_uuid.uuid;
-        discover_params.start_handle = attr->handle + 1;
-        discover_params.type = BT_GATT_DISCOVER_CHARACTERISTIC;
+	if (!chrc) {
+		return 0;
+	}
 
-        err = bt_gatt_discover(conn, &discover_params);
-        if (err) {
-            LOG_ERR("Discover failed (err %d)", err);
-        }
-    } else if (bt_uuid_cmp(discover_params.uuid, BT_UUID_LCS_TX_PWR_PERIPHERAL) == 0) {
-        // TX Power characteristic found
-        tx_power_handle = bt_gatt_attr_value_handle(attr);
-        LOG_INF("TX Power characteristic handle: %u", tx_power_handle);
+	if (ccc_handle) {
+		desc = bt_gatt_dm_desc_by_uuid(dm, chrc, BT_UUID_GATT_CCC);
+		*ccc_handle = desc ? desc->handle : 0;
+	}
 
-		memcpy(&discover_uuid, BT_UUID_LCS_RSSI_PERIPHERAL, sizeof(discover_uuid));
-		discover_params.uuid = &discover_uuid.uuid;
-        discover_params.start_handle = attr->handle + 1;
-        discover_params.type = BT_GATT_DISCOVER_CHARACTERISTIC;
+	desc = bt_gatt_dm_desc_by_uuid(dm, chrc, uuid);
+	return desc ? desc->handle : 0;
+}
 
-        err = bt_gatt_discover(conn, &discover_params);
-        if (err) {
-            LOG_ERR("Discover failed (err %d)", err);
-        }
-    } else if (bt_uuid_cmp(discover_params.uuid, BT_UUID_LCS_RSSI_PERIPHERAL) == 0) {
-		rssi_handle = bt_gatt_attr_value_handle(attr);
-		LOG_INF("RSSI characteristic handle: %u", rssi_handle);
+static void lcs_handles_from_dm(struct bt_gatt_dm *dm, struct lcs_handles *handles)
+{
+	handles->tx_power = dm_value_handle(dm, BT_UUID_LCS_TX_PWR, NULL);
+	handles->rssi = dm_value_handle(dm, BT_UUID_LCS_RSSI, &handles->rssi_ccc);
+	handles->tx_power_central = dm_value_handle(dm, BT_UUID_LCS_TX_PWR_CENTRAL, NULL);
+	handles->rssi_central = dm_value_handle(dm, BT_UUID_LCS_RSSI_CENTRAL,
+						&handles->rssi_central_ccc);
+	handles->throughput = dm_value_handle(dm, BT_UUID_LCS_THROUGHPUT,
+					      &handles->throughput_ccc);
+}
 
-		struct bt_uuid_16 ccc_uuid = BT_UUID_INIT_16(0);
-		memcpy(&ccc_uuid, BT_UUID_GATT_CCC, sizeof(ccc_uuid));
+/* GATT DM runs one discovery at a time, start the next waiting link */
+static void discovery_next(void)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(links); i++) {
+		if (links[i].conn && links[i].discovery_pending) {
+			links[i].discovery_pending = false;
+			link_discover(&links[i]);
+			return;
+		}
+	}
+}
 
-		discover_params.uuid = &ccc_uuid.uuid;
-		discover_params.start_handle = attr->handle + 2;
-		discover_params.type = BT_GATT_DISCOVER_DESCRIPTOR;
-		subscribe_params.value_handle = bt_gatt_attr_value_handle(attr);
+static void discovery_completed(struct bt_gatt_dm *dm, void *context)
+{
+	struct peripheral_link *link = context;
 
-		err = bt_gatt_discover(conn, &discover_params);
-		if (err) {
-			LOG_ERR("Discover failed (err %d)", err);
-		}
+	lcs_handles_from_dm(dm, &link->handles);
+	bt_gatt_dm_data_release(dm);
+
+	LOG_INF("LCS handles: tx power %u, rssi %u (ccc %u)", link->handles.tx_power,
+		link->handles.rssi, link->handles.rssi_ccc);
+
+	if (!link->handles.rssi || !link->handles.rssi_ccc) {
+		LOG_ERR("RSSI characteristic not found");
 	} else {
-		subscribe_params.notify = rssi_notify_cb;
-		subscribe_params.value = BT_GATT_CCC_NOTIFY;
-		subscribe_params.ccc_handle = attr->handle;
-
-		err = bt_gatt_subscribe(conn, &subscribe_params);
-		if (err && err != -EALREADY) {
-			LOG_ERR("Subscribe failed (err %d)", err);
-		} else {
-			LOG_INF("[SUBSCRIBED]");
-		}
+		link_subscribe(link);
+	}
+	if (IS_ENABLED(CONFIG_LCS_RELAY)) {
+		relay_link_ready(link->conn, link->handles.throughput,
+				 link->handles.throughput_ccc);
+	}
 
+	if (IS_ENABLED(CONFIG_LCS_HANDLE_CACHE) && link->db_hash_valid) {
+		struct lcs_handle_cache cache = {
+			.handles = link->handles,
+		};
+
+		memcpy(cache.db_hash, link->db_hash, sizeof(cache.db_hash));
+		handle_cache_store(bt_conn_get_dst(link->conn), &cache);
+	}
+
+	discovery_next();
+}
+
+static void discovery_service_not_found(struct bt_conn *conn, void *context)
+{
+	LOG_ERR("LCS not found on peer");
+	discovery_next();
+}
+
+static void discovery_error_found(struct bt_conn *conn, int err, void *context)
+{
+	LOG_ERR("Discover failed (err %d)", err);
+	discovery_next();
+}
+
+static const struct bt_gatt_dm_cb discovery_cb = {
+	.completed = discovery_completed,
+	.service_not_found = discovery_service_not_found,
+	.error_found = discovery_error_found,
+};
+
+static void link_discover(struct peripheral_link *link)
+{
+	int err;
+
+	err = bt_gatt_dm_start(link->conn, BT_UUID_LCS, &discovery_cb, link);
+	if (err == -EALREADY || err == -EBUSY) {
+		link->discovery_pending = true;
+	} else if (err) {
+		LOG_ERR("Discover failed(err %d)", err);
+	}
+}
+
+#if IS_ENABLED(CONFIG_LCS_HANDLE_CACHE)
+/* Use the cached handles if the peer database is unchanged, else rediscover */
+static void link_resolve_handles(struct peripheral_link *link)
+{
+	const bt_addr_le_t *dst = bt_conn_get_dst(link->conn);
+	struct lcs_handle_cache cache;
+
+	if (!link->db_hash_valid || handle_cache_load(dst, &cache)) {
+		link_discover(link);
+		return;
+	}
+
+	if (memcmp(cache.db_hash, link->db_hash, sizeof(cache.db_hash))) {
+		LOG_INF("Peer database changed, rediscovering");
+		handle_cache_delete(dst);
+		link_discover(link);
+		return;
+	}
+
+	LOG_INF("Using cached handles");
+	link->handles = cache.handles;
+	link_subscribe(link);
+	if (IS_ENABLED(CONFIG_LCS_RELAY)) {
+		relay_link_ready(link->conn, link->handles.throughput,
+				 link->handles.throughput_ccc);
+	}
+}
+
+static uint8_t db_hash_read_cb(struct bt_conn *conn, uint8_t err,
+			       struct bt_gatt_read_params *params,
+			       const void *data, uint16_t length)
+{
+	struct peripheral_link *link = link_get(conn);
+
+	if (!link) {
 		return BT_GATT_ITER_STOP;
 	}
 
-    return BT_GATT_ITER_STOP;
+	if (!err && data && length == sizeof(link->db_hash)) {
+		memcpy(link->db_hash, data, sizeof(link->db_hash));
+		link->db_hash_valid = true;
+	} else {
+		LOG_WRN("No database hash from peer (err %u)", err);
+	}
+
+	link_resolve_handles(link);
+	return BT_GATT_ITER_STOP;
+}
+
+static void link_read_db_hash(struct peripheral_link *link)
+{
+	int err;
+
+	link->read_params.func = db_hash_read_cb;
+	link->read_params.handle_count = 0;
+	link->read_params.by_uuid.uuid = BT_UUID_GATT_DB_HASH;
+	link->read_params.by_uuid.start_handle = BT_ATT_FIRST_ATTRIBUTE_HANDLE;
+	link->read_params.by_uuid.end_handle = BT_ATT_LAST_ATTRIBUTE_HANDLE;
+
+	err = bt_gatt_read(link->conn, &link->read_params);
+	if (err) {
+		LOG_ERR("Database hash read failed (err %d)", err);
+		link_discover(link);
+	}
+}
+#endif
+
+static void central_rssi_read_cb(int err, int8_t rssi, void *user_data)
+{
+	if (err) {
+		return;
+	}
+
+	LOG_INF("Central RSSI: %d", rssi);
+	update_central_rssi(central_conn, rssi);
+	if (IS_ENABLED(CONFIG_LCS_RSSI_HISTORY)) {
+		rssi_history_add(central_conn, rssi, k_uptime_get_32());
+	}
+	if (IS_ENABLED(CONFIG_LCS_TX_POWER_CTRL) && central_conn) {
+		tx_power_ctrl_update(central_conn, rssi);
+	}
+	if (IS_ENABLED(CONFIG_LCS_TELEMETRY) && central_conn) {
+		telemetry_sample(central_conn, rssi, NULL);
+	}
 }
 
 void get_central_rssi_work_handler(struct k_work *item) {
 	int err;
-	int8_t rssi;
 	uint16_t conn_handle;
+	struct rssi_stats stats;
+
+	if (IS_ENABLED(CONFIG_LCS_RSSI_EVENT_REPORTS) &&
+	    rssi_sampler_get(central_conn, &stats) == 0) {
+		LOG_INF("Central RSSI: %d (min %d max %d mean %d over %u events)", stats.ewma,
+			stats.min, stats.max, stats.mean, stats.count);
+		update_central_rssi(central_conn, stats.ewma);
+		if (IS_ENABLED(CONFIG_LCS_TX_POWER_CTRL)) {
+			tx_power_ctrl_update(central_conn, stats.ewma);
+		}
+		if (IS_ENABLED(CONFIG_LCS_TELEMETRY)) {
+			struct conn_event_counters counters;
 
-	bt_hci_get_conn_handle(central_conn, &conn_handle);
+			telemetry_sample(central_conn, stats.ewma,
+					 rssi_sampler_get_counters(central_conn, &counters) == 0 ?
+					 &counters : NULL);
+		}
+		return;
+	}
 
-	err = read_conn_rssi(conn_handle, &rssi);
-	LOG_INF("Central RSSI: %d", rssi);
+	err = bt_hci_get_conn_handle(central_conn, &conn_handle);
+	if (err) {
+		return;
+	}
 
-	update_central_rssi(central_conn, rssi);
+	err = read_conn_rssi_async(conn_handle, central_rssi_read_cb, NULL);
+	if (err) {
+		LOG_ERR("Failed to queue RSSI read (err %d)", err);
+	}
 }
 
 K_WORK_DEFINE(central_rssi_work, get_central_rssi_work_handler);
@@ -286,33 +756,72 @@ K_TIMER_DEFINE(central_rssi_timer, get_rssi, NULL);
 static void connected(struct bt_conn *conn, uint8_t err)
 {
     char addr[BT_ADDR_LE_STR_LEN];
+    struct bt_conn_info info;
     bt_addr_le_to_str(bt_conn_get_dst(conn), addr, sizeof(addr));
 
-    if (err < 0) {
+    if (conn == pending_conn) {
+        pending_conn = NULL;
+    }
+
+    bt_conn_get_info(conn, &info);
+
+    if (err) {
         LOG_ERR("Failed to connect to %s (%u)", addr, err);
-        bt_conn_unref(peripheral_conn);
-        peripheral_conn = NULL;
-        start_scan();
+        if (info.role == BT_CONN_ROLE_CENTRAL) {
+            bt_conn_unref(conn);
+            start_scan();
+        }
         return;
     }
 
     LOG_INF("Connected: %s", addr);
-    if (conn == peripheral_conn) {
-		memcpy(&discover_uuid, BT_UUID_LCS, sizeof(discover_uuid));
-		discover_params.uuid = &discover_uuid.uuid;
-		discover_params.func = discover_func;
-		discover_params.start_handle = BT_ATT_FIRST_ATTRIBUTE_HANDLE;
-		discover_params.end_handle = BT_ATT_LAST_ATTRIBUTE_HANDLE;
-		discover_params.type = BT_GATT_DISCOVER_PRIMARY;
-
-		err = bt_gatt_discover(conn, &discover_params);
-		if (err) {
-			LOG_ERR("Discover failed(err %d)", err);
+    if (IS_ENABLED(CONFIG_LCS_RSSI_EVENT_REPORTS)) {
+        rssi_sampler_start(conn);
+    }
+    if (IS_ENABLED(CONFIG_LCS_TX_POWER_CTRL)) {
+        tx_power_ctrl_start(conn, current_tx_power);
+    }
+    if (IS_ENABLED(CONFIG_LCS_CONN_PARAMS)) {
+        conn_params_start(conn);
+    }
+    if (IS_ENABLED(CONFIG_LCS_LINK_SETUP)) {
+        link_setup_start(conn);
+    }
+    if (IS_ENABLED(CONFIG_LCS_TELEMETRY)) {
+        telemetry_tx_power(bt_conn_index(conn), current_tx_power);
+    }
+
+    if (info.role == BT_CONN_ROLE_CENTRAL) {
+		struct peripheral_link *link = &links[bt_conn_index(conn)];
+
+		memset(link, 0, sizeof(*link));
+		link->conn = conn;
+		link->tx_power = current_tx_power;
+
+		if (IS_ENABLED(CONFIG_LCS_FAST_RECONNECT)) {
+			fast_reconnect_connected(conn);
+		}
+
+		if (IS_ENABLED(CONFIG_LCS_PHY_POLICY)) {
+			phy_policy_start(conn);
 		}
+
+#if IS_ENABLED(CONFIG_LCS_HANDLE_CACHE)
+		link_read_db_hash(link);
+#else
+		link_discover(link);
+#endif
+
+		LOG_INF("Peripheral link %u up (%zu/%d)", bt_conn_index(conn),
+			link_count(), MAX_PERIPHERAL_LINKS);
+		start_scan();
     } else {
 		if (central_conn == NULL) {
 			LOG_INF("Connected to central");
 			central_conn = conn;
+			if (IS_ENABLED(CONFIG_LCS_RELAY)) {
+				relay_set_upstream(conn);
+			}
 		}
 	}
 }
@@ -320,18 +829,49 @@ static void connected(struct bt_conn *conn, uint8_t err)
 static void disconnected(struct bt_conn *conn, uint8_t reason)
 {
     char addr[BT_ADDR_LE_STR_LEN];
+    struct peripheral_link *link = link_get(conn);
 
 
     bt_addr_le_to_str(bt_conn_get_dst(conn), addr, sizeof(addr));
     LOG_INF("Disconnected: %s (reason 0x%02x)", addr, reason);
 
-	if (conn == peripheral_conn) {
-		bt_conn_unref(peripheral_conn);
-		peripheral_conn = NULL;
+    if (IS_ENABLED(CONFIG_LCS_RSSI_EVENT_REPORTS)) {
+        rssi_sampler_stop(conn);
+    }
+    if (IS_ENABLED(CONFIG_LCS_RSSI_HISTORY)) {
+        rssi_history_clear(conn);
+    }
+    if (IS_ENABLED(CONFIG_LCS_TX_POWER_CTRL)) {
+        tx_power_ctrl_stop(conn);
+    }
+    if (IS_ENABLED(CONFIG_LCS_PHY_POLICY)) {
+        phy_policy_stop(conn);
+    }
+    if (IS_ENABLED(CONFIG_LCS_CONN_PARAMS)) {
+        conn_params_stop(conn);
+    }
+    if (IS_ENABLED(CONFIG_LCS_LINK_SETUP)) {
+        link_setup_stop(conn);
+    }
+
+	if (link) {
+		if (IS_ENABLED(CONFIG_LCS_RELAY)) {
+			relay_link_gone(conn);
+		}
+		if (IS_ENABLED(CONFIG_LCS_FAST_RECONNECT)) {
+			fast_reconnect_lost(conn, reason);
+		}
+		link->conn = NULL;
+		link->subscribed = false;
+		bt_conn_unref(conn);
 
 		start_scan();
 	} else if (conn == central_conn) {
 		k_timer_stop(&central_rssi_timer);
+		central_conn = NULL;
+		if (IS_ENABLED(CONFIG_LCS_RELAY)) {
+			relay_set_upstream(NULL);
+		}
 	}
 }
 
@@ -345,6 +885,10 @@ static void le_phy_updated(struct bt_conn *conn,
 
     LOG_INF("LE PHY Updated: %s Tx 0x%x, Rx 0x%x", addr, param->tx_phy,
            param->rx_phy);
+
+    if (IS_ENABLED(CONFIG_LCS_PHY_POLICY)) {
+        phy_policy_phy_updated(conn, param->tx_phy);
+    }
 }
 #endif
 
@@ -356,19 +900,99 @@ BT_CONN_CB_DEFINE(conn_callbacks) = {
 #endif
 };
 
+/* Resolve a link by its index or by its peer address */
+static struct peripheral_link *link_lookup(const char *arg)
+{
+    char addr[BT_ADDR_LE_STR_LEN];
+    char *end;
+    unsigned long index = strtoul(arg, &end, 10);
+
+    if (*end == '\0') {
+        if (index < ARRAY_SIZE(links) && links[index].conn) {
+            return &links[index];
+        }
+        return NULL;
+    }
+
+    for (size_t i = 0; i < ARRAY_SIZE(links); i++) {
+        if (!links[i].conn) {
+            continue;
+        }
+        bt_addr_le_to_str(bt_conn_get_dst(links[i].conn), addr, sizeof(addr));
+        if (strncasecmp(addr, arg, BT_ADDR_STR_LEN - 1) == 0) {
+            return &links[i];
+        }
+    }
+    return NULL;
+}
+
+/* Link named by argv[index], or the only connected link if omitted */
+static struct peripheral_link *link_from_args(const struct shell *shell, size_t argc,
+                                              char **argv, size_t index)
+{
+    struct peripheral_link *link = NULL;
+
+    if (argc > index) {
+        link = link_lookup(argv[index]);
+        if (!link) {
+            shell_error(shell, "No link %s", argv[index]);
+        }
+        return link;
+    }
+
+    if (link_count() != 1) {
+        shell_error(shell, link_count() ? "Specify a link index or address" :
+                    "No active connection");
+        return NULL;
+    }
+
+    for (size_t i = 0; i < ARRAY_SIZE(links); i++) {
+        if (links[i].conn) {
+            link = &links[i];
+        }
+    }
+    return link;
+}
+
+static int cmd_links(const struct shell *shell, size_t argc, char **argv)
+{
+    char addr[BT_ADDR_LE_STR_LEN];
+
+    for (size_t i = 0; i < ARRAY_SIZE(links); i++) {
+        struct peripheral_link *link = &links[i];
+
+        if (!link->conn) {
+            continue;
+        }
+        bt_addr_le_to_str(bt_conn_get_dst(link->conn), addr, sizeof(addr));
+        shell_print(shell, "[%zu] %s tx %d peer tx %d rssi %d %s", i, addr,
+                    link->tx_power, link->peripheral_tx_power, link->rssi,
+                    link->subscribed ? "subscribed" : "discovering");
+    }
+    shell_print(shell, "%zu/%d peripheral links", link_count(), MAX_PERIPHERAL_LINKS);
+    return 0;
+}
+
 static int cmd_set_peripheral_tx(const struct shell *shell, size_t argc, char **argv)
 {
+    int err;
     int8_t tx_power;
-    if (argc != 2) {
-        shell_error(shell, "Usage: set_peripheral_tx <power_level>");
+    struct peripheral_link *link;
+
+    if (argc < 2 || argc > 3) {
+        shell_error(shell, "Usage: set_peripheral_tx <power_level> [link]");
         return -EINVAL;
     }
     tx_power = (int8_t)atoi(argv[1]);
-    if (!peripheral_conn) {
-        shell_error(shell, "No active connection");
+    link = link_from_args(shell, argc, argv, 2);
+    if (!link) {
         return -ENOEXEC;
     }
-    write_tx_power_peripheral(tx_power);
+    err = write_tx_power_link(link, tx_power);
+    if (err) {
+        shell_error(shell, "Failed to write peripheral TX power (err %d)", err);
+        return err;
+    }
     return 0;
 }
 
@@ -376,26 +1000,36 @@ static int cmd_set_central_tx(const struct shell *shell, size_t argc, char **arg
 {
     int err;
     uint16_t conn_handle;
-    if (argc != 2) {
-        shell_error(shell, "Usage: set_central_tx <power_level>");
+    int8_t tx_power;
+    struct peripheral_link *link;
+
+    if (argc < 2 || argc > 3) {
+        shell_error(shell, "Usage: set_central_tx <power_level> [link]");
         return -EINVAL;
     }
-    current_tx_power = (int8_t)atoi(argv[1]);
-    if (!peripheral_conn) {
-        shell_error(shell, "No active connection");
+    tx_power = (int8_t)atoi(argv[1]);
+    link = link_from_args(shell, argc, argv, 2);
+    if (!link) {
         return -ENOEXEC;
     }
-    err = bt_hci_get_conn_handle(peripheral_conn, &conn_handle);
+    err = bt_hci_get_conn_handle(link->conn, &conn_handle);
     if (err) {
         shell_error(shell, "Failed to get connection handle (err %d)", err);
         return err;
     }
-    err = set_tx_power(BT_HCI_VS_LL_HANDLE_TYPE_CONN, conn_handle, current_tx_power);
+    err = set_tx_power(BT_HCI_VS_LL_HANDLE_TYPE_CONN, conn_handle, tx_power);
     if (err) {
         shell_error(shell, "Failed to set central TX power (err %d)", err);
         return err;
     }
-    shell_print(shell, "Central TX power set to %d", current_tx_power);
+    link->tx_power = tx_power;
+    if (IS_ENABLED(CONFIG_LCS_TX_POWER_CTRL)) {
+        tx_power_ctrl_set_power(link->conn, tx_power);
+    }
+    if (IS_ENABLED(CONFIG_LCS_TELEMETRY)) {
+        telemetry_tx_power(bt_conn_index(link->conn), tx_power);
+    }
+    shell_print(shell, "Central TX power set to %d", tx_power);
     return 0;
 }
 
@@ -404,12 +1038,14 @@ static int cmd_set_phy(const struct shell *shell, size_t argc, char **argv)
 {
     int err;
     uint8_t phy;
-    if (argc != 2) {
-        shell_error(shell, "Usage: set_phy <1m|2m|coded>");
+    struct peripheral_link *link;
+
+    if (argc < 2 || argc > 3) {
+        shell_error(shell, "Usage: set_phy <1m|2m|coded> [link]");
         return -EINVAL;
     }
-    if (!peripheral_conn) {
-        shell_error(shell, "No active connection");
+    link = link_from_args(shell, argc, argv, 2);
+    if (!link) {
         return -ENOEXEC;
     }
     if (strcmp(argv[1], "1m") == 0) {
@@ -422,7 +1058,7 @@ static int cmd_set_phy(const struct shell *shell, size_t argc, char **argv)
         shell_error(shell, "Invalid PHY option. Use 1m, 2m, or coded.");
         return -EINVAL;
     }
-    err = update_phy(peripheral_conn, phy);
+    err = update_phy(link->conn, phy);
     if (err) {
         shell_error(shell, "Failed to update PHY (err %d)", err);
         return err;
@@ -432,6 +1068,99 @@ static int cmd_set_phy(const struct shell *shell, size_t argc, char **argv)
 }
 #endif
 
+#if IS_ENABLED(CONFIG_LCS_CONN_PARAMS)
+static int cmd_conn_mode(const struct shell *shell, size_t argc, char **argv)
+{
+    int err;
+    int mode;
+    struct peripheral_link *link;
+    struct conn_params_state states[CONFIG_BT_MAX_CONN];
+
+    if (argc == 1) {
+        size_t count = conn_params_get_all(states, ARRAY_SIZE(states));
+
+        for (size_t i = 0; i < count; i++) {
+            shell_print(shell, "[%u] %s interval %u us latency %u timeout %u ms",
+                        states[i].link_index, conn_params_mode_str(states[i].mode),
+                        states[i].interval_us, states[i].latency, states[i].timeout * 10);
+        }
+        return 0;
+    }
+    if (argc > 3) {
+        shell_error(shell, "Usage: conn_mode [manual|throughput|low_power] [link]");
+        return -EINVAL;
+    }
+    mode = conn_params_mode_parse(argv[1]);
+    if (mode < 0) {
+        shell_error(shell, "Invalid mode. Use manual, throughput or low_power.");
+        return -EINVAL;
+    }
+    link = link_from_args(shell, argc, argv, 2);
+    if (!link) {
+        return -ENOEXEC;
+    }
+    err = conn_params_set_mode(link->conn, mode);
+    if (err) {
+        shell_error(shell, "Failed to set connection mode (err %d)", err);
+        return err;
+    }
+    shell_print(shell, "Connection mode set to %s", argv[1]);
+    return 0;
+}
+#endif
+
+#if IS_ENABLED(CONFIG_LCS_RELAY)
+static int cmd_relay_stats(const struct shell *shell, size_t argc, char **argv)
+{
+    struct relay_upstream_stats upstream;
+    struct relay_hop_stats hops[CONFIG_BT_MAX_CONN];
+    size_t count;
+
+    if (argc == 2 && strcmp(argv[1], "reset") == 0) {
+        relay_stats_reset();
+        return 0;
+    }
+
+    count = relay_stats_get(&upstream, hops, ARRAY_SIZE(hops));
+    for (size_t i = 0; i < count; i++) {
+        shell_print(shell, "[%u] in %u packets %u bytes, dropped %u, queued %u (max %u)",
+                    hops[i].link_index, hops[i].packets, hops[i].bytes, hops[i].dropped,
+                    hops[i].queued, hops[i].queued_max);
+    }
+    shell_print(shell, "upstream %u packets %u bytes, errors %u, in flight %u (max %u), "
+                "stalled %u ms", upstream.packets, upstream.bytes, upstream.errors,
+                upstream.in_flight, upstream.in_flight_max, upstream.stall_ms);
+    return 0;
+}
+#endif
+
+#if IS_ENABLED(CONFIG_LCS_LOG_BACKEND_BIN)
+/* The backend moves to a new file, so logging carries on without a reset */
+static int cmd_remove_logs(const struct shell *shell, size_t argc, char **argv)
+{
+	int err = log_backend_bin_remove_all();
+
+	if (err) {
+		shell_error(shell, "Failed to remove logs (err %d)", err);
+		return err;
+	}
+	shell_print(shell, "Logs removed, file system %d%% used", log_backend_bin_usage());
+	return 0;
+}
+
+static int cmd_rotate_logs(const struct shell *shell, size_t argc, char **argv)
+{
+	int err = log_backend_bin_rotate();
+
+	if (err) {
+		shell_error(shell, "Failed to rotate logs (err %d)", err);
+		return err;
+	}
+	shell_print(shell, "Started a new log file, file system %d%% used",
+		    log_backend_bin_usage());
+	return 0;
+}
+#else
 static int cmd_remove_logs(const struct shell *shell, size_t argc, char **argv) {
     int res;
     struct fs_dir_t dirp;
@@ -472,14 +1201,25 @@ static int cmd_remove_logs(const struct shell *shell, size_t argc, char **argv)
     shell_print(shell, "Directory %s cleared successfully\n", dir_path);
 	return 0;
 }
+#endif
 
 SHELL_STATIC_SUBCMD_SET_CREATE(link_control_cmds,
-    SHELL_CMD(set_peripheral_tx, NULL, "Set peripheral TX power", cmd_set_peripheral_tx),
-    SHELL_CMD(set_central_tx, NULL, "Set central TX power", cmd_set_central_tx),
+    SHELL_CMD(links, NULL, "List connected peripherals", cmd_links),
+    SHELL_CMD(set_peripheral_tx, NULL, "Set peripheral TX power [link]", cmd_set_peripheral_tx),
+    SHELL_CMD(set_central_tx, NULL, "Set central TX power [link]", cmd_set_central_tx),
 #if IS_ENABLED(CONFIG_BT_USER_PHY_UPDATE)
-    SHELL_CMD(set_phy, NULL, "Set PHY (1m, 2m, or coded)", cmd_set_phy),
+    SHELL_CMD(set_phy, NULL, "Set PHY (1m, 2m, or coded) [link]", cmd_set_phy),
+#endif
+#if IS_ENABLED(CONFIG_LCS_CONN_PARAMS)
+    SHELL_CMD(conn_mode, NULL, "Show or set connection parameter mode [link]", cmd_conn_mode),
+#endif
+#if IS_ENABLED(CONFIG_LCS_RELAY)
+    SHELL_CMD(relay_stats, NULL, "Show or reset relay statistics [reset]", cmd_relay_stats),
 #endif
 	SHELL_CMD(remove_logs, NULL, "Removes all logs", cmd_remove_logs),
+#if IS_ENABLED(CONFIG_LCS_LOG_BACKEND_BIN)
+	SHELL_CMD(rotate_logs, NULL, "Start a new log file", cmd_rotate_logs),
+#endif
     SHELL_SUBCMD_SET_END
 );
 
@@ -500,6 +1240,20 @@ int main(void)
         settings_load();
     }
 
+    if (IS_ENABLED(CONFIG_LCS_RSSI_EVENT_REPORTS)) {
+        err = rssi_sampler_init();
+        if (err) {
+            LOG_WRN("Falling back to polled RSSI (err %d)", err);
+        }
+    }
+
+    if (IS_ENABLED(CONFIG_LCS_TELEMETRY)) {
+        err = telemetry_init();
+        if (err) {
+            LOG_WRN("Telemetry not recorded (err %d)", err);
+        }
+    }
+
 	start_advertising();
 	LOG_INF("Advertising started");
 
@@ -0,0 +1,83 @@
+#include <errno.h>
+#include <stdio.h>
+#include <zephyr/kernel.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/logging/log.h>
+
+#include "handle_cache.h"
+
+LOG_MODULE_REGISTER(handle_cache, LOG_LEVEL_INF);
+
+#define HANDLE_CACHE_SUBTREE "lcs/hc"
+
+/* "lcs/hc/" + address in hex + address type */
+#define HANDLE_CACHE_KEY_LEN (sizeof(HANDLE_CACHE_SUBTREE) + 2 * sizeof(bt_addr_t) + 3)
+
+struct load_ctx {
+	struct lcs_handle_cache *cache;
+	bool found;
+};
+
+static void cache_key(const bt_addr_le_t *addr, char *key, size_t key_len)
+{
+	char hex[2 * sizeof(bt_addr_t) + 1];
+
+	bin2hex(addr->a.val, sizeof(addr->a.val), hex, sizeof(hex));
+	snprintf(key, key_len, HANDLE_CACHE_SUBTREE "/%s%u", hex, addr->type);
+}
+
+static int load_direct(const char *key, size_t len, settings_read_cb read_cb,
+		       void *cb_arg, void *param)
+{
+	struct load_ctx *ctx = param;
+
+	if (len != sizeof(*ctx->cache)) {
+		return 0;
+	}
+
+	if (read_cb(cb_arg, ctx->cache, sizeof(*ctx->cache)) == sizeof(*ctx->cache)) {
+		ctx->found = true;
+	}
+	return 0;
+}
+
+int handle_cache_load(const bt_addr_le_t *addr, struct lcs_handle_cache *cache)
+{
+	char key[HANDLE_CACHE_KEY_LEN];
+	struct load_ctx ctx = {
+		.cache = cache,
+	};
+	int err;
+
+	cache_key(addr, key, sizeof(key));
+
+	err = settings_load_subtree_direct(key, load_direct, &ctx);
+	if (err) {
+		return err;
+	}
+
+	return ctx.found ? 0 : -ENOENT;
+}
+
+int handle_cache_store(const bt_addr_le_t *addr, const struct lcs_handle_cache *cache)
+{
+	char key[HANDLE_CACHE_KEY_LEN];
+	int err;
+
+	cache_key(addr, key, sizeof(key));
+
+	err = settings_save_one(key, cache, sizeof(*cache));
+	if (err) {
+		LOG_ERR("Failed to store handles (err %d)", err);
+	}
+	return err;
+}
+
+int handle_cache_delete(const bt_addr_le_t *addr)
+{
+	char key[HANDLE_CACHE_KEY_LEN];
+
+	cache_key(addr, key, sizeof(key));
+	return settings_delete(key);
+}
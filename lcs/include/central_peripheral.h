@@ -0,0 +1,27 @@
+#ifndef CENTRAL_PERIPHERAL_H__
+#define CENTRAL_PERIPHERAL_H__
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct tx_power_ctrl_link_cfg;
+
+// Link index addressing every connected peripheral
+#define LINK_INDEX_ALL 0xFF
+
+// Write the TX power characteristic of the peripheral at link_index
+int write_tx_power_peripheral(uint8_t link_index, int8_t tx_power_value);
+
+// Configure adaptive TX power control of the link at link_index
+int configure_tx_power_ctrl(uint8_t link_index, bool enabled, int8_t rssi_low,
+                            int8_t rssi_high);
+
+// Read the TX power control setpoint of every connected peripheral, the
+// links configure_tx_power_ctrl() addresses. Returns the number written.
+size_t get_tx_power_ctrl_all(struct tx_power_ctrl_link_cfg *cfgs, size_t max);
+
+// Select the connection parameter mode of the link at link_index, which may
+// also be the upstream central's link
+int configure_conn_params(uint8_t link_index, uint8_t mode);
+
+#endif
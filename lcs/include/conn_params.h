@@ -0,0 +1,50 @@
+#ifndef CONN_PARAMS_H__
+#define CONN_PARAMS_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <zephyr/bluetooth/conn.h>
+
+// How the connection parameters of a link are chosen
+enum conn_params_mode {
+	// Parameters are left as negotiated or set by hand
+	CONN_PARAMS_MODE_MANUAL,
+	// Interval that fits the most data per event for the current PHY and data length
+	CONN_PARAMS_MODE_THROUGHPUT,
+	// Long interval and peripheral latency while there is no traffic
+	CONN_PARAMS_MODE_LOW_POWER,
+};
+
+// Connection parameters of a link, as read over GATT
+struct conn_params_state {
+	uint8_t link_index;
+	uint8_t mode;
+	uint32_t interval_us;
+	uint16_t latency;
+	uint16_t timeout;
+} __packed;
+
+// With CONFIG_LCS_LINK_SETUP, a started link requests nothing until it is
+// released by the last link setup step
+void conn_params_start(struct bt_conn *conn);
+void conn_params_stop(struct bt_conn *conn);
+
+// Request the parameters of the link's mode now, returns -EALREADY if they
+// are already in use or the mode is manual
+int conn_params_release(struct bt_conn *conn);
+
+int conn_params_set_mode(struct bt_conn *conn, enum conn_params_mode mode);
+
+// Report bytes exchanged on a link, ends the idle state of the low power mode.
+// Called by the throughput, relay and log transfer paths in both directions.
+void conn_params_activity(struct bt_conn *conn, uint32_t bytes);
+
+// Fill states with every active link, returns the number of links
+size_t conn_params_get_all(struct conn_params_state *states, size_t max);
+
+const char *conn_params_mode_str(enum conn_params_mode mode);
+
+// Parse "manual", "throughput" or "low_power", returns -EINVAL otherwise
+int conn_params_mode_parse(const char *str);
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef FAST_RECONNECT_H__
+#define FAST_RECONNECT_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <zephyr/bluetooth/addr.h>
+#include <zephyr/bluetooth/conn.h>
+
+// What a link to a peer last ended with, reused when the peer comes back
+struct fast_reconnect_params {
+	uint8_t tx_phy;
+	uint16_t tx_octets;
+	uint32_t interval_us;
+};
+
+// Add the bonded peers, as if their links had just been lost
+void fast_reconnect_init(void);
+
+// Remember the peer and parameters of a link that was lost, call from the
+// disconnected callback. Peers with a resolvable private address are only
+// remembered when bonded, and links closed by this device are not.
+void fast_reconnect_lost(struct bt_conn *conn, uint8_t reason);
+
+// Record the recovery time if the peer was lost, call from the connected callback
+void fast_reconnect_connected(struct bt_conn *conn);
+
+// Peers lost less than CONFIG_LCS_FAST_RECONNECT_TIMEOUT_MS ago and not back
+// yet, most recent first. Returns the number written.
+size_t fast_reconnect_pending(bt_addr_le_t *addrs, size_t max);
+
+// Parameters of the last link with this peer, -ENOENT if unknown
+int fast_reconnect_get(const bt_addr_le_t *addr, struct fast_reconnect_params *params);
+
+bool fast_reconnect_is_bonded(const bt_addr_le_t *addr);
+
+#endif
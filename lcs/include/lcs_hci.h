@@ -0,0 +1,45 @@
+#ifndef LCS_HCI_H__
+#define LCS_HCI_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <zephyr/bluetooth/hci_types.h>
+#include <zephyr/bluetooth/hci_vs.h>
+#include <sdc_hci_vs.h>
+
+// Encoding of the HCI commands sent by link_control.c and decoding of their
+// responses and of the controller's vendor events. These only touch the
+// buffers they are given, so they also build for the unit_testing board.
+
+// Connection event report of the SoftDevice Controller, in host byte order
+struct lcs_hci_qos_report {
+	uint16_t conn_handle;
+	uint16_t event_counter;
+	int8_t rssi;
+	uint8_t tx_packets;
+	uint8_t tx_acks;
+	uint8_t rx_packets;
+	uint8_t crc_errors;
+};
+
+void lcs_hci_tx_power_encode(struct bt_hci_cp_vs_write_tx_power_level *cp,
+			     uint8_t handle_type, uint16_t handle, int8_t tx_power);
+
+// Decode a command complete, returns -EMSGSIZE if it is truncated and -EIO
+// if the controller rejected the command
+int lcs_hci_tx_power_decode(const void *rsp, size_t len, int8_t *selected);
+
+void lcs_hci_read_rssi_encode(struct bt_hci_cp_read_rssi *cp, uint16_t handle);
+int lcs_hci_read_rssi_decode(const void *rsp, size_t len, int8_t *rssi);
+
+void lcs_hci_conn_update_encode(sdc_hci_cmd_vs_conn_update_t *cmd, uint16_t conn_handle,
+				uint32_t interval_us, uint16_t latency, uint16_t timeout);
+
+// Status of a command complete, 0 if it is truncated
+uint8_t lcs_hci_status(const void *rsp, size_t len);
+
+// Decode a vendor event starting at its subevent code, returns -ENOMSG if it
+// is not a connection event report
+int lcs_hci_qos_report_decode(const void *evt, size_t len, struct lcs_hci_qos_report *report);
+
+#endif
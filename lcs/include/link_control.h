@@ -0,0 +1,46 @@
+#ifndef LINK_CONTROL_H__
+#define LINK_CONTROL_H__
+
+#include <stdint.h>
+#include <zephyr/bluetooth/bluetooth.h>
+
+extern int8_t current_tx_power;
+extern struct bt_conn *current_conn;
+
+// Completion callback for asynchronous commands. value holds the selected TX
+// power or the RSSI, err is -ECANCELED if a newer request replaced this one.
+typedef void (*link_control_cb_t)(int err, int8_t value, void *user_data);
+
+// Set the TX power level for a connection
+int set_tx_power(uint8_t handle_type, uint16_t handle, int8_t tx_pwr_lvl);
+
+// Read connection RSSI
+int read_conn_rssi(uint16_t handle, int8_t *rssi);
+
+// Supervision timeout in 10 ms units used when only the interval is changed
+#define CONN_SUPERVISION_TIMEOUT_DEFAULT 300
+
+// Change the connection interval, without peripheral latency
+int change_connection_interval(struct bt_conn *conn, uint16_t interval_us);
+
+// Change the connection interval, peripheral latency and supervision timeout
+// (10 ms units) of a connection where we are central
+int change_conn_params(struct bt_conn *conn, uint32_t interval_us, uint16_t latency,
+		       uint16_t timeout);
+
+// Update the connection PHY, coded PHY uses S8
+int update_phy(struct bt_conn *conn, uint8_t phy);
+
+// Update the connection PHY, coded_opt selects S2 or S8 for the coded PHY
+int update_phy_coding(struct bt_conn *conn, uint8_t phy, uint16_t coded_opt);
+
+// Asynchronous variants, queued and executed on the link control work queue
+int set_tx_power_async(uint8_t handle_type, uint16_t handle, int8_t tx_pwr_lvl,
+		       link_control_cb_t cb, void *user_data);
+int read_conn_rssi_async(uint16_t handle, link_control_cb_t cb, void *user_data);
+int change_connection_interval_async(struct bt_conn *conn, uint16_t interval_us,
+				     link_control_cb_t cb, void *user_data);
+int change_conn_params_async(struct bt_conn *conn, uint32_t interval_us, uint16_t latency,
+			     uint16_t timeout, link_control_cb_t cb, void *user_data);
+
+#endif
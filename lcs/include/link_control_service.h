@@ -0,0 +1,110 @@
+#ifndef LINK_CONTROL_SERVICE_H__
+#define LINK_CONTROL_SERVICE_H__
+
+#include <zephyr/types.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/uuid.h>
+#include <zephyr/bluetooth/gatt.h>
+
+// One UUID set for both roles. A role only registers the characteristics it
+// implements, so a UUID always means the same thing on every device.
+#define BT_UUID_LCS_VAL \
+    BT_UUID_128_ENCODE(0x430EBAD0, 0x5C25, 0x469E, 0xA162, 0xA1C9DC50A8FD)
+#define BT_UUID_LCS_TX_PWR_VAL \
+    BT_UUID_128_ENCODE(0x430EBAD1, 0x5C25, 0x469E, 0xA162, 0xA1C9DC50A8FD)
+#define BT_UUID_LCS_RSSI_VAL \
+    BT_UUID_128_ENCODE(0x430EBAD2, 0x5C25, 0x469E, 0xA162, 0xA1C9DC50A8FD)
+#define BT_UUID_LCS_THROUGHPUT_VAL \
+    BT_UUID_128_ENCODE(0x430EBAD3, 0x5C25, 0x469E, 0xA162, 0xA1C9DC50A8FD)
+#define BT_UUID_LCS_RSSI_CENTRAL_VAL \
+    BT_UUID_128_ENCODE(0x430EBAD4, 0x5C25, 0x469E, 0xA162, 0xA1C9DC50A8FD)
+#define BT_UUID_LCS_RSSI_HISTORY_VAL \
+    BT_UUID_128_ENCODE(0x430EBAD5, 0x5C25, 0x469E, 0xA162, 0xA1C9DC50A8FD)
+#define BT_UUID_LCS_TX_PWR_CTRL_VAL \
+    BT_UUID_128_ENCODE(0x430EBAD6, 0x5C25, 0x469E, 0xA162, 0xA1C9DC50A8FD)
+#define BT_UUID_LCS_PHY_STATE_VAL \
+    BT_UUID_128_ENCODE(0x430EBAD7, 0x5C25, 0x469E, 0xA162, 0xA1C9DC50A8FD)
+#define BT_UUID_LCS_CONN_PARAMS_VAL \
+    BT_UUID_128_ENCODE(0x430EBAD8, 0x5C25, 0x469E, 0xA162, 0xA1C9DC50A8FD)
+#define BT_UUID_LCS_LOG_XFER_CP_VAL \
+    BT_UUID_128_ENCODE(0x430EBAD9, 0x5C25, 0x469E, 0xA162, 0xA1C9DC50A8FD)
+#define BT_UUID_LCS_LOG_XFER_DATA_VAL \
+    BT_UUID_128_ENCODE(0x430EBADA, 0x5C25, 0x469E, 0xA162, 0xA1C9DC50A8FD)
+#define BT_UUID_LCS_THROUGHPUT_STATS_VAL \
+    BT_UUID_128_ENCODE(0x430EBADB, 0x5C25, 0x469E, 0xA162, 0xA1C9DC50A8FD)
+#define BT_UUID_LCS_THROUGHPUT_RX_STATS_VAL \
+    BT_UUID_128_ENCODE(0x430EBADC, 0x5C25, 0x469E, 0xA162, 0xA1C9DC50A8FD)
+#define BT_UUID_LCS_RELAY_VAL \
+    BT_UUID_128_ENCODE(0x430EBADD, 0x5C25, 0x469E, 0xA162, 0xA1C9DC50A8FD)
+#define BT_UUID_LCS_RELAY_STATS_VAL \
+    BT_UUID_128_ENCODE(0x430EBADE, 0x5C25, 0x469E, 0xA162, 0xA1C9DC50A8FD)
+// 0x430EBAD3 until both roles shared this definition
+#define BT_UUID_LCS_TX_PWR_CENTRAL_VAL \
+    BT_UUID_128_ENCODE(0x430EBADF, 0x5C25, 0x469E, 0xA162, 0xA1C9DC50A8FD)
+#define BT_UUID_LCS_LINK_METRICS_VAL \
+    BT_UUID_128_ENCODE(0x430EBAE0, 0x5C25, 0x469E, 0xA162, 0xA1C9DC50A8FD)
+#define BT_UUID_LCS                      BT_UUID_DECLARE_128(BT_UUID_LCS_VAL)
+#define BT_UUID_LCS_TX_PWR               BT_UUID_DECLARE_128(BT_UUID_LCS_TX_PWR_VAL)
+#define BT_UUID_LCS_RSSI                 BT_UUID_DECLARE_128(BT_UUID_LCS_RSSI_VAL)
+#define BT_UUID_LCS_THROUGHPUT           BT_UUID_DECLARE_128(BT_UUID_LCS_THROUGHPUT_VAL)
+#define BT_UUID_LCS_RSSI_CENTRAL         BT_UUID_DECLARE_128(BT_UUID_LCS_RSSI_CENTRAL_VAL)
+#define BT_UUID_LCS_RSSI_HISTORY         BT_UUID_DECLARE_128(BT_UUID_LCS_RSSI_HISTORY_VAL)
+#define BT_UUID_LCS_TX_PWR_CTRL          BT_UUID_DECLARE_128(BT_UUID_LCS_TX_PWR_CTRL_VAL)
+#define BT_UUID_LCS_PHY_STATE            BT_UUID_DECLARE_128(BT_UUID_LCS_PHY_STATE_VAL)
+#define BT_UUID_LCS_CONN_PARAMS          BT_UUID_DECLARE_128(BT_UUID_LCS_CONN_PARAMS_VAL)
+#define BT_UUID_LCS_LOG_XFER_CP          BT_UUID_DECLARE_128(BT_UUID_LCS_LOG_XFER_CP_VAL)
+#define BT_UUID_LCS_LOG_XFER_DATA        BT_UUID_DECLARE_128(BT_UUID_LCS_LOG_XFER_DATA_VAL)
+#define BT_UUID_LCS_THROUGHPUT_STATS     BT_UUID_DECLARE_128(BT_UUID_LCS_THROUGHPUT_STATS_VAL)
+#define BT_UUID_LCS_THROUGHPUT_RX_STATS  BT_UUID_DECLARE_128(BT_UUID_LCS_THROUGHPUT_RX_STATS_VAL)
+#define BT_UUID_LCS_RELAY                BT_UUID_DECLARE_128(BT_UUID_LCS_RELAY_VAL)
+#define BT_UUID_LCS_RELAY_STATS          BT_UUID_DECLARE_128(BT_UUID_LCS_RELAY_STATS_VAL)
+#define BT_UUID_LCS_TX_PWR_CENTRAL       BT_UUID_DECLARE_128(BT_UUID_LCS_TX_PWR_CENTRAL_VAL)
+#define BT_UUID_LCS_LINK_METRICS         BT_UUID_DECLARE_128(BT_UUID_LCS_LINK_METRICS_VAL)
+
+// Attribute handles of a peer's LCS, 0 if the attribute is not present
+struct lcs_handles {
+    uint16_t tx_power;
+    uint16_t rssi;
+    uint16_t rssi_ccc;
+    uint16_t tx_power_central;
+    uint16_t rssi_central;
+    uint16_t rssi_central_ccc;
+    uint16_t throughput;
+    uint16_t throughput_ccc;
+};
+
+// Peripheral role: notify the RSSI of the link to the central
+void update_rssi(struct bt_conn *conn, int16_t new_rssi);
+
+// Central role: notify {rssi, link index} of a connected peripheral, and the
+// RSSI of the link to the upstream central
+void update_peripheral_rssi(struct bt_conn *conn, int16_t new_rssi, uint8_t link_index);
+void update_central_rssi(struct bt_conn *conn, int16_t new_rssi);
+
+// Queue one throughput notification, func is called once it has been sent
+int notify_throughput(struct bt_conn *conn, const void *data, uint16_t len,
+		      bt_gatt_complete_func_t func, void *user_data);
+
+// Notify one encoded RSSI history batch, see rssi_history.h
+int notify_rssi_history(struct bt_conn *conn, const void *data, uint16_t len);
+
+// Notify the PHY state of a link, see phy_policy.h
+int notify_phy_state(struct bt_conn *conn, const void *data, uint16_t len);
+
+// Notify a log transfer response on the control point, see log_transfer.h
+int notify_log_xfer_cp(struct bt_conn *conn, const void *data, uint16_t len);
+
+// Queue one log transfer chunk, func is called once it has been sent
+int notify_log_xfer_data(struct bt_conn *conn, const void *data, uint16_t len,
+			 bt_gatt_complete_func_t func);
+
+// Queue one relayed throughput packet, func is called with user_data once it
+// has been sent
+int notify_relay(struct bt_conn *conn, const void *data, uint16_t len,
+		 bt_gatt_complete_func_t func, void *user_data);
+
+// Notify one closed link metrics bucket to every subscribed client, see
+// link_metrics.h
+int notify_link_metrics(const void *data, uint16_t len);
+
+#endif
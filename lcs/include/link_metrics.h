@@ -0,0 +1,42 @@
+#ifndef LINK_METRICS_H__
+#define LINK_METRICS_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <zephyr/bluetooth/conn.h>
+
+#include "lcs_hci.h"
+
+// Link quality of one link over one time bucket. Counts come from the
+// controller's connection event reports, bytes from the throughput and relay
+// streams.
+struct link_metrics {
+	uint8_t link_index;
+	uint32_t start_ms;        // uptime at the start of the bucket
+	uint16_t duration_ms;
+	uint16_t events;          // connection events reported
+	uint16_t missed_events;   // events in which nothing was received intact
+	uint16_t skipped_events;  // gaps in the event counter between reports
+	uint16_t tx_packets;      // PDUs sent, empty and retransmitted ones included
+	uint16_t retransmits;     // PDUs sent but not acknowledged
+	uint16_t rx_packets;      // PDUs received with a valid CRC
+	uint16_t crc_errors;
+	uint8_t per_percent;      // crc_errors / (rx_packets + crc_errors)
+	uint16_t empty_permille;  // acknowledged PDUs without data, estimated
+	uint16_t bytes_per_event; // stream bytes sent and received per event
+} __packed;
+
+// Add one connection event report of the link with this connection index
+void link_metrics_report(uint8_t index, const struct lcs_hci_qos_report *report);
+
+// Count stream payload bytes sent to or received from the peer
+void link_metrics_tx(struct bt_conn *conn, uint16_t len);
+void link_metrics_rx(struct bt_conn *conn, uint16_t len);
+
+// Last closed bucket of every connected link, returns the number written
+size_t link_metrics_get_all(struct link_metrics *metrics, size_t max);
+
+// Closed buckets of one link, oldest first, returns the number written
+size_t link_metrics_history(uint8_t index, struct link_metrics *metrics, size_t max);
+
+#endif
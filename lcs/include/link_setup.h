@@ -0,0 +1,50 @@
+#ifndef LINK_SETUP_H__
+#define LINK_SETUP_H__
+
+#include <stdint.h>
+#include <zephyr/bluetooth/conn.h>
+
+// Steps of the bring-up of a new link, in the order they run
+enum link_setup_step {
+	LINK_SETUP_MTU,
+	LINK_SETUP_DATA_LEN,
+	LINK_SETUP_PHY,
+	LINK_SETUP_CONN_PARAMS,
+	LINK_SETUP_STEPS,
+};
+
+enum link_setup_status {
+	LINK_SETUP_PENDING,
+	LINK_SETUP_DONE,
+	// Already in place, not built or not wanted
+	LINK_SETUP_SKIPPED,
+	// The procedure could not be started or was rejected
+	LINK_SETUP_FAILED,
+	// No completion within CONFIG_LCS_LINK_SETUP_STEP_TIMEOUT_MS
+	LINK_SETUP_TIMEOUT,
+};
+
+// Bring-up of one link. Times are in milliseconds from the connection, and
+// the values are those in use once the last step ended.
+struct link_setup_result {
+	uint8_t link_index;
+	uint8_t status[LINK_SETUP_STEPS];
+	uint16_t start_ms[LINK_SETUP_STEPS];
+	uint16_t end_ms[LINK_SETUP_STEPS];
+	uint16_t mtu;
+	uint16_t tx_octets;
+	uint8_t tx_phy;
+	uint32_t interval_us;
+} __packed;
+
+// Run the bring-up sequence on a new link, call from the connected callback
+void link_setup_start(struct bt_conn *conn);
+void link_setup_stop(struct bt_conn *conn);
+
+// Result of the last link with this index, -ENOENT if there was none
+int link_setup_get(uint8_t index, struct link_setup_result *result);
+
+const char *link_setup_step_str(enum link_setup_step step);
+const char *link_setup_status_str(enum link_setup_status status);
+
+#endif
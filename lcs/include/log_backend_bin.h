@@ -0,0 +1,20 @@
+#ifndef LOG_BACKEND_BIN_H__
+#define LOG_BACKEND_BIN_H__
+
+// Write out the buffered messages and close the current log file. Messages
+// logged while paused are buffered until the chunk is full, then dropped.
+int log_backend_bin_pause(void);
+
+// Continue logging in a new file
+void log_backend_bin_resume(void);
+
+// Close the current log file and continue in the next one
+int log_backend_bin_rotate(void);
+
+// Delete every file in the log directory and continue in a new file
+int log_backend_bin_remove_all(void);
+
+// Used space of the log file system in percent, or a negative errno
+int log_backend_bin_usage(void);
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef LOG_TRANSFER_H__
+#define LOG_TRANSFER_H__
+
+#include <stdint.h>
+#include <zephyr/bluetooth/conn.h>
+
+// Log transfer control point operations. Each one streams an object over the
+// log data characteristic, starting at a byte offset so a download can resume.
+enum log_transfer_op {
+	// {op, offset}: "name size\n" for every file in the log directory
+	LOG_TRANSFER_OP_LIST = 0x01,
+	// {op, offset, name}: contents of one file
+	LOG_TRANSFER_OP_FILE = 0x02,
+	// {op, offset, start_ms, end_ms}: telemetry records with a timestamp in
+	// [start_ms, end_ms], end_ms 0 for no upper bound
+	LOG_TRANSFER_OP_TELEMETRY = 0x03,
+	// {op}: stop the running transfer
+	LOG_TRANSFER_OP_ABORT = 0x04,
+};
+
+// Control point notifications
+enum log_transfer_rsp {
+	// Sent before the data, size is the object size or UINT32_MAX if unknown
+	LOG_TRANSFER_RSP_START = 0x80,
+	// Sent after the data, size is the offset after the last byte sent
+	LOG_TRANSFER_RSP_DONE = 0x81,
+};
+
+struct log_transfer_rsp_hdr {
+	uint8_t rsp;
+	uint8_t op;
+	int8_t status;
+	uint32_t size;
+} __packed;
+
+// Every data notification is {offset, payload, crc16} where the CRC-16-CCITT
+// (seed 0xffff) covers the offset and the payload.
+struct log_transfer_chunk_hdr {
+	uint32_t offset;
+} __packed;
+
+#define LOG_TRANSFER_CRC_LEN 2
+
+// Handle a control point write, returns 0 or a negative errno
+int log_transfer_request(struct bt_conn *conn, const uint8_t *data, uint16_t len);
+
+#endif
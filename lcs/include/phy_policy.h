@@ -0,0 +1,45 @@
+#ifndef PHY_POLICY_H__
+#define PHY_POLICY_H__
+
+#include <stdint.h>
+#include <zephyr/bluetooth/conn.h>
+
+// Why the policy last changed the PHY
+enum phy_policy_reason {
+	PHY_REASON_NONE,
+	PHY_REASON_RSSI_HIGH,
+	PHY_REASON_RSSI_LOW,
+	PHY_REASON_PER_HIGH,
+	PHY_REASON_THROUGHPUT,
+};
+
+// Link quality measured since the previous update
+struct phy_policy_sample {
+	int8_t rssi;
+	uint32_t rx_packets;
+	uint32_t crc_errors;
+	uint32_t tx_bytes;
+};
+
+// PHY state of a link, as read and notified over GATT
+struct phy_policy_state {
+	uint8_t link_index;
+	uint8_t phy;
+	uint8_t coded_s8;
+	uint8_t reason;
+	int8_t rssi;
+	uint8_t per_percent;
+} __packed;
+
+void phy_policy_start(struct bt_conn *conn);
+void phy_policy_stop(struct bt_conn *conn);
+
+// Evaluate the link and schedule a PHY update if needed
+void phy_policy_update(struct bt_conn *conn, const struct phy_policy_sample *sample);
+
+// Record the PHY reported by the controller
+void phy_policy_phy_updated(struct bt_conn *conn, uint8_t tx_phy);
+
+int phy_policy_get(struct bt_conn *conn, struct phy_policy_state *state);
+
+#endif
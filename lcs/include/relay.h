@@ -0,0 +1,48 @@
+#ifndef RELAY_H__
+#define RELAY_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <zephyr/bluetooth/conn.h>
+
+// Upstream side of the relay: notifications forwarded to the central's
+// own central, counted when the host reports them sent.
+struct relay_upstream_stats {
+	uint8_t in_flight;
+	uint8_t in_flight_max;
+	uint32_t packets;
+	uint32_t bytes;
+	uint32_t errors;
+	// Time spent waiting for the upstream link to complete a notification
+	uint32_t stall_ms;
+} __packed;
+
+// One downstream hop: throughput notifications received from one
+// peripheral link and their queue in front of the upstream link.
+struct relay_hop_stats {
+	uint8_t link_index;
+	uint8_t queued;
+	uint8_t queued_max;
+	uint32_t packets;
+	uint32_t bytes;
+	// Packets that did not fit the upstream MTU or found the queue full
+	uint32_t dropped;
+} __packed;
+
+// A peripheral link with a throughput characteristic, subscribed to while
+// the relay is enabled
+void relay_link_ready(struct bt_conn *conn, uint16_t value_handle, uint16_t ccc_handle);
+void relay_link_gone(struct bt_conn *conn);
+
+// Connection of the client receiving the relayed stream, NULL once it is gone
+void relay_set_upstream(struct bt_conn *conn);
+
+// Subscribe to or unsubscribe from the throughput stream of every link
+void relay_set_enabled(bool enabled);
+
+// Upstream statistics and up to max hops, returns the number of hops
+size_t relay_stats_get(struct relay_upstream_stats *upstream, struct relay_hop_stats *hops,
+		       size_t max);
+void relay_stats_reset(void);
+
+#endif
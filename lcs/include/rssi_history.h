@@ -0,0 +1,33 @@
+#ifndef RSSI_HISTORY_H__
+#define RSSI_HISTORY_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <zephyr/bluetooth/conn.h>
+
+/*
+ * RSSI history notification, little endian:
+ *   uint32_t timestamp_ms   uptime of the first sample
+ *   uint16_t period_ms      average spacing between the sample times
+ *   uint8_t  count          number of samples in this batch
+ *   int8_t   rssi           first sample
+ *   int8_t   delta[count - 1]  difference to the previous sample
+ */
+struct rssi_history_hdr {
+	uint32_t timestamp_ms;
+	uint16_t period_ms;
+	uint8_t count;
+	int8_t rssi;
+} __packed;
+
+// Start or stop batching samples, called when the client (un)subscribes
+void rssi_history_set_enabled(bool enabled);
+
+// Buffer one RSSI sample of conn taken at uptime time_ms, notifies once a
+// batch is full
+void rssi_history_add(struct bt_conn *conn, int8_t rssi, uint32_t time_ms);
+
+// Drop buffered samples of conn, called on disconnect
+void rssi_history_clear(struct bt_conn *conn);
+
+#endif
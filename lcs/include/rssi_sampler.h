@@ -0,0 +1,39 @@
+#ifndef RSSI_SAMPLER_H__
+#define RSSI_SAMPLER_H__
+
+#include <stdint.h>
+#include <zephyr/bluetooth/conn.h>
+
+// RSSI aggregated over the samples received since the previous call
+struct rssi_stats {
+	int8_t min;
+	int8_t max;
+	int8_t mean;
+	int8_t ewma;
+	uint16_t count;
+	// Samples dropped because the RSSI history ring was full
+	uint16_t dropped;
+};
+
+// Connection event report counters since the previous call
+struct conn_event_counters {
+	uint32_t events;
+	uint32_t rx_packets;
+	uint32_t crc_errors;
+};
+
+// Enable controller connection event reports, call after bt_enable()
+int rssi_sampler_init(void);
+
+// Start or stop collecting per-event RSSI samples for a connection
+int rssi_sampler_start(struct bt_conn *conn);
+void rssi_sampler_stop(struct bt_conn *conn);
+
+// Read and restart the aggregate of a connection and pass its buffered
+// samples to the RSSI history, returns -ENODATA if there are none
+int rssi_sampler_get(struct bt_conn *conn, struct rssi_stats *stats);
+
+// Read and reset the connection event counters of a connection
+int rssi_sampler_get_counters(struct bt_conn *conn, struct conn_event_counters *counters);
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef TELEMETRY_H__
+#define TELEMETRY_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <zephyr/bluetooth/conn.h>
+
+#include "rssi_sampler.h"
+
+// Event a telemetry record was taken for
+enum telemetry_type {
+	TELEMETRY_CONNECTED,
+	TELEMETRY_DISCONNECTED,
+	TELEMETRY_SAMPLE,
+	TELEMETRY_TX_POWER,
+	TELEMETRY_PHY,
+	TELEMETRY_CONN_PARAMS,
+};
+
+// Snapshot of one link when the event happened. Records are numbered by seq
+// without gaps, so a range of seq is a range of records.
+struct telemetry_record {
+	uint32_t seq;
+	uint32_t timestamp_ms;
+	uint8_t type;
+	uint8_t conn_index;
+	int8_t rssi;
+	int8_t tx_power;
+	uint8_t phy;
+	uint8_t reason;
+	uint16_t interval;
+	uint16_t latency;
+	uint16_t events;
+	uint16_t rx_packets;
+	uint16_t crc_errors;
+} __packed;
+
+// Return false to stop walking
+typedef bool (*telemetry_walk_cb_t)(const struct telemetry_record *record, void *user_data);
+
+// Mount the telemetry partition and recover the last record, call from main()
+int telemetry_init(void);
+
+// Record an RSSI measurement, counters may be NULL
+void telemetry_sample(struct bt_conn *conn, int8_t rssi,
+		      const struct conn_event_counters *counters);
+
+// Record a TX power change of the link at conn_index
+void telemetry_tx_power(uint8_t conn_index, int8_t tx_power);
+
+// Call cb for every stored record from first_seq on, oldest first
+int telemetry_walk(uint32_t first_seq, telemetry_walk_cb_t cb, void *user_data);
+
+// Sequence numbers of the oldest stored record and of the next one
+void telemetry_range(uint32_t *first_seq, uint32_t *next_seq);
+
+// Erase all records
+int telemetry_clear(void);
+
+#endif
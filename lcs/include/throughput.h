@@ -0,0 +1,112 @@
+#ifndef THROUGHPUT_H__
+#define THROUGHPUT_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/bluetooth/conn.h>
+
+// Bin 0 counts completions under 1 ms, bin n those from 2^(n-1) to 2^n ms and
+// the last bin everything slower
+#define THROUGHPUT_LATENCY_BINS 12
+
+// Throughput notification counters of one link since it connected or the
+// last reset. Queued counts notifications accepted by the host, completed
+// those the controller has sent.
+struct throughput_stats {
+	uint8_t link_index;
+	uint32_t duration_ms;
+	uint32_t bytes_queued;
+	uint32_t packets_queued;
+	uint32_t bytes_completed;
+	uint32_t packets_completed;
+	// bt_gatt_notify_cb() ran out of buffers despite a free credit
+	uint32_t nomem_stalls;
+	// Any other bt_gatt_notify_cb() error
+	uint32_t errors;
+	uint32_t latency_avg_us;
+	uint32_t latency_max_us;
+	uint32_t latency_hist[THROUGHPUT_LATENCY_BINS];
+} __packed;
+
+// Paths data arrives on from the peer
+enum throughput_rx_path {
+	// Write Without Response to the throughput characteristic
+	THROUGHPUT_RX_GATT,
+	// SDUs on the throughput L2CAP channel
+	THROUGHPUT_RX_L2CAP,
+	THROUGHPUT_RX_PATHS,
+};
+
+// Every throughput packet, in either direction, starts with this header;
+// the rest of the packet is filler. timestamp_us is the sender's clock when
+// it queued the packet and wraps every 71 minutes. With THROUGHPUT_PKT_CRC
+// set, crc is the CRC-16-CCITT (seed 0xffff) of the header up to crc
+// followed by the filler.
+struct throughput_pkt_hdr {
+	uint32_t seq;
+	uint32_t timestamp_us;
+	uint16_t flags;
+	uint16_t crc;
+} __packed;
+
+#define THROUGHPUT_PKT_CRC BIT(0)
+
+// Data received on one path since the link connected or the last reset.
+// A sequence number beyond the next expected one counts as a gap, one at or
+// below the highest seen so far as late (duplicated or reordered).
+struct throughput_rx_stats {
+	uint8_t link_index;
+	uint8_t path;
+	// From the first to the last packet
+	uint32_t duration_ms;
+	uint32_t bytes;
+	uint32_t packets;
+	// Highest sequence number received
+	uint32_t last_seq;
+	uint32_t gaps;
+	// Sequence numbers skipped by all gaps
+	uint32_t lost;
+	uint32_t late;
+	// Packets too short for the header or failing their CRC, not counted
+	// otherwise
+	uint32_t bad;
+} __packed;
+
+// Start or stop streaming throughput notifications on current_conn
+void throughput_set_enabled(bool enabled);
+
+// Bytes sent to the controller since the previous call
+uint32_t throughput_bytes_sent(void);
+
+// Copy the counters of conn
+int throughput_stats_get(struct bt_conn *conn, struct throughput_stats *stats);
+
+// Clear the counters of conn
+void throughput_stats_reset(struct bt_conn *conn);
+
+// Count a packet received from conn on path
+void throughput_rx(struct bt_conn *conn, enum throughput_rx_path path, const uint8_t *data,
+		   uint16_t len);
+
+// Copy the receive counters of conn, one per path
+void throughput_rx_stats_get(struct bt_conn *conn, struct throughput_rx_stats *stats);
+
+// L2CAP channel mode, see throughput_l2cap.c
+
+// Register the throughput L2CAP server on CONFIG_LCS_THROUGHPUT_L2CAP_PSM
+int throughput_l2cap_init(void);
+
+// Largest SDU the peer accepts, 0 while no channel is open
+uint16_t throughput_l2cap_mtu(struct bt_conn *conn);
+
+// Queue one SDU, throughput_l2cap_sent() is called once it has been sent
+int throughput_l2cap_send(struct bt_conn *conn, const uint8_t *data, uint16_t len);
+
+// Completion of an SDU queued at cycle count queued_at
+void throughput_l2cap_sent(struct bt_conn *conn, uint16_t len, uint32_t queued_at);
+
+// The channel of conn was closed, dropping this many queued SDUs
+void throughput_l2cap_closed(struct bt_conn *conn, uint8_t dropped);
+
+#endif
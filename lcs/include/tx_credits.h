@@ -0,0 +1,48 @@
+#ifndef TX_CREDITS_H__
+#define TX_CREDITS_H__
+
+#include <stdbool.h>
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/conn.h>
+
+// Paces a stream of notifications to what the host can buffer. There is one
+// credit per notification that may be in flight. in_flight counts the ones
+// queued but not completed, so the credits of notifications dropped with
+// their link can be given back without ever exceeding the depth.
+struct tx_credits {
+	struct k_sem sem;
+	atomic_t in_flight;
+	// Connection index of the link the notifications in flight were sent on
+	atomic_t conn_index;
+};
+
+#define TX_CREDITS_DEFINE(name, depth)                                          \
+	BUILD_ASSERT((depth) <= CONFIG_BT_ATT_TX_COUNT,                         \
+		     "Pipeline depth exceeds the number of ATT TX buffers");   \
+	static struct tx_credits name = {                                       \
+		.sem = Z_SEM_INITIALIZER(name.sem, depth, depth),               \
+	}
+
+// Take a credit for one notification on conn, as k_sem_take()
+int tx_credits_take(struct tx_credits *credits, struct bt_conn *conn, k_timeout_t timeout);
+
+// Give back a credit that was taken but not used for a queued notification
+void tx_credits_cancel(struct tx_credits *credits);
+
+// Give back the credits of up to count completed notifications
+void tx_credits_release(struct tx_credits *credits, atomic_val_t count);
+
+// Give back the credits of the notifications dropped with conn, call from
+// the disconnected callback
+void tx_credits_disconnected(struct tx_credits *credits, struct bt_conn *conn);
+
+static inline atomic_val_t tx_credits_in_flight(struct tx_credits *credits)
+{
+	return atomic_get(&credits->in_flight);
+}
+
+// If err says the host ran out of ATT/ACL buffers despite the credits, back
+// off briefly and return true so the caller tries again
+bool tx_credits_retry(int err);
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef TX_POWER_CTRL_H__
+#define TX_POWER_CTRL_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <zephyr/bluetooth/conn.h>
+
+// Setpoint of one link, as read and written over GATT
+struct tx_power_ctrl_cfg {
+	uint8_t enabled;
+	int8_t rssi_low;
+	int8_t rssi_high;
+	int8_t tx_power;
+} __packed;
+
+// Setpoint of one of the central's peripheral links, as read over GATT
+struct tx_power_ctrl_link_cfg {
+	uint8_t link_index;
+	struct tx_power_ctrl_cfg cfg;
+} __packed;
+
+// Start controlling the TX power of conn, starting from tx_power
+void tx_power_ctrl_start(struct bt_conn *conn, int8_t tx_power);
+void tx_power_ctrl_stop(struct bt_conn *conn);
+
+// Feed one RSSI measurement of the link
+void tx_power_ctrl_update(struct bt_conn *conn, int8_t rssi);
+
+// Report a TX power set outside the controller, e.g. from the shell
+void tx_power_ctrl_set_power(struct bt_conn *conn, int8_t tx_power);
+
+// Change the RSSI window of a link and enable or disable the loop
+int tx_power_ctrl_configure(struct bt_conn *conn, bool enabled, int8_t rssi_low,
+			    int8_t rssi_high);
+int tx_power_ctrl_get(struct bt_conn *conn, struct tx_power_ctrl_cfg *cfg);
+
+#endif
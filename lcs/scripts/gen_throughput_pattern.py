@@ -0,0 +1,60 @@
+#!/usr/bin/env python3
+"""Generate the filler of the throughput packets as a C array initializer.
+
+The output is included by lcs/src/throughput.c, so the payload is in the
+image and nothing is computed on the device. Patterns:
+
+- zeros: all bytes 0
+- counter: byte n is n modulo 256
+- prbs9: x^9 + x^5 + 1 seeded with all ones, least significant bit first,
+  the sequence of the Bluetooth direct test mode packets
+"""
+import argparse
+
+
+def zeros(length):
+    return bytes(length)
+
+
+def counter(length):
+    return bytes(n & 0xFF for n in range(length))
+
+
+def prbs9(length):
+    state = 0x1FF
+    out = bytearray()
+    for _ in range(length):
+        byte = 0
+        for bit in range(8):
+            byte |= (state & 1) << bit
+            feedback = (state ^ (state >> 4)) & 1
+            state = (state >> 1) | (feedback << 8)
+        out.append(byte)
+    return bytes(out)
+
+
+PATTERNS = {
+    "zeros": zeros,
+    "counter": counter,
+    "prbs9": prbs9,
+}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--pattern", choices=PATTERNS, required=True)
+    parser.add_argument("--length", type=int, required=True)
+    parser.add_argument("--output", required=True)
+    args = parser.parse_args()
+
+    data = PATTERNS[args.pattern](args.length)
+    with open(args.output, "w") as f:
+        f.write(f"/* {args.pattern}, {args.length} bytes, generated by "
+                "gen_throughput_pattern.py */\n")
+        for i in range(0, len(data), 12):
+            f.write(" ".join(f"0x{b:02x}," for b in data[i:i + 12]) + "\n")
+
+
+if __name__ == "__main__":
+    main()
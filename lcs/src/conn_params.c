@@ -0,0 +1,374 @@
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gap.h>
+
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(conn_params, LOG_LEVEL_INF);
+
+#include "link_control.h"
+#include "conn_params.h"
+
+/* Connection interval unit of the standard connection update procedure */
+#define CONN_INTERVAL_UNIT_US 1250
+#define T_IFS_US              150
+#define L2CAP_HDR_LEN         4
+#define DATA_LEN_DEFAULT      27
+/* Longest supervision timeout in 10 ms units */
+#define SUPERVISION_TIMEOUT_MAX 3200
+/* Time the controller needs between the end of one event and the next */
+#define EVENT_GAP_US          500
+
+#if defined(CONFIG_BT_CTLR_SDC_CONN_EVENT_EXTEND_DEFAULT)
+#define EVENT_LEN_MAX_US UINT32_MAX
+#elif defined(CONFIG_BT_CTLR_SDC_MAX_CONN_EVENT_LEN_DEFAULT)
+#define EVENT_LEN_MAX_US CONFIG_BT_CTLR_SDC_MAX_CONN_EVENT_LEN_DEFAULT
+#else
+#define EVENT_LEN_MAX_US 7500
+#endif
+
+struct conn_params_link {
+	struct bt_conn *conn;
+	enum conn_params_mode mode;
+	bool central;
+	/* Nothing is requested until link setup releases the link */
+	bool held;
+	uint8_t phy;
+	uint16_t tx_octets;
+	int64_t last_activity_ms;
+	uint32_t interval_us;
+	uint16_t latency;
+	uint16_t timeout;
+	uint32_t req_interval_us;
+	uint16_t req_latency;
+	struct k_work_delayable work;
+};
+
+static struct conn_params_link param_links[CONFIG_BT_MAX_CONN];
+
+static const char *const mode_str[] = {
+	[CONN_PARAMS_MODE_MANUAL] = "manual",
+	[CONN_PARAMS_MODE_THROUGHPUT] = "throughput",
+	[CONN_PARAMS_MODE_LOW_POWER] = "low_power",
+};
+
+static struct conn_params_link *link_get(struct bt_conn *conn)
+{
+	struct conn_params_link *link = &param_links[bt_conn_index(conn)];
+
+	return link->conn == conn ? link : NULL;
+}
+
+/* Air time of one packet with the given LL payload length */
+static uint32_t packet_time_us(uint16_t octets, uint8_t phy)
+{
+	switch (phy) {
+	case BT_GAP_LE_PHY_2M:
+		/* Preamble, access address, header and CRC at 4 us per byte */
+		return (octets + 11) * 4;
+	case BT_GAP_LE_PHY_CODED:
+		/* S8: preamble, access address, CI and TERM1, then 64 us per byte and TERM2 */
+		return 80 + 256 + 16 + 24 + (octets + 5) * 64 + 24;
+	default:
+		return (octets + 10) * 8;
+	}
+}
+
+/*
+ * Pick the interval that carries the most data per second. Each event sends
+ * full data packets, each answered by an empty one, for as long as the event
+ * may last; the unused tail of every event is what differs between intervals.
+ */
+static uint32_t throughput_interval_us(const struct conn_params_link *link)
+{
+	uint32_t pair_us = packet_time_us(link->tx_octets, link->phy) + T_IFS_US +
+			   packet_time_us(0, link->phy) + T_IFS_US;
+	uint32_t payload = link->tx_octets - L2CAP_HDR_LEN;
+	uint32_t best_interval_us = CONFIG_LCS_CONN_THROUGHPUT_MIN_INTERVAL_US;
+	uint32_t best_packets = 0;
+	uint64_t best_rate = 0;
+
+	for (uint32_t interval_us = CONFIG_LCS_CONN_THROUGHPUT_MIN_INTERVAL_US;
+	     interval_us <= CONFIG_LCS_CONN_THROUGHPUT_MAX_INTERVAL_US;
+	     interval_us += CONN_INTERVAL_UNIT_US) {
+		uint32_t event_us = MIN(interval_us - EVENT_GAP_US, EVENT_LEN_MAX_US);
+		/* The last packet is not followed by an inter frame space */
+		uint32_t packets = (event_us + T_IFS_US) / pair_us;
+		uint64_t rate = (uint64_t)packets * payload * USEC_PER_SEC / interval_us;
+
+		if (rate > best_rate) {
+			best_rate = rate;
+			best_packets = packets;
+			best_interval_us = interval_us;
+		}
+	}
+
+	LOG_DBG("%u octets: %u us interval, %u packets per event, %u B/s", link->tx_octets,
+		best_interval_us, best_packets, (uint32_t)best_rate);
+
+	return best_interval_us;
+}
+
+/* Returns 0 if an update was requested, -EALREADY if none is needed */
+static int apply(struct conn_params_link *link, uint32_t interval_us, uint16_t latency)
+{
+	/* The timeout must exceed twice the time between events the peripheral listens to */
+	uint32_t min_timeout_ms = (1 + latency) * interval_us * 2 / USEC_PER_MSEC;
+	uint16_t timeout = MIN(DIV_ROUND_UP(MAX(CONFIG_LCS_CONN_SUPERVISION_TIMEOUT_MS,
+						 min_timeout_ms), 10) + 1,
+			       SUPERVISION_TIMEOUT_MAX);
+	int err;
+
+	if (link->req_interval_us == interval_us && link->req_latency == latency) {
+		return -EALREADY;
+	}
+
+	if (link->interval_us == interval_us && link->latency == latency) {
+		link->req_interval_us = interval_us;
+		link->req_latency = latency;
+		return -EALREADY;
+	}
+
+	if (link->central) {
+		err = change_conn_params_async(link->conn, interval_us, latency, timeout,
+					       NULL, NULL);
+	} else {
+		struct bt_le_conn_param param = BT_LE_CONN_PARAM_INIT(
+			interval_us / CONN_INTERVAL_UNIT_US, interval_us / CONN_INTERVAL_UNIT_US,
+			latency, timeout);
+
+		err = bt_conn_le_param_update(link->conn, &param);
+	}
+
+	if (err) {
+		LOG_WRN("Link %u: connection update failed (err %d)",
+			ARRAY_INDEX(param_links, link), err);
+		link->req_interval_us = 0;
+		return err;
+	}
+
+	LOG_INF("Link %u (%s): interval %u us, latency %u, timeout %u ms",
+		ARRAY_INDEX(param_links, link), mode_str[link->mode], interval_us, latency,
+		timeout * 10);
+	link->req_interval_us = interval_us;
+	link->req_latency = latency;
+	return 0;
+}
+
+/* Request the parameters of the link's mode, see apply() */
+static int evaluate(struct conn_params_link *link)
+{
+	int64_t idle_ms;
+	int err;
+
+	switch (link->mode) {
+	case CONN_PARAMS_MODE_THROUGHPUT:
+		return apply(link, throughput_interval_us(link), 0);
+	case CONN_PARAMS_MODE_LOW_POWER:
+		idle_ms = k_uptime_get() - link->last_activity_ms;
+		if (idle_ms >= CONFIG_LCS_CONN_IDLE_TIMEOUT_MS) {
+			return apply(link, CONFIG_LCS_CONN_IDLE_INTERVAL_US,
+				     CONFIG_LCS_CONN_IDLE_LATENCY);
+		}
+		err = apply(link, CONFIG_LCS_CONN_ACTIVE_INTERVAL_US, 0);
+		k_work_schedule(&link->work, K_MSEC(CONFIG_LCS_CONN_IDLE_TIMEOUT_MS - idle_ms));
+		return err;
+	default:
+		return -EALREADY;
+	}
+}
+
+static void conn_params_work_handler(struct k_work *work)
+{
+	struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+	struct conn_params_link *link = CONTAINER_OF(dwork, struct conn_params_link, work);
+
+	if (!link->conn || link->held) {
+		return;
+	}
+
+	evaluate(link);
+}
+
+void conn_params_start(struct bt_conn *conn)
+{
+	struct conn_params_link *link = &param_links[bt_conn_index(conn)];
+	struct bt_conn_info info;
+
+	if (bt_conn_get_info(conn, &info)) {
+		return;
+	}
+
+	k_work_init_delayable(&link->work, conn_params_work_handler);
+	link->conn = bt_conn_ref(conn);
+	link->mode = CONFIG_LCS_CONN_PARAMS_DEFAULT_MODE;
+	link->central = info.role == BT_CONN_ROLE_CENTRAL;
+	link->phy = BT_GAP_LE_PHY_1M;
+	link->tx_octets = DATA_LEN_DEFAULT;
+#if IS_ENABLED(CONFIG_BT_USER_PHY_UPDATE)
+	link->phy = info.le.phy->tx_phy;
+#endif
+#if IS_ENABLED(CONFIG_BT_USER_DATA_LEN_UPDATE)
+	link->tx_octets = info.le.data_len->tx_max_len;
+#endif
+	link->interval_us = info.le.interval * CONN_INTERVAL_UNIT_US;
+	link->latency = info.le.latency;
+	link->timeout = info.le.timeout;
+	link->req_interval_us = 0;
+	link->req_latency = 0;
+	/* Stay responsive while the link is being set up */
+	link->last_activity_ms = k_uptime_get();
+	link->held = IS_ENABLED(CONFIG_LCS_LINK_SETUP);
+
+	if (!link->held) {
+		k_work_schedule(&link->work, K_NO_WAIT);
+	}
+}
+
+int conn_params_release(struct bt_conn *conn)
+{
+	struct conn_params_link *link = link_get(conn);
+
+	if (!link) {
+		return -ENOTCONN;
+	}
+
+	link->held = false;
+	return evaluate(link);
+}
+
+void conn_params_stop(struct bt_conn *conn)
+{
+	struct conn_params_link *link = link_get(conn);
+	struct k_work_sync sync;
+
+	if (link) {
+		k_work_cancel_delayable_sync(&link->work, &sync);
+		bt_conn_unref(link->conn);
+		link->conn = NULL;
+	}
+}
+
+int conn_params_set_mode(struct bt_conn *conn, enum conn_params_mode mode)
+{
+	struct conn_params_link *link = link_get(conn);
+
+	if (!link) {
+		return -ENOTCONN;
+	}
+	if (mode >= ARRAY_SIZE(mode_str)) {
+		return -EINVAL;
+	}
+
+	link->mode = mode;
+	link->req_interval_us = 0;
+	k_work_reschedule(&link->work, K_NO_WAIT);
+
+	return 0;
+}
+
+void conn_params_activity(struct bt_conn *conn, uint32_t bytes)
+{
+	struct conn_params_link *link = link_get(conn);
+
+	if (!link || bytes == 0) {
+		return;
+	}
+
+	link->last_activity_ms = k_uptime_get();
+
+	/* Leave the idle parameters right away */
+	if (link->mode == CONN_PARAMS_MODE_LOW_POWER && link->req_latency) {
+		k_work_reschedule(&link->work, K_NO_WAIT);
+	}
+}
+
+size_t conn_params_get_all(struct conn_params_state *states, size_t max)
+{
+	size_t count = 0;
+
+	for (size_t i = 0; i < ARRAY_SIZE(param_links) && count < max; i++) {
+		const struct conn_params_link *link = &param_links[i];
+
+		if (!link->conn) {
+			continue;
+		}
+
+		states[count++] = (struct conn_params_state) {
+			.link_index = i,
+			.mode = link->mode,
+			.interval_us = link->interval_us,
+			.latency = link->latency,
+			.timeout = link->timeout,
+		};
+	}
+
+	return count;
+}
+
+const char *conn_params_mode_str(enum conn_params_mode mode)
+{
+	return mode < ARRAY_SIZE(mode_str) ? mode_str[mode] : "unknown";
+}
+
+int conn_params_mode_parse(const char *str)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(mode_str); i++) {
+		if (strcmp(str, mode_str[i]) == 0) {
+			return i;
+		}
+	}
+
+	return -EINVAL;
+}
+
+static void le_param_updated(struct bt_conn *conn, uint16_t interval, uint16_t latency,
+			     uint16_t timeout)
+{
+	struct conn_params_link *link = link_get(conn);
+
+	if (link) {
+		link->interval_us = interval * CONN_INTERVAL_UNIT_US;
+		link->latency = latency;
+		link->timeout = timeout;
+	}
+}
+
+#if IS_ENABLED(CONFIG_BT_USER_DATA_LEN_UPDATE)
+static void le_data_len_updated(struct bt_conn *conn, struct bt_conn_le_data_len_info *info)
+{
+	struct conn_params_link *link = link_get(conn);
+
+	if (link && link->tx_octets != info->tx_max_len) {
+		link->tx_octets = info->tx_max_len;
+		if (link->mode == CONN_PARAMS_MODE_THROUGHPUT) {
+			k_work_reschedule(&link->work, K_NO_WAIT);
+		}
+	}
+}
+#endif
+
+#if IS_ENABLED(CONFIG_BT_USER_PHY_UPDATE)
+static void le_phy_updated(struct bt_conn *conn, struct bt_conn_le_phy_info *info)
+{
+	struct conn_params_link *link = link_get(conn);
+
+	if (link && link->phy != info->tx_phy) {
+		link->phy = info->tx_phy;
+		if (link->mode == CONN_PARAMS_MODE_THROUGHPUT) {
+			k_work_reschedule(&link->work, K_NO_WAIT);
+		}
+	}
+}
+#endif
+
+BT_CONN_CB_DEFINE(conn_params_callbacks) = {
+	.le_param_updated = le_param_updated,
+#if IS_ENABLED(CONFIG_BT_USER_DATA_LEN_UPDATE)
+	.le_data_len_updated = le_data_len_updated,
+#endif
+#if IS_ENABLED(CONFIG_BT_USER_PHY_UPDATE)
+	.le_phy_updated = le_phy_updated,
+#endif
+};
@@ -0,0 +1,248 @@
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/hci.h>
+#include <zephyr/shell/shell.h>
+
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(fast_reconnect, LOG_LEVEL_INF);
+
+#include "fast_reconnect.h"
+
+#define CONN_INTERVAL_UNIT_US 1250
+
+/*
+ * Peers whose link was lost, with what the link last ran at. The apps go
+ * looking for the pending ones (directed advertising on the peripheral,
+ * filter accept list scanning on the central) and link setup asks for the
+ * cached PHY and data length again. Entries are only kept in RAM; bonded
+ * peers are added again from the bond list at boot.
+ */
+struct peer {
+	bt_addr_le_t addr;
+	bool used;
+	bool bonded;
+	bool lost;
+	bool have_params;
+	int64_t seen_ms;
+	struct fast_reconnect_params params;
+	uint32_t recoveries;
+	uint32_t last_recovery_ms;
+	uint32_t best_recovery_ms;
+	uint32_t worst_recovery_ms;
+};
+
+static struct peer peers[CONFIG_LCS_FAST_RECONNECT_PEERS];
+static struct k_spinlock peers_lock;
+
+static struct peer *peer_find(const bt_addr_le_t *addr)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(peers); i++) {
+		if (peers[i].used && bt_addr_le_eq(&peers[i].addr, addr)) {
+			return &peers[i];
+		}
+	}
+	return NULL;
+}
+
+/* Existing entry of the peer, else a free or the least recently seen one */
+static struct peer *peer_get(const bt_addr_le_t *addr)
+{
+	struct peer *peer = peer_find(addr);
+
+	if (peer) {
+		return peer;
+	}
+
+	peer = &peers[0];
+	for (size_t i = 0; i < ARRAY_SIZE(peers); i++) {
+		if (!peers[i].used) {
+			peer = &peers[i];
+			break;
+		}
+		if (peers[i].seen_ms < peer->seen_ms) {
+			peer = &peers[i];
+		}
+	}
+
+	memset(peer, 0, sizeof(*peer));
+	bt_addr_le_copy(&peer->addr, addr);
+	peer->used = true;
+	return peer;
+}
+
+bool fast_reconnect_is_bonded(const bt_addr_le_t *addr)
+{
+	return bt_addr_le_is_bonded(BT_ID_DEFAULT, addr);
+}
+
+#if defined(CONFIG_BT_SMP)
+static void add_bond(const struct bt_bond_info *info, void *user_data)
+{
+	k_spinlock_key_t key = k_spin_lock(&peers_lock);
+	struct peer *peer = peer_get(&info->addr);
+
+	peer->bonded = true;
+	peer->lost = true;
+	peer->seen_ms = k_uptime_get();
+	k_spin_unlock(&peers_lock, key);
+}
+#endif
+
+void fast_reconnect_init(void)
+{
+#if defined(CONFIG_BT_SMP)
+	bt_foreach_bond(BT_ID_DEFAULT, add_bond, NULL);
+#endif
+}
+
+void fast_reconnect_lost(struct bt_conn *conn, uint8_t reason)
+{
+	const bt_addr_le_t *addr = bt_conn_get_dst(conn);
+	bool bonded = fast_reconnect_is_bonded(addr);
+	struct fast_reconnect_params params = {0};
+	struct bt_conn_info info;
+	k_spinlock_key_t key;
+	struct peer *peer;
+
+	if (reason == BT_HCI_ERR_LOCALHOST_TERM_CONN || (bt_addr_le_is_rpa(addr) && !bonded) ||
+	    bt_conn_get_info(conn, &info)) {
+		return;
+	}
+
+	params.interval_us = info.le.interval * CONN_INTERVAL_UNIT_US;
+#if IS_ENABLED(CONFIG_BT_USER_PHY_UPDATE)
+	params.tx_phy = info.le.phy->tx_phy;
+#endif
+#if IS_ENABLED(CONFIG_BT_USER_DATA_LEN_UPDATE)
+	params.tx_octets = info.le.data_len->tx_max_len;
+#endif
+
+	key = k_spin_lock(&peers_lock);
+	peer = peer_get(addr);
+	peer->bonded = bonded;
+	peer->lost = true;
+	peer->have_params = true;
+	peer->params = params;
+	peer->seen_ms = k_uptime_get();
+	k_spin_unlock(&peers_lock, key);
+}
+
+void fast_reconnect_connected(struct bt_conn *conn)
+{
+	char addr_str[BT_ADDR_LE_STR_LEN];
+	k_spinlock_key_t key;
+	struct peer *peer;
+	int64_t now = k_uptime_get();
+	uint32_t recovery_ms = 0;
+
+	key = k_spin_lock(&peers_lock);
+	peer = peer_find(bt_conn_get_dst(conn));
+	if (peer && peer->lost) {
+		recovery_ms = MIN(now - peer->seen_ms, UINT32_MAX);
+		peer->lost = false;
+		peer->seen_ms = now;
+		peer->recoveries++;
+		peer->last_recovery_ms = recovery_ms;
+		if (peer->recoveries == 1 || recovery_ms < peer->best_recovery_ms) {
+			peer->best_recovery_ms = recovery_ms;
+		}
+		peer->worst_recovery_ms = MAX(peer->worst_recovery_ms, recovery_ms);
+	}
+	k_spin_unlock(&peers_lock, key);
+
+	if (recovery_ms) {
+		bt_addr_le_to_str(bt_conn_get_dst(conn), addr_str, sizeof(addr_str));
+		LOG_INF("Link to %s recovered in %u ms", addr_str, recovery_ms);
+	}
+}
+
+size_t fast_reconnect_pending(bt_addr_le_t *addrs, size_t max)
+{
+	const struct peer *found[ARRAY_SIZE(peers)];
+	int64_t now = k_uptime_get();
+	k_spinlock_key_t key;
+	size_t count = 0;
+
+	key = k_spin_lock(&peers_lock);
+	for (size_t i = 0; i < ARRAY_SIZE(peers); i++) {
+		const struct peer *peer = &peers[i];
+		size_t pos;
+
+		if (!peer->used || !peer->lost ||
+		    now - peer->seen_ms >= CONFIG_LCS_FAST_RECONNECT_TIMEOUT_MS) {
+			continue;
+		}
+
+		/* Most recently lost first */
+		for (pos = count++; pos > 0 && found[pos - 1]->seen_ms < peer->seen_ms; pos--) {
+			found[pos] = found[pos - 1];
+		}
+		found[pos] = peer;
+	}
+
+	count = MIN(count, max);
+	for (size_t i = 0; i < count; i++) {
+		bt_addr_le_copy(&addrs[i], &found[i]->addr);
+	}
+	k_spin_unlock(&peers_lock, key);
+
+	return count;
+}
+
+int fast_reconnect_get(const bt_addr_le_t *addr, struct fast_reconnect_params *params)
+{
+	k_spinlock_key_t key = k_spin_lock(&peers_lock);
+	struct peer *peer = peer_find(addr);
+	int err = -ENOENT;
+
+	if (peer && peer->have_params) {
+		*params = peer->params;
+		err = 0;
+	}
+	k_spin_unlock(&peers_lock, key);
+
+	return err;
+}
+
+#if defined(CONFIG_SHELL)
+static int cmd_fast_reconnect(const struct shell *shell, size_t argc, char **argv)
+{
+	char addr_str[BT_ADDR_LE_STR_LEN];
+	struct peer copy[ARRAY_SIZE(peers)];
+	int64_t now = k_uptime_get();
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&peers_lock);
+	memcpy(copy, peers, sizeof(copy));
+	k_spin_unlock(&peers_lock, key);
+
+	for (size_t i = 0; i < ARRAY_SIZE(copy); i++) {
+		const struct peer *peer = &copy[i];
+
+		if (!peer->used) {
+			continue;
+		}
+
+		bt_addr_le_to_str(&peer->addr, addr_str, sizeof(addr_str));
+		shell_print(shell, "%s%s: %s for %lld ms", addr_str, peer->bonded ? " (bonded)" : "",
+			    peer->lost ? "lost" : "connected", now - peer->seen_ms);
+		if (peer->have_params) {
+			shell_print(shell, "    phy %u, tx octets %u, interval %u us",
+				    peer->params.tx_phy, peer->params.tx_octets,
+				    peer->params.interval_us);
+		}
+		if (peer->recoveries) {
+			shell_print(shell, "    %u recoveries, last %u ms, best %u ms, worst %u ms",
+				    peer->recoveries, peer->last_recovery_ms,
+				    peer->best_recovery_ms, peer->worst_recovery_ms);
+		}
+	}
+	return 0;
+}
+
+SHELL_CMD_REGISTER(fast_reconnect, NULL, "Show lost peers and their recovery times",
+		   cmd_fast_reconnect);
+#endif
@@ -0,0 +1,85 @@
+#include <errno.h>
+#include <zephyr/sys/byteorder.h>
+
+#include "lcs_hci.h"
+
+void lcs_hci_tx_power_encode(struct bt_hci_cp_vs_write_tx_power_level *cp,
+			     uint8_t handle_type, uint16_t handle, int8_t tx_power)
+{
+	cp->handle = sys_cpu_to_le16(handle);
+	cp->handle_type = handle_type;
+	cp->tx_power_level = tx_power;
+}
+
+int lcs_hci_tx_power_decode(const void *rsp, size_t len, int8_t *selected)
+{
+	const struct bt_hci_rp_vs_write_tx_power_level *rp = rsp;
+
+	if (len < sizeof(*rp)) {
+		return -EMSGSIZE;
+	}
+	if (rp->status) {
+		return -EIO;
+	}
+
+	*selected = rp->selected_tx_power;
+	return 0;
+}
+
+void lcs_hci_read_rssi_encode(struct bt_hci_cp_read_rssi *cp, uint16_t handle)
+{
+	cp->handle = sys_cpu_to_le16(handle);
+}
+
+int lcs_hci_read_rssi_decode(const void *rsp, size_t len, int8_t *rssi)
+{
+	const struct bt_hci_rp_read_rssi *rp = rsp;
+
+	if (len < sizeof(*rp)) {
+		return -EMSGSIZE;
+	}
+	if (rp->status) {
+		return -EIO;
+	}
+
+	*rssi = rp->rssi;
+	return 0;
+}
+
+void lcs_hci_conn_update_encode(sdc_hci_cmd_vs_conn_update_t *cmd, uint16_t conn_handle,
+				uint32_t interval_us, uint16_t latency, uint16_t timeout)
+{
+	cmd->conn_handle = sys_cpu_to_le16(conn_handle);
+	cmd->conn_interval_us = sys_cpu_to_le32(interval_us);
+	cmd->conn_latency = sys_cpu_to_le16(latency);
+	cmd->supervision_timeout = sys_cpu_to_le16(timeout);
+}
+
+uint8_t lcs_hci_status(const void *rsp, size_t len)
+{
+	/* Every command complete parameter list starts with the status */
+	return len ? *(const uint8_t *)rsp : 0;
+}
+
+int lcs_hci_qos_report_decode(const void *evt, size_t len, struct lcs_hci_qos_report *report)
+{
+	const uint8_t *data = evt;
+	const sdc_hci_subevent_vs_qos_conn_event_report_t *qos;
+
+	if (len < 1 || data[0] != SDC_HCI_SUBEVENT_VS_QOS_CONN_EVENT_REPORT) {
+		return -ENOMSG;
+	}
+	if (len - 1 < sizeof(*qos)) {
+		return -EMSGSIZE;
+	}
+
+	qos = (const void *)&data[1];
+	report->conn_handle = sys_le16_to_cpu(qos->conn_handle);
+	report->event_counter = sys_le16_to_cpu(qos->event_counter);
+	report->rssi = qos->rssi;
+	report->tx_packets = qos->tx_packet_count;
+	report->tx_acks = qos->tx_ack_count;
+	report->rx_packets = qos->rx_packet_count;
+	report->crc_errors = qos->rx_crc_error_count;
+	return 0;
+}
@@ -0,0 +1,379 @@
+#include <zephyr/kernel.h>
+#include <zephyr/init.h>
+#include <zephyr/sys/slist.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/hci.h>
+#include <zephyr/bluetooth/hci_vs.h>
+#include <sdc_hci_vs.h>
+
+#include "link_control.h"
+#include "lcs_hci.h"
+
+LOG_MODULE_REGISTER(link_control, LOG_LEVEL_DBG);
+
+static int hci_conn_update(uint16_t conn_handle, uint32_t interval_us, uint16_t latency,
+			   uint16_t timeout)
+{
+	int err;
+	struct net_buf *buf;
+
+	sdc_hci_cmd_vs_conn_update_t *cmd_conn_update;
+
+	buf = bt_hci_cmd_create(SDC_HCI_OPCODE_CMD_VS_CONN_UPDATE,
+				sizeof(*cmd_conn_update));
+	if (!buf) {
+		LOG_ERR("Could not allocate command buffer");
+		return -ENOMEM;
+	}
+
+	cmd_conn_update = net_buf_add(buf, sizeof(*cmd_conn_update));
+	lcs_hci_conn_update_encode(cmd_conn_update, conn_handle, interval_us, latency, timeout);
+
+	err = bt_hci_cmd_send_sync(SDC_HCI_OPCODE_CMD_VS_CONN_UPDATE, buf, NULL);
+	if (err < 0) {
+		LOG_ERR("Update connection parameters failed (err %d)", err);
+		return err;
+	}
+
+	return 0;
+}
+
+#if IS_ENABLED(CONFIG_BT_USER_PHY_UPDATE)
+int update_phy_coding(struct bt_conn *conn, uint8_t phy, uint16_t coded_opt) {
+    int err;
+	struct bt_conn_le_phy_param preferred_phy;
+
+	switch(phy) {
+		case BT_GAP_LE_PHY_1M:
+		case BT_GAP_LE_PHY_2M:
+			preferred_phy.options = BT_CONN_LE_PHY_OPT_NONE;
+			preferred_phy.pref_tx_phy = phy;
+			preferred_phy.pref_rx_phy = phy;
+			break;
+		case BT_GAP_LE_PHY_CODED:
+			preferred_phy.options = coded_opt;
+			preferred_phy.pref_tx_phy = BT_GAP_LE_PHY_CODED;
+			preferred_phy.pref_rx_phy = BT_GAP_LE_PHY_CODED;
+			break;
+		default:
+			LOG_ERR("Invalid PHY value");
+			return -EINVAL;
+	}
+
+    err = bt_conn_le_phy_update(conn, &preferred_phy);
+    if (err < 0) {
+        LOG_ERR("bt_conn_le_phy_update() returned %d", err);
+		return err;
+    }
+	return 0;
+}
+
+int update_phy(struct bt_conn *conn, uint8_t phy) {
+	return update_phy_coding(conn, phy, BT_CONN_LE_PHY_OPT_CODED_S8);
+}
+#endif
+
+static int hci_read_rssi(uint16_t handle, int8_t *rssi)
+{
+	struct net_buf *buf, *rsp = NULL;
+	struct bt_hci_cp_read_rssi *cp;
+	int err;
+
+	buf = bt_hci_cmd_create(BT_HCI_OP_READ_RSSI, sizeof(*cp));
+	if (!buf) {
+		LOG_ERR("Unable to allocate command buffer");
+		return -ENOMEM;
+	}
+
+	cp = net_buf_add(buf, sizeof(*cp));
+	lcs_hci_read_rssi_encode(cp, handle);
+
+	err = bt_hci_cmd_send_sync(BT_HCI_OP_READ_RSSI, buf, &rsp);
+	if (err < 0) {
+		uint8_t reason = rsp ? lcs_hci_status(rsp->data, rsp->len) : 0;
+		LOG_ERR("Read RSSI err: %d reason 0x%02x", err, reason);
+		if (rsp) {
+			net_buf_unref(rsp);
+		}
+		return err;
+	}
+
+	err = lcs_hci_read_rssi_decode(rsp->data, rsp->len, rssi);
+	net_buf_unref(rsp);
+	return err;
+}
+
+static int hci_write_tx_power(uint8_t handle_type, uint16_t handle, int8_t tx_pwr_lvl,
+			      int8_t *selected)
+{
+	struct bt_hci_cp_vs_write_tx_power_level *cp;
+	struct net_buf *buf, *rsp = NULL;
+	int err = 0;
+
+	buf = bt_hci_cmd_create(BT_HCI_OP_VS_WRITE_TX_POWER_LEVEL,
+				sizeof(*cp));
+	if (!buf) {
+		LOG_ERR("Unable to allocate command buffer");
+		return -ENOMEM;
+	}
+
+	cp = net_buf_add(buf, sizeof(*cp));
+	lcs_hci_tx_power_encode(cp, handle_type, handle, tx_pwr_lvl);
+
+	err = bt_hci_cmd_send_sync(BT_HCI_OP_VS_WRITE_TX_POWER_LEVEL,
+				   buf, &rsp);
+	if (err < 0) {
+		uint8_t reason = rsp ? lcs_hci_status(rsp->data, rsp->len) : 0;
+		LOG_ERR("Failed to set TX power for handle type %d, handle: %d, err: %d, reason: %d", \
+				handle_type, handle, err, reason);
+		if (rsp) {
+			net_buf_unref(rsp);
+		}
+		return err;
+	}
+
+	err = lcs_hci_tx_power_decode(rsp->data, rsp->len, selected);
+	if (err == 0) {
+		LOG_INF("Actual TX power: %d", *selected);
+	}
+
+	net_buf_unref(rsp);
+	return err;
+}
+
+/*
+ * Asynchronous command queue. Requests are executed one at a time on a
+ * dedicated work queue so callers in the system work queue or the BT RX
+ * thread never block on the controller. A request for a command that is
+ * already pending for the same handle replaces the pending one.
+ */
+enum hci_cmd_type {
+	HCI_CMD_TX_POWER,
+	HCI_CMD_READ_RSSI,
+	HCI_CMD_CONN_UPDATE,
+};
+
+struct hci_cmd_req {
+	sys_snode_t node;
+	enum hci_cmd_type type;
+	uint8_t handle_type;
+	uint16_t handle;
+	union {
+		int8_t tx_power;
+		struct {
+			uint32_t interval_us;
+			uint16_t latency;
+			uint16_t timeout;
+		} conn;
+	} param;
+	link_control_cb_t cb;
+	void *user_data;
+};
+
+K_MEM_SLAB_DEFINE_STATIC(hci_req_slab, sizeof(struct hci_cmd_req),
+			 CONFIG_LCS_HCI_QUEUE_SIZE, 4);
+static sys_slist_t hci_pending = SYS_SLIST_STATIC_INIT(&hci_pending);
+static struct k_spinlock hci_lock;
+
+static struct k_work_q hci_workq;
+static K_THREAD_STACK_DEFINE(hci_workq_stack, CONFIG_LCS_HCI_WORKQ_STACK_SIZE);
+
+static void hci_cmd_execute(const struct hci_cmd_req *req)
+{
+	int8_t value = 0;
+	int err;
+
+	switch (req->type) {
+	case HCI_CMD_TX_POWER:
+		err = hci_write_tx_power(req->handle_type, req->handle,
+					 req->param.tx_power, &value);
+		break;
+	case HCI_CMD_READ_RSSI:
+		err = hci_read_rssi(req->handle, &value);
+		break;
+	case HCI_CMD_CONN_UPDATE:
+		err = hci_conn_update(req->handle, req->param.conn.interval_us,
+				      req->param.conn.latency, req->param.conn.timeout);
+		break;
+	default:
+		err = -EINVAL;
+		break;
+	}
+
+	if (req->cb) {
+		req->cb(err, value, req->user_data);
+	}
+}
+
+static void hci_work_handler(struct k_work *work)
+{
+	sys_snode_t *node;
+	k_spinlock_key_t key;
+
+	while (true) {
+		key = k_spin_lock(&hci_lock);
+		node = sys_slist_get(&hci_pending);
+		k_spin_unlock(&hci_lock, key);
+
+		if (!node) {
+			return;
+		}
+
+		struct hci_cmd_req *req = CONTAINER_OF(node, struct hci_cmd_req, node);
+
+		hci_cmd_execute(req);
+		k_mem_slab_free(&hci_req_slab, req);
+	}
+}
+
+static K_WORK_DEFINE(hci_work, hci_work_handler);
+
+static int hci_cmd_submit(const struct hci_cmd_req *new_req)
+{
+	struct hci_cmd_req *req;
+	link_control_cb_t superseded_cb = NULL;
+	void *superseded_user_data = NULL;
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&hci_lock);
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&hci_pending, req, node) {
+		if (req->type == new_req->type &&
+		    req->handle_type == new_req->handle_type &&
+		    req->handle == new_req->handle) {
+			superseded_cb = req->cb;
+			superseded_user_data = req->user_data;
+			req->param = new_req->param;
+			req->cb = new_req->cb;
+			req->user_data = new_req->user_data;
+			k_spin_unlock(&hci_lock, key);
+
+			if (superseded_cb) {
+				superseded_cb(-ECANCELED, 0, superseded_user_data);
+			}
+			return 0;
+		}
+	}
+
+	if (k_mem_slab_alloc(&hci_req_slab, (void **)&req, K_NO_WAIT)) {
+		k_spin_unlock(&hci_lock, key);
+		LOG_WRN("HCI command queue full");
+		return -ENOMEM;
+	}
+
+	*req = *new_req;
+	sys_slist_append(&hci_pending, &req->node);
+	k_spin_unlock(&hci_lock, key);
+
+	k_work_submit_to_queue(&hci_workq, &hci_work);
+	return 0;
+}
+
+int set_tx_power_async(uint8_t handle_type, uint16_t handle, int8_t tx_pwr_lvl,
+		       link_control_cb_t cb, void *user_data)
+{
+	struct hci_cmd_req req = {
+		.type = HCI_CMD_TX_POWER,
+		.handle_type = handle_type,
+		.handle = handle,
+		.param.tx_power = tx_pwr_lvl,
+		.cb = cb,
+		.user_data = user_data,
+	};
+
+	return hci_cmd_submit(&req);
+}
+
+int read_conn_rssi_async(uint16_t handle, link_control_cb_t cb, void *user_data)
+{
+	struct hci_cmd_req req = {
+		.type = HCI_CMD_READ_RSSI,
+		.handle = handle,
+		.cb = cb,
+		.user_data = user_data,
+	};
+
+	return hci_cmd_submit(&req);
+}
+
+int change_conn_params_async(struct bt_conn *conn, uint32_t interval_us, uint16_t latency,
+			     uint16_t timeout, link_control_cb_t cb, void *user_data)
+{
+	uint16_t conn_handle;
+	int err;
+
+	err = bt_hci_get_conn_handle(conn, &conn_handle);
+	if (err < 0) {
+		LOG_ERR("Failed obtaining conn_handle (err %d)", err);
+		return err;
+	}
+
+	struct hci_cmd_req req = {
+		.type = HCI_CMD_CONN_UPDATE,
+		.handle = conn_handle,
+		.param.conn = {
+			.interval_us = interval_us,
+			.latency = latency,
+			.timeout = timeout,
+		},
+		.cb = cb,
+		.user_data = user_data,
+	};
+
+	return hci_cmd_submit(&req);
+}
+
+int change_connection_interval_async(struct bt_conn *conn, uint16_t interval_us,
+				     link_control_cb_t cb, void *user_data)
+{
+	return change_conn_params_async(conn, interval_us, 0, CONN_SUPERVISION_TIMEOUT_DEFAULT,
+					cb, user_data);
+}
+
+int set_tx_power(uint8_t handle_type, uint16_t handle, int8_t tx_pwr_lvl)
+{
+	int8_t selected;
+
+	return hci_write_tx_power(handle_type, handle, tx_pwr_lvl, &selected);
+}
+
+int read_conn_rssi(uint16_t handle, int8_t *rssi)
+{
+	return hci_read_rssi(handle, rssi);
+}
+
+int change_conn_params(struct bt_conn *conn, uint32_t interval_us, uint16_t latency,
+		       uint16_t timeout)
+{
+	int err;
+	uint16_t conn_handle;
+
+	err = bt_hci_get_conn_handle(conn, &conn_handle);
+	if (err < 0) {
+		LOG_ERR("Failed obtaining conn_handle (err %d)", err);
+		return err;
+	}
+
+	return hci_conn_update(conn_handle, interval_us, latency, timeout);
+}
+
+int change_connection_interval(struct bt_conn *conn, uint16_t interval_us)
+{
+	return change_conn_params(conn, interval_us, 0, CONN_SUPERVISION_TIMEOUT_DEFAULT);
+}
+
+static int link_control_init(void)
+{
+	const struct k_work_queue_config cfg = {
+		.name = "lc_hci",
+	};
+
+	k_work_queue_start(&hci_workq, hci_workq_stack,
+			   K_THREAD_STACK_SIZEOF(hci_workq_stack),
+			   CONFIG_LCS_HCI_WORKQ_PRIORITY, &cfg);
+	return 0;
+}
+
+SYS_INIT(link_control_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
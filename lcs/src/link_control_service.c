@@ -0,0 +1,627 @@
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/uuid.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/bluetooth/hci.h>
+#include <zephyr/bluetooth/hci_vs.h>
+
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(bt_lcs, LOG_LEVEL_DBG);
+
+#include "link_control.h"
+#include "link_control_service.h"
+#include "rssi_history.h"
+#include "tx_power_ctrl.h"
+#include "phy_policy.h"
+#include "conn_params.h"
+#include "telemetry.h"
+#include "log_transfer.h"
+#include "throughput.h"
+#include "relay.h"
+#include "link_metrics.h"
+#include "central_peripheral.h"
+
+/*
+ * Index of the throughput characteristic value in lcs_svc.attrs: service,
+ * TX power declaration and value, RSSI declaration, value and CCC, then the
+ * throughput declaration.
+ */
+#define LCS_THROUGHPUT_ATTR_IDX 7
+
+#define CENTRAL_ROLE IS_ENABLED(CONFIG_LCS_ROLE_CENTRAL)
+
+static int8_t tx_power_value = 0;
+
+/* current_tx_power is also used when advertising again */
+static void apply_tx_power(struct bt_conn *conn, int8_t tx_power)
+{
+	uint16_t conn_handle;
+
+	current_tx_power = tx_power;
+
+	bt_hci_get_conn_handle(conn, &conn_handle);
+	set_tx_power_async(BT_HCI_VS_LL_HANDLE_TYPE_CONN, conn_handle, tx_power, NULL, NULL);
+	if (IS_ENABLED(CONFIG_LCS_TX_POWER_CTRL)) {
+		tx_power_ctrl_set_power(conn, tx_power);
+	}
+	if (IS_ENABLED(CONFIG_LCS_TELEMETRY)) {
+		telemetry_tx_power(bt_conn_index(conn), tx_power);
+	}
+
+	LOG_INF("Set tx power to %d", tx_power);
+}
+
+static ssize_t read_tx_power(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                             void *buf, uint16_t len, uint16_t offset)
+{
+    return bt_gatt_attr_read(conn, attr, buf, len, offset, &tx_power_value, sizeof(tx_power_value));
+}
+
+/*
+ * Peripheral role: write {tx_power} to set the power of this link.
+ * Central role: write {tx_power} to set every peripheral, or
+ * {tx_power, link index} for one.
+ */
+static ssize_t write_tx_power(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                              const void *buf, uint16_t len, uint16_t offset, uint8_t flags)
+{
+    const uint8_t *data = buf;
+    uint8_t link_index = LINK_INDEX_ALL;
+
+    if (!CENTRAL_ROLE) {
+        if (offset + len > sizeof(tx_power_value)) {
+            return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+        }
+
+        memcpy(&tx_power_value + offset, buf, len);
+        apply_tx_power(conn, tx_power_value);
+        return len;
+    }
+
+    if (offset != 0 || len < 1 || len > 2) {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+    }
+
+    tx_power_value = (int8_t)data[0];
+    if (len == 2) {
+        link_index = data[1];
+    }
+
+	if (write_tx_power_peripheral(link_index, tx_power_value)) {
+		return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+	}
+	LOG_INF("Set tx power to %d (link 0x%02x)", tx_power_value, link_index);
+
+    return len;
+}
+
+/* Peripheral role: {rssi} of this link. Central role: {rssi, link index} */
+static struct {
+	int8_t rssi;
+	uint8_t link_index;
+} __packed rssi_value;
+
+static ssize_t read_rssi(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+						 void *buf, uint16_t len, uint16_t offset) {
+	return bt_gatt_attr_read(conn, attr, buf, len, offset, &rssi_value,
+				 CENTRAL_ROLE ? sizeof(rssi_value) : sizeof(rssi_value.rssi));
+}
+
+static bool rssi_notif_enabled = false;
+
+static void rssi_ccc_cfg_changed(const struct bt_gatt_attr *attr, uint16_t value)
+{
+    rssi_notif_enabled = (value == BT_GATT_CCC_NOTIFY);
+    LOG_INF("RSSI notifications %s", rssi_notif_enabled ? "enabled" : "disabled");
+}
+
+#if IS_ENABLED(CONFIG_LCS_THROUGHPUT)
+static void throughput_ccc_cfg_changed(const struct bt_gatt_attr *attr, uint16_t value)
+{
+	bool enabled = (value == BT_GATT_CCC_NOTIFY);
+
+	throughput_set_enabled(enabled);
+	LOG_INF("Throughput notifications %s", enabled ? "enabled" : "disabled");
+}
+
+/* Writes without response are only counted, see throughput_rx() */
+static ssize_t write_throughput(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+				const void *buf, uint16_t len, uint16_t offset, uint8_t flags)
+{
+	if (offset != 0) {
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+	}
+
+	throughput_rx(conn, THROUGHPUT_RX_GATT, buf, len);
+	return len;
+}
+#endif
+
+#if IS_ENABLED(CONFIG_LCS_ROLE_CENTRAL)
+/* TX power of the link to the upstream central */
+static int8_t central_tx_power = 0;
+static ssize_t read_tx_power_central(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                             void *buf, uint16_t len, uint16_t offset)
+{
+    return bt_gatt_attr_read(conn, attr, buf, len, offset, &central_tx_power, sizeof(central_tx_power));
+}
+
+static ssize_t write_tx_power_central(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                              const void *buf, uint16_t len, uint16_t offset, uint8_t flags)
+{
+    if (offset + len > sizeof(central_tx_power)) {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+    }
+
+    memcpy(&central_tx_power + offset, buf, len);
+    apply_tx_power(conn, central_tx_power);
+
+    return len;
+}
+
+static int8_t central_rssi_value = 0;
+static ssize_t read_rssi_central(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+						 void *buf, uint16_t len, uint16_t offset) {
+	return bt_gatt_attr_read(conn, attr, buf, len, offset, &central_rssi_value, sizeof(central_rssi_value));
+}
+
+extern struct k_timer central_rssi_timer;
+static bool central_rssi_notif_enabled = false;
+static void rssi_central_ccc_cfg_changed(const struct bt_gatt_attr *attr, uint16_t value)
+{
+    central_rssi_notif_enabled = (value == BT_GATT_CCC_NOTIFY);
+	if (central_rssi_notif_enabled) {
+		k_timer_start(&central_rssi_timer, K_MSEC(500), K_MSEC(500));
+	}
+	else {
+		k_timer_stop(&central_rssi_timer);
+	}
+    LOG_INF("RSSI notifications %s", central_rssi_notif_enabled ? "enabled" : "disabled");
+}
+#endif
+
+#if IS_ENABLED(CONFIG_LCS_RSSI_HISTORY)
+static void rssi_history_ccc_cfg_changed(const struct bt_gatt_attr *attr, uint16_t value)
+{
+	bool enabled = (value == BT_GATT_CCC_NOTIFY);
+
+	rssi_history_set_enabled(enabled);
+	LOG_INF("RSSI history notifications %s", enabled ? "enabled" : "disabled");
+}
+#endif
+
+#if IS_ENABLED(CONFIG_LCS_TX_POWER_CTRL)
+/*
+ * Peripheral role: reads the setpoint of this link. Central role: reads
+ * {link index, setpoint} of every peripheral link, the links writes address.
+ */
+static ssize_t read_tx_power_ctrl(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+				  void *buf, uint16_t len, uint16_t offset)
+{
+	struct tx_power_ctrl_link_cfg cfgs[CONFIG_BT_MAX_CONN];
+	struct tx_power_ctrl_cfg cfg;
+	size_t count;
+
+	if (CENTRAL_ROLE) {
+		count = get_tx_power_ctrl_all(cfgs, ARRAY_SIZE(cfgs));
+		return bt_gatt_attr_read(conn, attr, buf, len, offset, cfgs,
+					 count * sizeof(cfgs[0]));
+	}
+
+	tx_power_ctrl_get(conn, &cfg);
+	return bt_gatt_attr_read(conn, attr, buf, len, offset, &cfg, sizeof(cfg));
+}
+
+/*
+ * Peripheral role: write {enabled, rssi_low, rssi_high} to set the window of
+ * this link. Central role: the same sets the window of every peripheral
+ * link, or {enabled, rssi_low, rssi_high, link index} of one link.
+ */
+static ssize_t write_tx_power_ctrl(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+				   const void *buf, uint16_t len, uint16_t offset, uint8_t flags)
+{
+	const int8_t *data = buf;
+	uint8_t link_index = LINK_INDEX_ALL;
+	int err;
+
+	if (offset != 0 || len < 3 || len > (CENTRAL_ROLE ? 4 : 3)) {
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+	}
+
+	if (len == 4) {
+		link_index = (uint8_t)data[3];
+	}
+
+	if (CENTRAL_ROLE) {
+		err = configure_tx_power_ctrl(link_index, data[0], data[1], data[2]);
+	} else {
+		err = tx_power_ctrl_configure(conn, data[0], data[1], data[2]);
+	}
+	if (err) {
+		return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+	}
+
+	return len;
+}
+#endif
+
+#if IS_ENABLED(CONFIG_LCS_PHY_POLICY)
+/* Central role: last state notified, of whichever peripheral link changed last */
+static struct phy_policy_state phy_state_value;
+
+static ssize_t read_phy_state(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+			      void *buf, uint16_t len, uint16_t offset)
+{
+	struct phy_policy_state state = phy_state_value;
+
+	if (!CENTRAL_ROLE && phy_policy_get(conn, &state)) {
+		return BT_GATT_ERR(BT_ATT_ERR_UNLIKELY);
+	}
+
+	return bt_gatt_attr_read(conn, attr, buf, len, offset, &state, sizeof(state));
+}
+
+static void phy_state_ccc_cfg_changed(const struct bt_gatt_attr *attr, uint16_t value)
+{
+	LOG_INF("PHY state notifications %s",
+		value == BT_GATT_CCC_NOTIFY ? "enabled" : "disabled");
+}
+#endif
+
+#if IS_ENABLED(CONFIG_LCS_CONN_PARAMS)
+/* Reads the parameters of every link, one conn_params_state each */
+static ssize_t read_conn_params(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+				void *buf, uint16_t len, uint16_t offset)
+{
+	struct conn_params_state states[CONFIG_BT_MAX_CONN];
+	size_t count = conn_params_get_all(states, ARRAY_SIZE(states));
+
+	return bt_gatt_attr_read(conn, attr, buf, len, offset, states,
+				 count * sizeof(states[0]));
+}
+
+/*
+ * Peripheral role: write {mode} to select the mode of this link.
+ * Central role: the same selects the mode of every peripheral link, or
+ * {mode, link index} of one link.
+ */
+static ssize_t write_conn_params(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+				 const void *buf, uint16_t len, uint16_t offset, uint8_t flags)
+{
+	const uint8_t *data = buf;
+	uint8_t link_index = LINK_INDEX_ALL;
+	int err;
+
+	if (offset != 0 || len < 1 || len > (CENTRAL_ROLE ? 2 : 1)) {
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+	}
+
+	if (len == 2) {
+		link_index = data[1];
+	}
+
+	if (CENTRAL_ROLE) {
+		err = configure_conn_params(link_index, data[0]);
+	} else {
+		err = conn_params_set_mode(conn, data[0]);
+	}
+	if (err) {
+		return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+	}
+
+	return len;
+}
+#endif
+
+#if IS_ENABLED(CONFIG_LCS_THROUGHPUT_STATS)
+static ssize_t read_throughput_stats(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+				     void *buf, uint16_t len, uint16_t offset)
+{
+	struct throughput_stats stats;
+
+	throughput_stats_get(conn, &stats);
+	return bt_gatt_attr_read(conn, attr, buf, len, offset, &stats, sizeof(stats));
+}
+
+/* Any write clears the statistics of this link */
+static ssize_t write_throughput_stats(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+				      const void *buf, uint16_t len, uint16_t offset,
+				      uint8_t flags)
+{
+	throughput_stats_reset(conn);
+	return len;
+}
+
+/* Reads one throughput_rx_stats per throughput_rx_path */
+static ssize_t read_throughput_rx_stats(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+					void *buf, uint16_t len, uint16_t offset)
+{
+	struct throughput_rx_stats stats[THROUGHPUT_RX_PATHS];
+
+	throughput_rx_stats_get(conn, stats);
+	return bt_gatt_attr_read(conn, attr, buf, len, offset, stats, sizeof(stats));
+}
+#endif
+
+#if IS_ENABLED(CONFIG_LCS_LOG_TRANSFER)
+/* Write a log_transfer_op with its arguments to start or abort a transfer */
+static ssize_t write_log_xfer_cp(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+				 const void *buf, uint16_t len, uint16_t offset, uint8_t flags)
+{
+	int err;
+
+	if (offset != 0) {
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+	}
+
+	if (!bt_gatt_is_subscribed(conn, attr, BT_GATT_CCC_NOTIFY)) {
+		return BT_GATT_ERR(BT_ATT_ERR_CCC_IMPROPER_CONF);
+	}
+
+	err = log_transfer_request(conn, buf, len);
+	if (err == -EINVAL) {
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+	} else if (err) {
+		return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+	}
+
+	return len;
+}
+
+static void log_xfer_ccc_cfg_changed(const struct bt_gatt_attr *attr, uint16_t value)
+{
+	LOG_INF("Log transfer notifications %s",
+		value == BT_GATT_CCC_NOTIFY ? "enabled" : "disabled");
+}
+#endif
+
+#if IS_ENABLED(CONFIG_LCS_RELAY)
+static void relay_ccc_cfg_changed(const struct bt_gatt_attr *attr, uint16_t value)
+{
+	relay_set_enabled(value == BT_GATT_CCC_NOTIFY);
+}
+
+/* Reads the upstream statistics followed by one relay_hop_stats per link */
+static ssize_t read_relay_stats(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+				void *buf, uint16_t len, uint16_t offset)
+{
+	struct {
+		struct relay_upstream_stats upstream;
+		struct relay_hop_stats hops[CONFIG_BT_MAX_CONN];
+	} __packed stats;
+	size_t count = relay_stats_get(&stats.upstream, stats.hops, ARRAY_SIZE(stats.hops));
+
+	return bt_gatt_attr_read(conn, attr, buf, len, offset, &stats,
+				 sizeof(stats.upstream) + count * sizeof(stats.hops[0]));
+}
+
+/* Any write clears the statistics */
+static ssize_t write_relay_stats(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+				 const void *buf, uint16_t len, uint16_t offset, uint8_t flags)
+{
+	relay_stats_reset();
+	return len;
+}
+#endif
+
+#if IS_ENABLED(CONFIG_LCS_LINK_METRICS)
+/* Reads the last closed bucket of every link, one link_metrics each */
+static ssize_t read_link_metrics(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+				 void *buf, uint16_t len, uint16_t offset)
+{
+	struct link_metrics metrics[CONFIG_BT_MAX_CONN];
+	size_t count = link_metrics_get_all(metrics, ARRAY_SIZE(metrics));
+
+	return bt_gatt_attr_read(conn, attr, buf, len, offset, metrics,
+				 count * sizeof(metrics[0]));
+}
+
+static bool link_metrics_notif_enabled;
+
+static void link_metrics_ccc_cfg_changed(const struct bt_gatt_attr *attr, uint16_t value)
+{
+	link_metrics_notif_enabled = (value == BT_GATT_CCC_NOTIFY);
+	LOG_INF("Link metrics notifications %s",
+		link_metrics_notif_enabled ? "enabled" : "disabled");
+}
+#endif
+
+BT_GATT_SERVICE_DEFINE(lcs_svc,
+    BT_GATT_PRIMARY_SERVICE(BT_UUID_LCS),
+    BT_GATT_CHARACTERISTIC(BT_UUID_LCS_TX_PWR,
+                           BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE,
+                           BT_GATT_PERM_READ | BT_GATT_PERM_WRITE,
+                           read_tx_power, write_tx_power, &tx_power_value),
+	BT_GATT_CHARACTERISTIC(BT_UUID_LCS_RSSI,
+						   BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY,
+						   BT_GATT_PERM_READ,
+						   read_rssi, NULL, &rssi_value),
+	BT_GATT_CCC(rssi_ccc_cfg_changed, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+#if IS_ENABLED(CONFIG_LCS_THROUGHPUT)
+	BT_GATT_CHARACTERISTIC(BT_UUID_LCS_THROUGHPUT,
+			       BT_GATT_CHRC_NOTIFY | BT_GATT_CHRC_WRITE_WITHOUT_RESP,
+			       BT_GATT_PERM_WRITE, NULL, write_throughput, NULL),
+	BT_GATT_CCC(throughput_ccc_cfg_changed,
+		    BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+#endif
+#if IS_ENABLED(CONFIG_LCS_ROLE_CENTRAL)
+    BT_GATT_CHARACTERISTIC(BT_UUID_LCS_TX_PWR_CENTRAL,
+                           BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE,
+                           BT_GATT_PERM_READ | BT_GATT_PERM_WRITE,
+                           read_tx_power_central, write_tx_power_central, &central_tx_power),
+	BT_GATT_CHARACTERISTIC(BT_UUID_LCS_RSSI_CENTRAL,
+						   BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY,
+						   BT_GATT_PERM_READ,
+						   read_rssi_central, NULL, &central_rssi_value),
+	BT_GATT_CCC(rssi_central_ccc_cfg_changed, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+#endif
+#if IS_ENABLED(CONFIG_LCS_RSSI_HISTORY)
+	BT_GATT_CHARACTERISTIC(BT_UUID_LCS_RSSI_HISTORY, BT_GATT_CHRC_NOTIFY,
+			       BT_GATT_PERM_NONE, NULL, NULL, NULL),
+	BT_GATT_CCC(rssi_history_ccc_cfg_changed,
+		    BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+#endif
+#if IS_ENABLED(CONFIG_LCS_TX_POWER_CTRL)
+	BT_GATT_CHARACTERISTIC(BT_UUID_LCS_TX_PWR_CTRL,
+			       BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE,
+			       BT_GATT_PERM_READ | BT_GATT_PERM_WRITE,
+			       read_tx_power_ctrl, write_tx_power_ctrl, NULL),
+#endif
+#if IS_ENABLED(CONFIG_LCS_PHY_POLICY)
+	BT_GATT_CHARACTERISTIC(BT_UUID_LCS_PHY_STATE,
+			       BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY,
+			       BT_GATT_PERM_READ, read_phy_state, NULL, NULL),
+	BT_GATT_CCC(phy_state_ccc_cfg_changed,
+		    BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+#endif
+#if IS_ENABLED(CONFIG_LCS_CONN_PARAMS)
+	BT_GATT_CHARACTERISTIC(BT_UUID_LCS_CONN_PARAMS,
+			       BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE,
+			       BT_GATT_PERM_READ | BT_GATT_PERM_WRITE,
+			       read_conn_params, write_conn_params, NULL),
+#endif
+#if IS_ENABLED(CONFIG_LCS_THROUGHPUT_STATS)
+	BT_GATT_CHARACTERISTIC(BT_UUID_LCS_THROUGHPUT_STATS,
+			       BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE,
+			       BT_GATT_PERM_READ | BT_GATT_PERM_WRITE,
+			       read_throughput_stats, write_throughput_stats, NULL),
+	BT_GATT_CHARACTERISTIC(BT_UUID_LCS_THROUGHPUT_RX_STATS, BT_GATT_CHRC_READ,
+			       BT_GATT_PERM_READ, read_throughput_rx_stats, NULL, NULL),
+#endif
+#if IS_ENABLED(CONFIG_LCS_LOG_TRANSFER)
+	BT_GATT_CHARACTERISTIC(BT_UUID_LCS_LOG_XFER_CP,
+			       BT_GATT_CHRC_WRITE | BT_GATT_CHRC_NOTIFY,
+			       BT_GATT_PERM_WRITE, NULL, write_log_xfer_cp, NULL),
+	BT_GATT_CCC(log_xfer_ccc_cfg_changed,
+		    BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+	BT_GATT_CHARACTERISTIC(BT_UUID_LCS_LOG_XFER_DATA, BT_GATT_CHRC_NOTIFY,
+			       BT_GATT_PERM_NONE, NULL, NULL, NULL),
+	BT_GATT_CCC(log_xfer_ccc_cfg_changed,
+		    BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+#endif
+#if IS_ENABLED(CONFIG_LCS_RELAY)
+	BT_GATT_CHARACTERISTIC(BT_UUID_LCS_RELAY, BT_GATT_CHRC_NOTIFY,
+			       BT_GATT_PERM_NONE, NULL, NULL, NULL),
+	BT_GATT_CCC(relay_ccc_cfg_changed,
+		    BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+	BT_GATT_CHARACTERISTIC(BT_UUID_LCS_RELAY_STATS,
+			       BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE,
+			       BT_GATT_PERM_READ | BT_GATT_PERM_WRITE,
+			       read_relay_stats, write_relay_stats, NULL),
+#endif
+#if IS_ENABLED(CONFIG_LCS_LINK_METRICS)
+	BT_GATT_CHARACTERISTIC(BT_UUID_LCS_LINK_METRICS,
+			       BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY,
+			       BT_GATT_PERM_READ, read_link_metrics, NULL, NULL),
+	BT_GATT_CCC(link_metrics_ccc_cfg_changed,
+		    BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+#endif
+);
+
+void update_rssi(struct bt_conn *conn, int16_t new_rssi) {
+	if (rssi_notif_enabled) {
+		rssi_value.rssi = new_rssi;
+		bt_gatt_notify_uuid(conn, BT_UUID_LCS_RSSI, lcs_svc.attrs, &rssi_value,
+				    sizeof(rssi_value.rssi));
+	}
+}
+
+#if IS_ENABLED(CONFIG_LCS_ROLE_CENTRAL)
+void update_peripheral_rssi(struct bt_conn *conn, int16_t new_rssi, uint8_t link_index) {
+	if (rssi_notif_enabled) {
+		rssi_value.rssi = new_rssi;
+		rssi_value.link_index = link_index;
+		bt_gatt_notify_uuid(conn, BT_UUID_LCS_RSSI, lcs_svc.attrs, &rssi_value,
+				    sizeof(rssi_value));
+	}
+}
+
+void update_central_rssi(struct bt_conn *conn, int16_t new_rssi) {
+	if (central_rssi_notif_enabled) {
+		central_rssi_value = new_rssi;
+		bt_gatt_notify_uuid(conn, BT_UUID_LCS_RSSI_CENTRAL, lcs_svc.attrs, &central_rssi_value, \
+				sizeof(central_rssi_value));
+	}
+}
+#endif
+
+#if IS_ENABLED(CONFIG_LCS_THROUGHPUT)
+int notify_throughput(struct bt_conn *conn, const void *data, uint16_t len,
+		      bt_gatt_complete_func_t func, void *user_data)
+{
+	struct bt_gatt_notify_params params = {
+		.attr = &lcs_svc.attrs[LCS_THROUGHPUT_ATTR_IDX],
+		.data = data,
+		.len = len,
+		.func = func,
+		.user_data = user_data,
+	};
+
+	return bt_gatt_notify_cb(conn, &params);
+}
+#endif
+
+int notify_rssi_history(struct bt_conn *conn, const void *data, uint16_t len)
+{
+	return bt_gatt_notify_uuid(conn, BT_UUID_LCS_RSSI_HISTORY, lcs_svc.attrs, data, len);
+}
+
+#if IS_ENABLED(CONFIG_LCS_PHY_POLICY)
+/* The central role notifies the state of a peripheral link to its own central */
+int notify_phy_state(struct bt_conn *conn, const void *data, uint16_t len)
+{
+	if (CENTRAL_ROLE) {
+		memcpy(&phy_state_value, data, MIN(len, sizeof(phy_state_value)));
+		conn = NULL;
+	}
+	return bt_gatt_notify_uuid(conn, BT_UUID_LCS_PHY_STATE, lcs_svc.attrs, data, len);
+}
+#endif
+
+#if IS_ENABLED(CONFIG_LCS_LOG_TRANSFER)
+int notify_log_xfer_cp(struct bt_conn *conn, const void *data, uint16_t len)
+{
+	return bt_gatt_notify_uuid(conn, BT_UUID_LCS_LOG_XFER_CP, lcs_svc.attrs, data, len);
+}
+
+int notify_log_xfer_data(struct bt_conn *conn, const void *data, uint16_t len,
+			 bt_gatt_complete_func_t func)
+{
+	struct bt_gatt_notify_params params = {
+		.uuid = BT_UUID_LCS_LOG_XFER_DATA,
+		.attr = lcs_svc.attrs,
+		.data = data,
+		.len = len,
+		.func = func,
+	};
+
+	return bt_gatt_notify_cb(conn, &params);
+}
+#endif
+
+#if IS_ENABLED(CONFIG_LCS_RELAY)
+int notify_relay(struct bt_conn *conn, const void *data, uint16_t len,
+		 bt_gatt_complete_func_t func, void *user_data)
+{
+	struct bt_gatt_notify_params params = {
+		.uuid = BT_UUID_LCS_RELAY,
+		.attr = lcs_svc.attrs,
+		.data = data,
+		.len = len,
+		.func = func,
+		.user_data = user_data,
+	};
+
+	return bt_gatt_notify_cb(conn, &params);
+}
+#endif
+
+#if IS_ENABLED(CONFIG_LCS_LINK_METRICS)
+int notify_link_metrics(const void *data, uint16_t len)
+{
+	if (!link_metrics_notif_enabled) {
+		return 0;
+	}
+	return bt_gatt_notify_uuid(NULL, BT_UUID_LCS_LINK_METRICS, lcs_svc.attrs, data, len);
+}
+#endif
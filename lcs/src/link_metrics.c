@@ -0,0 +1,300 @@
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/shell/shell.h>
+
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(link_metrics, LOG_LEVEL_INF);
+
+#include "link_control_service.h"
+#include "link_metrics.h"
+
+#define BUCKET_MS CONFIG_LCS_LINK_METRICS_BUCKET_MS
+#define BUCKETS   CONFIG_LCS_LINK_METRICS_BUCKETS
+
+/* L2CAP and ATT headers in front of every stream packet */
+#define STREAM_HDR_LEN   7
+#define DATA_LEN_DEFAULT 27
+
+/*
+ * Counters of one bucket. They are summed from connection event reports in
+ * the Bluetooth RX thread and from the streams' completion callbacks, and
+ * every bucket is closed by the system work queue at the same time for all
+ * links. The controller does not report payload sizes, so the PDUs that
+ * carried data are estimated from the stream bytes and the data length.
+ */
+struct bucket {
+	uint32_t start_ms;
+	uint32_t duration_ms;
+	uint32_t events;
+	uint32_t missed;
+	uint32_t skipped;
+	uint32_t tx_packets;
+	uint32_t tx_acks;
+	uint32_t rx_packets;
+	uint32_t crc_errors;
+	uint32_t tx_data_pdus;
+	uint32_t bytes;
+};
+
+struct metrics_link {
+	bool active;
+	bool have_counter;
+	uint16_t last_counter;
+	uint16_t tx_octets;
+	struct bucket current;
+	struct bucket history[BUCKETS];
+	uint8_t head;
+	uint8_t count;
+};
+
+static struct metrics_link links[CONFIG_BT_MAX_CONN];
+static struct k_spinlock metrics_lock;
+
+static void rotate_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(rotate_work, rotate_work_handler);
+
+static void bucket_export(uint8_t index, const struct bucket *b, struct link_metrics *m)
+{
+	uint32_t received = b->rx_packets + b->crc_errors;
+	uint32_t data_pdus = MIN(b->tx_data_pdus, b->tx_acks);
+
+	m->link_index = index;
+	m->start_ms = b->start_ms;
+	m->duration_ms = MIN(b->duration_ms, UINT16_MAX);
+	m->events = MIN(b->events, UINT16_MAX);
+	m->missed_events = MIN(b->missed, UINT16_MAX);
+	m->skipped_events = MIN(b->skipped, UINT16_MAX);
+	m->tx_packets = MIN(b->tx_packets, UINT16_MAX);
+	m->retransmits = MIN(b->tx_packets - MIN(b->tx_acks, b->tx_packets), UINT16_MAX);
+	m->rx_packets = MIN(b->rx_packets, UINT16_MAX);
+	m->crc_errors = MIN(b->crc_errors, UINT16_MAX);
+	m->per_percent = received ? b->crc_errors * 100 / received : 0;
+	m->empty_permille = b->tx_acks ? (b->tx_acks - data_pdus) * 1000 / b->tx_acks : 0;
+	m->bytes_per_event = b->events ? MIN(b->bytes / b->events, UINT16_MAX) : 0;
+}
+
+static void rotate_work_handler(struct k_work *work)
+{
+	struct link_metrics closed[CONFIG_BT_MAX_CONN];
+	uint32_t now = k_uptime_get_32();
+	size_t count = 0;
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&metrics_lock);
+	for (size_t i = 0; i < ARRAY_SIZE(links); i++) {
+		struct metrics_link *link = &links[i];
+
+		if (!link->active) {
+			continue;
+		}
+
+		link->current.duration_ms = now - link->current.start_ms;
+		link->history[link->head] = link->current;
+		link->head = (link->head + 1) % BUCKETS;
+		link->count = MIN(link->count + 1, BUCKETS);
+		bucket_export(i, &link->current, &closed[count++]);
+
+		memset(&link->current, 0, sizeof(link->current));
+		link->current.start_ms = now;
+	}
+	k_spin_unlock(&metrics_lock, key);
+
+	for (size_t i = 0; i < count; i++) {
+		notify_link_metrics(&closed[i], sizeof(closed[i]));
+	}
+
+	if (count) {
+		k_work_schedule(&rotate_work, K_MSEC(BUCKET_MS));
+	}
+}
+
+void link_metrics_report(uint8_t index, const struct lcs_hci_qos_report *report)
+{
+	struct metrics_link *link = &links[index];
+	struct bucket *b = &link->current;
+	k_spinlock_key_t key = k_spin_lock(&metrics_lock);
+
+	if (!link->active) {
+		goto unlock;
+	}
+
+	/* Reports only come for events that took place, latency skips the rest */
+	if (link->have_counter) {
+		b->skipped += (uint16_t)(report->event_counter - link->last_counter - 1);
+	}
+	link->last_counter = report->event_counter;
+	link->have_counter = true;
+
+	b->events++;
+	if (!report->rx_packets) {
+		b->missed++;
+	}
+	b->tx_packets += report->tx_packets;
+	b->tx_acks += report->tx_acks;
+	b->rx_packets += report->rx_packets;
+	b->crc_errors += report->crc_errors;
+
+unlock:
+	k_spin_unlock(&metrics_lock, key);
+}
+
+void link_metrics_tx(struct bt_conn *conn, uint16_t len)
+{
+	struct metrics_link *link = &links[bt_conn_index(conn)];
+	k_spinlock_key_t key = k_spin_lock(&metrics_lock);
+
+	if (link->active) {
+		link->current.tx_data_pdus += DIV_ROUND_UP(len + STREAM_HDR_LEN, link->tx_octets);
+		link->current.bytes += len;
+	}
+	k_spin_unlock(&metrics_lock, key);
+}
+
+void link_metrics_rx(struct bt_conn *conn, uint16_t len)
+{
+	struct metrics_link *link = &links[bt_conn_index(conn)];
+	k_spinlock_key_t key = k_spin_lock(&metrics_lock);
+
+	if (link->active) {
+		link->current.bytes += len;
+	}
+	k_spin_unlock(&metrics_lock, key);
+}
+
+size_t link_metrics_get_all(struct link_metrics *metrics, size_t max)
+{
+	k_spinlock_key_t key = k_spin_lock(&metrics_lock);
+	size_t count = 0;
+
+	for (size_t i = 0; i < ARRAY_SIZE(links) && count < max; i++) {
+		struct metrics_link *link = &links[i];
+
+		if (link->active && link->count) {
+			bucket_export(i, &link->history[(link->head + BUCKETS - 1) % BUCKETS],
+				      &metrics[count++]);
+		}
+	}
+	k_spin_unlock(&metrics_lock, key);
+
+	return count;
+}
+
+size_t link_metrics_history(uint8_t index, struct link_metrics *metrics, size_t max)
+{
+	struct metrics_link *link;
+	k_spinlock_key_t key;
+	size_t count;
+
+	if (index >= ARRAY_SIZE(links)) {
+		return 0;
+	}
+
+	link = &links[index];
+	key = k_spin_lock(&metrics_lock);
+	count = MIN(link->count, max);
+	for (size_t i = 0; i < count; i++) {
+		bucket_export(index, &link->history[(link->head + BUCKETS - count + i) % BUCKETS],
+			      &metrics[i]);
+	}
+	k_spin_unlock(&metrics_lock, key);
+
+	return count;
+}
+
+static void connected(struct bt_conn *conn, uint8_t err)
+{
+	struct metrics_link *link = &links[bt_conn_index(conn)];
+	uint16_t tx_octets = DATA_LEN_DEFAULT;
+	k_spinlock_key_t key;
+
+	if (err) {
+		return;
+	}
+
+#if IS_ENABLED(CONFIG_BT_USER_DATA_LEN_UPDATE)
+	struct bt_conn_info info;
+
+	if (!bt_conn_get_info(conn, &info)) {
+		tx_octets = info.le.data_len->tx_max_len;
+	}
+#endif
+
+	key = k_spin_lock(&metrics_lock);
+	memset(link, 0, sizeof(*link));
+	link->tx_octets = tx_octets;
+	link->current.start_ms = k_uptime_get_32();
+	link->active = true;
+	k_spin_unlock(&metrics_lock, key);
+
+	k_work_schedule(&rotate_work, K_MSEC(BUCKET_MS));
+}
+
+static void disconnected(struct bt_conn *conn, uint8_t reason)
+{
+	k_spinlock_key_t key = k_spin_lock(&metrics_lock);
+
+	links[bt_conn_index(conn)].active = false;
+	k_spin_unlock(&metrics_lock, key);
+}
+
+#if IS_ENABLED(CONFIG_BT_USER_DATA_LEN_UPDATE)
+static void le_data_len_updated(struct bt_conn *conn, struct bt_conn_le_data_len_info *info)
+{
+	k_spinlock_key_t key = k_spin_lock(&metrics_lock);
+
+	links[bt_conn_index(conn)].tx_octets = info->tx_max_len;
+	k_spin_unlock(&metrics_lock, key);
+}
+#endif
+
+BT_CONN_CB_DEFINE(link_metrics_callbacks) = {
+	.connected = connected,
+	.disconnected = disconnected,
+#if IS_ENABLED(CONFIG_BT_USER_DATA_LEN_UPDATE)
+	.le_data_len_updated = le_data_len_updated,
+#endif
+};
+
+#if defined(CONFIG_SHELL)
+static void print_metrics(const struct shell *shell, const struct link_metrics *m)
+{
+	shell_print(shell, "%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u.%u,%u", m->link_index,
+		    m->start_ms, m->duration_ms, m->events, m->missed_events,
+		    m->skipped_events, m->tx_packets, m->retransmits, m->rx_packets,
+		    m->crc_errors, m->per_percent, m->empty_permille / 10,
+		    m->empty_permille % 10, m->bytes_per_event);
+}
+
+/* Buckets of every link, or of the link given, oldest first */
+static int cmd_link_metrics(const struct shell *shell, size_t argc, char **argv)
+{
+	struct link_metrics metrics[BUCKETS];
+	uint8_t first = 0;
+	uint8_t last = ARRAY_SIZE(links) - 1;
+
+	if (argc > 1) {
+		first = last = strtoul(argv[1], NULL, 0);
+		if (first >= ARRAY_SIZE(links)) {
+			shell_error(shell, "Invalid link index");
+			return -EINVAL;
+		}
+	}
+
+	shell_print(shell, "link,start_ms,duration_ms,events,missed,skipped,tx_packets,"
+		    "retransmits,rx_packets,crc_errors,per_pct,empty_pct,bytes_per_event");
+	for (uint8_t i = first; i <= last; i++) {
+		size_t count = link_metrics_history(i, metrics, ARRAY_SIZE(metrics));
+
+		for (size_t j = 0; j < count; j++) {
+			print_metrics(shell, &metrics[j]);
+		}
+	}
+	return 0;
+}
+
+SHELL_CMD_ARG_REGISTER(link_metrics, NULL, "Show link quality per time bucket [link]",
+		       cmd_link_metrics, 1, 1);
+#endif
@@ -0,0 +1,396 @@
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gap.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/shell/shell.h>
+
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(link_setup, LOG_LEVEL_INF);
+
+#include "link_control.h"
+#include "conn_params.h"
+#include "link_setup.h"
+#include "fast_reconnect.h"
+
+#define CONN_INTERVAL_UNIT_US 1250
+
+/*
+ * Every new link runs MTU exchange, data length update, PHY update and the
+ * connection parameters of its mode, one after the other, so at most one LL
+ * control procedure is open on the link at a time. Each step ends with its
+ * completion callback, or after CONFIG_LCS_LINK_SETUP_STEP_TIMEOUT_MS when
+ * the peer does not answer or nothing changed. On links where we are the
+ * peripheral, the LL steps also wait CONFIG_LCS_LINK_SETUP_PERIPHERAL_DELAY_MS
+ * after the connection, which gives the central the first go; whatever it
+ * already negotiated is then skipped instead of colliding with it.
+ *
+ * Steps are started from the system work queue. Completion callbacks come
+ * from the Bluetooth RX thread and only end the current step and reschedule
+ * the work.
+ */
+struct setup_link {
+	struct bt_conn *conn;
+	struct k_work_delayable work;
+	enum link_setup_step step;
+	bool waiting;
+	bool peripheral;
+	bool valid;
+	uint8_t phy;
+	uint16_t data_len;
+	int64_t connected_ms;
+	struct bt_gatt_exchange_params mtu_params;
+	struct link_setup_result result;
+};
+
+static struct setup_link setup_links[CONFIG_BT_MAX_CONN];
+static struct k_spinlock setup_lock;
+
+static const char *const step_str[] = {
+	[LINK_SETUP_MTU] = "mtu",
+	[LINK_SETUP_DATA_LEN] = "data_len",
+	[LINK_SETUP_PHY] = "phy",
+	[LINK_SETUP_CONN_PARAMS] = "conn_params",
+};
+
+static const char *const status_str[] = {
+	[LINK_SETUP_PENDING] = "pending",
+	[LINK_SETUP_DONE] = "done",
+	[LINK_SETUP_SKIPPED] = "skipped",
+	[LINK_SETUP_FAILED] = "failed",
+	[LINK_SETUP_TIMEOUT] = "timeout",
+};
+
+static struct setup_link *link_get(struct bt_conn *conn)
+{
+	struct setup_link *link = &setup_links[bt_conn_index(conn)];
+
+	return link->conn == conn ? link : NULL;
+}
+
+static uint16_t since_connected(const struct setup_link *link)
+{
+	return MIN(k_uptime_get() - link->connected_ms, UINT16_MAX);
+}
+
+/* End the current step, called with setup_lock held */
+static void step_end_locked(struct setup_link *link, enum link_setup_status status)
+{
+	link->result.status[link->step] = status;
+	link->result.end_ms[link->step] = since_connected(link);
+	link->waiting = false;
+	link->step++;
+}
+
+/* Completion of a procedure: ends step if it is the one waiting */
+static void step_complete(struct bt_conn *conn, enum link_setup_step step,
+			  enum link_setup_status status)
+{
+	struct setup_link *link = link_get(conn);
+	k_spinlock_key_t key;
+	bool ended = false;
+
+	if (!link) {
+		return;
+	}
+
+	key = k_spin_lock(&setup_lock);
+	if (link->waiting && link->step == step) {
+		step_end_locked(link, status);
+		ended = true;
+	}
+	k_spin_unlock(&setup_lock, key);
+
+	if (ended) {
+		k_work_reschedule(&link->work, K_NO_WAIT);
+	}
+}
+
+#if IS_ENABLED(CONFIG_BT_GATT_CLIENT)
+static void mtu_exchanged(struct bt_conn *conn, uint8_t err,
+			  struct bt_gatt_exchange_params *params)
+{
+	step_complete(conn, LINK_SETUP_MTU, err ? LINK_SETUP_FAILED : LINK_SETUP_DONE);
+}
+#endif
+
+/* Start a step, returns LINK_SETUP_PENDING while its procedure runs */
+static enum link_setup_status step_run(struct setup_link *link)
+{
+	struct bt_conn_info info;
+	int err;
+
+	if (bt_conn_get_info(link->conn, &info)) {
+		return LINK_SETUP_FAILED;
+	}
+
+	switch (link->step) {
+	case LINK_SETUP_MTU:
+#if IS_ENABLED(CONFIG_BT_GATT_CLIENT)
+		link->mtu_params.func = mtu_exchanged;
+		err = bt_gatt_exchange_mtu(link->conn, &link->mtu_params);
+		if (err == -EALREADY) {
+			return LINK_SETUP_SKIPPED;
+		}
+		return err ? LINK_SETUP_FAILED : LINK_SETUP_PENDING;
+#else
+		return LINK_SETUP_SKIPPED;
+#endif
+
+	case LINK_SETUP_DATA_LEN:
+#if IS_ENABLED(CONFIG_BT_USER_DATA_LEN_UPDATE)
+		if (info.le.data_len->tx_max_len >= link->data_len) {
+			return LINK_SETUP_SKIPPED;
+		}
+
+		err = bt_conn_le_data_len_update(link->conn, BT_LE_DATA_LEN_PARAM(
+			link->data_len, BT_GAP_DATA_TIME_MAX));
+		return err ? LINK_SETUP_FAILED : LINK_SETUP_PENDING;
+#else
+		return LINK_SETUP_SKIPPED;
+#endif
+
+	case LINK_SETUP_PHY:
+#if IS_ENABLED(CONFIG_BT_USER_PHY_UPDATE)
+		/* The PHY policy owns the PHY of the link when it is built */
+		if (IS_ENABLED(CONFIG_LCS_PHY_POLICY) || !link->phy ||
+		    (info.le.phy->tx_phy == link->phy && info.le.phy->rx_phy == link->phy)) {
+			return LINK_SETUP_SKIPPED;
+		}
+
+		err = update_phy(link->conn, link->phy);
+		return err ? LINK_SETUP_FAILED : LINK_SETUP_PENDING;
+#else
+		return LINK_SETUP_SKIPPED;
+#endif
+
+	case LINK_SETUP_CONN_PARAMS:
+		if (!IS_ENABLED(CONFIG_LCS_CONN_PARAMS)) {
+			return LINK_SETUP_SKIPPED;
+		}
+
+		err = conn_params_release(link->conn);
+		if (err == -EALREADY) {
+			return LINK_SETUP_SKIPPED;
+		}
+		return err ? LINK_SETUP_FAILED : LINK_SETUP_PENDING;
+
+	default:
+		return LINK_SETUP_FAILED;
+	}
+}
+
+static void setup_finish(struct setup_link *link)
+{
+	struct link_setup_result *r = &link->result;
+	struct bt_conn_info info;
+
+	r->mtu = bt_gatt_get_mtu(link->conn);
+	if (!bt_conn_get_info(link->conn, &info)) {
+		r->interval_us = info.le.interval * CONN_INTERVAL_UNIT_US;
+#if IS_ENABLED(CONFIG_BT_USER_DATA_LEN_UPDATE)
+		r->tx_octets = info.le.data_len->tx_max_len;
+#endif
+#if IS_ENABLED(CONFIG_BT_USER_PHY_UPDATE)
+		r->tx_phy = info.le.phy->tx_phy;
+#endif
+	}
+
+	LOG_INF("Link %u set up in %u ms: mtu %s %u ms, data_len %s %u ms, phy %s %u ms, "
+		"conn_params %s %u ms", r->link_index, r->end_ms[LINK_SETUP_STEPS - 1],
+		status_str[r->status[LINK_SETUP_MTU]],
+		r->end_ms[LINK_SETUP_MTU] - r->start_ms[LINK_SETUP_MTU],
+		status_str[r->status[LINK_SETUP_DATA_LEN]],
+		r->end_ms[LINK_SETUP_DATA_LEN] - r->start_ms[LINK_SETUP_DATA_LEN],
+		status_str[r->status[LINK_SETUP_PHY]],
+		r->end_ms[LINK_SETUP_PHY] - r->start_ms[LINK_SETUP_PHY],
+		status_str[r->status[LINK_SETUP_CONN_PARAMS]],
+		r->end_ms[LINK_SETUP_CONN_PARAMS] - r->start_ms[LINK_SETUP_CONN_PARAMS]);
+	LOG_INF("Link %u: mtu %u, tx octets %u, phy %u, interval %u us", r->link_index, r->mtu,
+		r->tx_octets, r->tx_phy, r->interval_us);
+}
+
+static void setup_work_handler(struct k_work *work)
+{
+	struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+	struct setup_link *link = CONTAINER_OF(dwork, struct setup_link, work);
+	enum link_setup_status status;
+	k_spinlock_key_t key;
+	int64_t hold_ms;
+
+	if (!link->conn) {
+		return;
+	}
+
+	/* Still waiting means the step in progress timed out */
+	key = k_spin_lock(&setup_lock);
+	if (link->waiting) {
+		LOG_WRN("Link %u: %s timed out", link->result.link_index, step_str[link->step]);
+		step_end_locked(link, LINK_SETUP_TIMEOUT);
+	}
+	k_spin_unlock(&setup_lock, key);
+
+	while (link->step < LINK_SETUP_STEPS) {
+		hold_ms = link->connected_ms + CONFIG_LCS_LINK_SETUP_PERIPHERAL_DELAY_MS -
+			  k_uptime_get();
+		if (link->peripheral && link->step != LINK_SETUP_MTU && hold_ms > 0) {
+			k_work_schedule(&link->work, K_MSEC(hold_ms));
+			return;
+		}
+
+		key = k_spin_lock(&setup_lock);
+		link->result.start_ms[link->step] = since_connected(link);
+		link->waiting = true;
+		k_spin_unlock(&setup_lock, key);
+
+		status = step_run(link);
+		if (status == LINK_SETUP_PENDING) {
+			/* Does not move a reschedule by an early completion */
+			k_work_schedule(&link->work, K_MSEC(CONFIG_LCS_LINK_SETUP_STEP_TIMEOUT_MS));
+			return;
+		}
+
+		key = k_spin_lock(&setup_lock);
+		if (link->waiting) {
+			step_end_locked(link, status);
+		}
+		k_spin_unlock(&setup_lock, key);
+	}
+
+	if (!link->valid) {
+		link->valid = true;
+		setup_finish(link);
+	}
+}
+
+void link_setup_start(struct bt_conn *conn)
+{
+	struct setup_link *link = &setup_links[bt_conn_index(conn)];
+	struct fast_reconnect_params cached;
+	struct bt_conn_info info;
+
+	if (bt_conn_get_info(conn, &info)) {
+		return;
+	}
+
+	link->phy = CONFIG_LCS_LINK_SETUP_PHY;
+	link->data_len = CONFIG_LCS_LINK_SETUP_DATA_LEN;
+
+	/* A peer coming back gets what its last link ended with */
+	if (IS_ENABLED(CONFIG_LCS_FAST_RECONNECT) &&
+	    !fast_reconnect_get(bt_conn_get_dst(conn), &cached)) {
+		if (cached.tx_phy) {
+			link->phy = cached.tx_phy;
+		}
+		if (cached.tx_octets) {
+			link->data_len = cached.tx_octets;
+		}
+	}
+
+	k_work_init_delayable(&link->work, setup_work_handler);
+	memset(&link->result, 0, sizeof(link->result));
+	link->result.link_index = bt_conn_index(conn);
+	link->step = LINK_SETUP_MTU;
+	link->waiting = false;
+	link->valid = false;
+	link->peripheral = info.role == BT_CONN_ROLE_PERIPHERAL;
+	link->connected_ms = k_uptime_get();
+	link->conn = bt_conn_ref(conn);
+
+	k_work_schedule(&link->work, K_NO_WAIT);
+}
+
+void link_setup_stop(struct bt_conn *conn)
+{
+	struct setup_link *link = link_get(conn);
+	struct k_work_sync sync;
+
+	if (link) {
+		k_work_cancel_delayable_sync(&link->work, &sync);
+		bt_conn_unref(link->conn);
+		link->conn = NULL;
+	}
+}
+
+int link_setup_get(uint8_t index, struct link_setup_result *result)
+{
+	if (index >= ARRAY_SIZE(setup_links) ||
+	    (!setup_links[index].conn && !setup_links[index].valid)) {
+		return -ENOENT;
+	}
+
+	*result = setup_links[index].result;
+	return 0;
+}
+
+const char *link_setup_step_str(enum link_setup_step step)
+{
+	return step < ARRAY_SIZE(step_str) ? step_str[step] : "unknown";
+}
+
+const char *link_setup_status_str(enum link_setup_status status)
+{
+	return status < ARRAY_SIZE(status_str) ? status_str[status] : "unknown";
+}
+
+#if IS_ENABLED(CONFIG_BT_USER_DATA_LEN_UPDATE)
+static void le_data_len_updated(struct bt_conn *conn, struct bt_conn_le_data_len_info *info)
+{
+	step_complete(conn, LINK_SETUP_DATA_LEN, LINK_SETUP_DONE);
+}
+#endif
+
+#if IS_ENABLED(CONFIG_BT_USER_PHY_UPDATE)
+static void le_phy_updated(struct bt_conn *conn, struct bt_conn_le_phy_info *info)
+{
+	step_complete(conn, LINK_SETUP_PHY, LINK_SETUP_DONE);
+}
+#endif
+
+static void le_param_updated(struct bt_conn *conn, uint16_t interval, uint16_t latency,
+			     uint16_t timeout)
+{
+	step_complete(conn, LINK_SETUP_CONN_PARAMS, LINK_SETUP_DONE);
+}
+
+BT_CONN_CB_DEFINE(link_setup_callbacks) = {
+	.le_param_updated = le_param_updated,
+#if IS_ENABLED(CONFIG_BT_USER_DATA_LEN_UPDATE)
+	.le_data_len_updated = le_data_len_updated,
+#endif
+#if IS_ENABLED(CONFIG_BT_USER_PHY_UPDATE)
+	.le_phy_updated = le_phy_updated,
+#endif
+};
+
+#if defined(CONFIG_SHELL)
+static int cmd_link_setup(const struct shell *shell, size_t argc, char **argv)
+{
+	struct link_setup_result r;
+	uint8_t first = 0;
+	uint8_t last = ARRAY_SIZE(setup_links) - 1;
+
+	if (argc > 1) {
+		first = last = strtoul(argv[1], NULL, 0);
+	}
+
+	for (uint8_t i = first; i <= last; i++) {
+		if (link_setup_get(i, &r)) {
+			continue;
+		}
+
+		shell_print(shell, "[%u] mtu %u, tx octets %u, phy %u, interval %u us", i, r.mtu,
+			    r.tx_octets, r.tx_phy, r.interval_us);
+		for (int step = 0; step < LINK_SETUP_STEPS; step++) {
+			shell_print(shell, "    %-11s %-7s %5u..%5u ms", step_str[step],
+				    status_str[r.status[step]], r.start_ms[step], r.end_ms[step]);
+		}
+	}
+	return 0;
+}
+
+SHELL_CMD_ARG_REGISTER(link_setup, NULL, "Show the bring-up steps of each link [link]",
+		       cmd_link_setup, 1, 1);
+#endif
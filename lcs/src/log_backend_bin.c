@@ -0,0 +1,429 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/fs/fs.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/logging/log_backend.h>
+#include <zephyr/logging/log_output_dict.h>
+
+#include "log_backend_bin.h"
+
+/*
+ * Dictionary log backend for the file system. Messages are stored in the
+ * binary dictionary format, so only the format string address and raw
+ * arguments reach flash and nothing is formatted on the device. They are
+ * collected into chunks that are written whole, aligned to the littlefs
+ * program size, and never split a message, so every chunk decodes on its
+ * own even if the file ends in a torn write.
+ *
+ * File layout: a sequence of chunks, each a chunk_hdr followed by len bytes
+ * of dictionary messages and 0xff padding up to the next LOG_BIN_ALIGN.
+ *
+ * Files other than the one being written may be deleted at any time: a low
+ * priority thread removes the oldest ones whenever the file system usage
+ * crosses CONFIG_LCS_LOG_BIN_PRUNE_HIGH_PCT, and log_backend_bin_remove_all()
+ * closes the current file first so the backend carries on in a new one.
+ */
+
+#define LOG_BIN_MAGIC  0x4C42
+#define LOG_BIN_PREFIX "blog."
+
+#if DT_NODE_EXISTS(DT_NODELABEL(lfs1))
+#define LOG_BIN_ALIGN DT_PROP(DT_NODELABEL(lfs1), prog_size)
+#else
+#define LOG_BIN_ALIGN 16
+#endif
+
+#define CHUNK_SIZE CONFIG_LCS_LOG_BIN_CHUNK_SIZE
+
+BUILD_ASSERT(CHUNK_SIZE % LOG_BIN_ALIGN == 0,
+	     "Chunk size must be a multiple of the littlefs program size");
+
+struct chunk_hdr {
+	uint16_t magic;
+	uint16_t len;
+} __packed;
+
+#define CHUNK_PAYLOAD_SIZE (CHUNK_SIZE - sizeof(struct chunk_hdr))
+
+static uint8_t chunk[CHUNK_SIZE] __aligned(4);
+static size_t chunk_used = sizeof(struct chunk_hdr);
+
+/* One formatted message, moved into the chunk once complete */
+static uint8_t msg_buf[CHUNK_PAYLOAD_SIZE];
+static size_t msg_len;
+static bool msg_overflow;
+
+static struct fs_file_t file;
+static bool file_open;
+static bool fs_failed;
+static uint32_t file_index;
+static uint32_t oldest_index;
+static size_t file_size;
+static bool panic_mode;
+static bool paused;
+/* Out of space, wait for the pruning thread before writing again */
+static bool fs_full;
+
+/* bin_lock guards the chunk and the open file, prune_lock the set of files */
+static K_MUTEX_DEFINE(bin_lock);
+static K_MUTEX_DEFINE(prune_lock);
+static K_SEM_DEFINE(prune_sem, 0, 1);
+static void flush_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(flush_work, flush_work_handler);
+
+static void file_path(char *path, size_t len, uint32_t index)
+{
+	snprintf(path, len, "%s/" LOG_BIN_PREFIX "%04u", CONFIG_LCS_LOG_BIN_DIR, index);
+}
+
+/* Find the oldest and newest existing log files */
+static int scan_files(void)
+{
+	struct fs_dir_t dir;
+	struct fs_dirent entry;
+	bool found = false;
+	uint32_t newest = 0;
+	int err;
+
+	fs_dir_t_init(&dir);
+	err = fs_opendir(&dir, CONFIG_LCS_LOG_BIN_DIR);
+	if (err) {
+		return err;
+	}
+
+	oldest_index = UINT32_MAX;
+	while (fs_readdir(&dir, &entry) == 0 && entry.name[0] != 0) {
+		uint32_t index;
+
+		if (strncmp(entry.name, LOG_BIN_PREFIX, strlen(LOG_BIN_PREFIX)) != 0) {
+			continue;
+		}
+
+		index = strtoul(entry.name + strlen(LOG_BIN_PREFIX), NULL, 10);
+		oldest_index = MIN(oldest_index, index);
+		newest = MAX(newest, index);
+		found = true;
+	}
+	fs_closedir(&dir);
+
+	if (!found) {
+		oldest_index = 0;
+		file_index = 0;
+	} else {
+		/* Every boot starts a new file */
+		file_index = newest + 1;
+	}
+
+	return 0;
+}
+
+static int open_next_file(void)
+{
+	char path[MAX_FILE_NAME + 1];
+	int err;
+
+	if (file_open) {
+		fs_close(&file);
+		file_open = false;
+		file_index++;
+	}
+
+	while (file_index - oldest_index >= CONFIG_LCS_LOG_BIN_FILES_LIMIT) {
+		file_path(path, sizeof(path), oldest_index++);
+		fs_unlink(path);
+	}
+
+	file_path(path, sizeof(path), file_index);
+	fs_file_t_init(&file);
+	err = fs_open(&file, path, FS_O_CREATE | FS_O_WRITE | FS_O_TRUNC);
+	if (err) {
+		return err;
+	}
+
+	file_open = true;
+	file_size = 0;
+	return 0;
+}
+
+static void chunk_write(bool sync)
+{
+	struct chunk_hdr *hdr = (struct chunk_hdr *)chunk;
+	size_t write_len = ROUND_UP(chunk_used, LOG_BIN_ALIGN);
+	ssize_t written;
+
+	if (chunk_used == sizeof(*hdr) || fs_failed || fs_full || paused) {
+		return;
+	}
+
+	/* The file system may not be mounted yet, keep the chunk for later */
+	if (!file_open && (scan_files() || open_next_file())) {
+		return;
+	}
+
+	if (file_size + write_len > CONFIG_LCS_LOG_BIN_FILE_SIZE && open_next_file()) {
+		fs_failed = true;
+		return;
+	}
+
+	hdr->magic = LOG_BIN_MAGIC;
+	hdr->len = chunk_used - sizeof(*hdr);
+	memset(&chunk[chunk_used], 0xff, write_len - chunk_used);
+
+	written = fs_write(&file, chunk, write_len);
+	if (written == -ENOSPC) {
+		/*
+		 * Keep the chunk and continue in a new file once the pruning
+		 * thread has made room, the torn chunk ends this one.
+		 */
+		fs_close(&file);
+		file_open = false;
+		file_index++;
+		fs_full = true;
+		k_sem_give(&prune_sem);
+		return;
+	} else if (written != write_len) {
+		/* Stop logging to flash rather than logging about it */
+		fs_failed = true;
+		return;
+	}
+
+	chunk_used = sizeof(*hdr);
+	file_size += write_len;
+
+	/* Committing littlefs metadata costs a write of its own, only do it on timed flushes */
+	if (sync) {
+		fs_sync(&file);
+	}
+}
+
+static int msg_out(uint8_t *data, size_t length, void *ctx)
+{
+	ARG_UNUSED(ctx);
+
+	if (msg_len + length > sizeof(msg_buf)) {
+		msg_overflow = true;
+	} else {
+		memcpy(&msg_buf[msg_len], data, length);
+		msg_len += length;
+	}
+
+	return length;
+}
+
+static uint8_t output_buf[1];
+LOG_OUTPUT_DEFINE(log_output_bin, msg_out, output_buf, sizeof(output_buf));
+
+static void msg_commit(void)
+{
+	if (!msg_overflow) {
+		if (chunk_used + msg_len > sizeof(chunk)) {
+			chunk_write(false);
+		}
+		if (chunk_used + msg_len <= sizeof(chunk)) {
+			memcpy(&chunk[chunk_used], msg_buf, msg_len);
+			chunk_used += msg_len;
+		}
+	}
+
+	msg_len = 0;
+	msg_overflow = false;
+
+	if (!k_work_delayable_is_pending(&flush_work)) {
+		k_work_schedule(&flush_work, K_MSEC(CONFIG_LCS_LOG_BIN_FLUSH_MS));
+	}
+}
+
+static void flush_work_handler(struct k_work *work)
+{
+	k_mutex_lock(&bin_lock, K_FOREVER);
+	chunk_write(true);
+	k_mutex_unlock(&bin_lock);
+}
+
+static void process(const struct log_backend *const backend, union log_msg_generic *msg)
+{
+	if (panic_mode) {
+		return;
+	}
+
+	k_mutex_lock(&bin_lock, K_FOREVER);
+	log_dict_output_msg_process(&log_output_bin, &msg->log, 0);
+	msg_commit();
+	k_mutex_unlock(&bin_lock);
+}
+
+static void dropped(const struct log_backend *const backend, uint32_t cnt)
+{
+	if (panic_mode) {
+		return;
+	}
+
+	k_mutex_lock(&bin_lock, K_FOREVER);
+	log_dict_output_dropped_process(&log_output_bin, cnt);
+	msg_commit();
+	k_mutex_unlock(&bin_lock);
+}
+
+static void close_file(void)
+{
+	chunk_write(true);
+	if (file_open) {
+		fs_close(&file);
+		file_open = false;
+	}
+}
+
+static void panic(const struct log_backend *const backend)
+{
+	/* Save what is buffered, later messages only go to the other backends */
+	panic_mode = true;
+	close_file();
+}
+
+int log_backend_bin_pause(void)
+{
+	k_mutex_lock(&bin_lock, K_FOREVER);
+	close_file();
+	paused = true;
+	k_mutex_unlock(&bin_lock);
+
+	return 0;
+}
+
+void log_backend_bin_resume(void)
+{
+	k_mutex_lock(&bin_lock, K_FOREVER);
+	/* The next chunk rescans the directory and starts a new file */
+	paused = false;
+	fs_failed = false;
+	k_mutex_unlock(&bin_lock);
+}
+
+int log_backend_bin_rotate(void)
+{
+	int err = 0;
+
+	k_mutex_lock(&bin_lock, K_FOREVER);
+	chunk_write(true);
+	if (file_open && !paused) {
+		err = open_next_file();
+		if (err) {
+			fs_failed = true;
+		}
+	}
+	k_mutex_unlock(&bin_lock);
+
+	return err;
+}
+
+int log_backend_bin_remove_all(void)
+{
+	struct fs_dir_t dir;
+	struct fs_dirent entry;
+	char path[MAX_FILE_NAME + 1];
+	int err;
+
+	log_backend_bin_pause();
+	k_mutex_lock(&prune_lock, K_FOREVER);
+
+	fs_dir_t_init(&dir);
+	err = fs_opendir(&dir, CONFIG_LCS_LOG_BIN_DIR);
+	if (err == 0) {
+		while ((err = fs_readdir(&dir, &entry)) == 0 && entry.name[0] != 0) {
+			snprintf(path, sizeof(path), "%s/%s", CONFIG_LCS_LOG_BIN_DIR,
+				 entry.name);
+			err = fs_unlink(path);
+			if (err) {
+				break;
+			}
+		}
+		fs_closedir(&dir);
+	}
+
+	k_mutex_lock(&bin_lock, K_FOREVER);
+	oldest_index = 0;
+	file_index = 0;
+	fs_full = false;
+	k_mutex_unlock(&bin_lock);
+
+	k_mutex_unlock(&prune_lock);
+	log_backend_bin_resume();
+
+	return err;
+}
+
+int log_backend_bin_usage(void)
+{
+	struct fs_statvfs stat;
+	int err;
+
+	err = fs_statvfs(CONFIG_LCS_LOG_BIN_DIR, &stat);
+	if (err) {
+		return err;
+	}
+
+	if (stat.f_blocks == 0) {
+		return -EIO;
+	}
+
+	return (stat.f_blocks - stat.f_bfree) * 100 / stat.f_blocks;
+}
+
+/* Delete the oldest log file unless only the current one is left */
+static bool prune_oldest(void)
+{
+	char path[MAX_FILE_NAME + 1];
+	uint32_t index;
+
+	k_mutex_lock(&bin_lock, K_FOREVER);
+	if (oldest_index >= file_index) {
+		k_mutex_unlock(&bin_lock);
+		return false;
+	}
+	index = oldest_index++;
+	k_mutex_unlock(&bin_lock);
+
+	file_path(path, sizeof(path), index);
+	fs_unlink(path);
+	return true;
+}
+
+static void prune_thread_fn(void)
+{
+	int usage;
+
+	while (true) {
+		k_sem_take(&prune_sem, K_MSEC(CONFIG_LCS_LOG_BIN_PRUNE_INTERVAL_MS));
+
+		k_mutex_lock(&prune_lock, K_FOREVER);
+		usage = log_backend_bin_usage();
+		if (usage >= CONFIG_LCS_LOG_BIN_PRUNE_HIGH_PCT || fs_full) {
+			while (usage > CONFIG_LCS_LOG_BIN_PRUNE_LOW_PCT && prune_oldest()) {
+				usage = log_backend_bin_usage();
+			}
+		}
+		k_mutex_unlock(&prune_lock);
+
+		if (fs_full && usage >= 0 && usage < CONFIG_LCS_LOG_BIN_PRUNE_HIGH_PCT) {
+			k_mutex_lock(&bin_lock, K_FOREVER);
+			fs_full = false;
+			k_mutex_unlock(&bin_lock);
+		}
+	}
+}
+
+K_THREAD_DEFINE(log_bin_prune_thread, CONFIG_LCS_LOG_BIN_PRUNE_STACK_SIZE,
+		prune_thread_fn, NULL, NULL, NULL,
+		CONFIG_LCS_LOG_BIN_PRUNE_PRIORITY, 0, 0);
+
+static const struct log_backend_api log_backend_bin_api = {
+	.process = process,
+	.dropped = dropped,
+	.panic = panic,
+};
+
+LOG_BACKEND_DEFINE(log_backend_bin, log_backend_bin_api, true);
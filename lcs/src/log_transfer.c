@@ -0,0 +1,384 @@
+#include <stdio.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/fs/fs.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/crc.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gatt.h>
+
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(log_transfer, LOG_LEVEL_INF);
+
+#include "link_control_service.h"
+#include "log_transfer.h"
+#include "telemetry.h"
+#include "conn_params.h"
+#include "tx_credits.h"
+
+#define PDU_MAX_LEN (CONFIG_BT_L2CAP_TX_MTU - 3)
+#define CHUNK_HDR_LEN sizeof(struct log_transfer_chunk_hdr)
+#define PAYLOAD_MAX_LEN (PDU_MAX_LEN - CHUNK_HDR_LEN - LOG_TRANSFER_CRC_LEN)
+#define XFER_DEPTH CONFIG_LCS_LOG_XFER_PIPELINE_DEPTH
+
+/* Give up if no notification completes for this long */
+#define XFER_CREDIT_TIMEOUT K_SECONDS(5)
+
+struct xfer_req {
+	struct bt_conn *conn;
+	uint8_t op;
+	uint32_t offset;
+	uint32_t start_ms;
+	uint32_t end_ms;
+	char name[MAX_FILE_NAME + 1];
+};
+
+/* Object being streamed */
+struct xfer {
+	struct bt_conn *conn;
+	uint32_t offset;
+	uint32_t skip;
+	uint16_t payload_len;
+	uint16_t used;
+	int err;
+};
+
+K_MSGQ_DEFINE(xfer_msgq, sizeof(struct xfer_req), 1, 4);
+/* Chunks of a replaced transfer still in flight hold their credits */
+TX_CREDITS_DEFINE(xfer_credits, XFER_DEPTH);
+static atomic_t xfer_abort;
+static struct bt_conn *xfer_conn;
+
+static uint8_t pdu[PDU_MAX_LEN];
+
+static void chunk_sent(struct bt_conn *conn, void *user_data)
+{
+	tx_credits_release(&xfer_credits, 1);
+}
+
+static void send_rsp(struct bt_conn *conn, uint8_t rsp, uint8_t op, int err, uint32_t size)
+{
+	struct log_transfer_rsp_hdr hdr = {
+		.rsp = rsp,
+		.op = op,
+		.status = err,
+		.size = sys_cpu_to_le32(size),
+	};
+
+	notify_log_xfer_cp(conn, &hdr, sizeof(hdr));
+}
+
+static int send_chunk(struct xfer *x)
+{
+	struct log_transfer_chunk_hdr *hdr = (void *)pdu;
+	uint16_t len = CHUNK_HDR_LEN + x->used;
+	uint16_t crc;
+	int err;
+
+	if (atomic_get(&xfer_abort)) {
+		return -ECANCELED;
+	}
+
+	if (tx_credits_take(&xfer_credits, x->conn, XFER_CREDIT_TIMEOUT)) {
+		return -ETIMEDOUT;
+	}
+
+	hdr->offset = sys_cpu_to_le32(x->offset);
+	crc = crc16_ccitt(0xffff, pdu, len);
+	sys_put_le16(crc, &pdu[len]);
+	len += LOG_TRANSFER_CRC_LEN;
+
+	while (tx_credits_retry(err = notify_log_xfer_data(x->conn, pdu, len, chunk_sent))) {
+		if (atomic_get(&xfer_abort)) {
+			break;
+		}
+	}
+
+	if (err) {
+		tx_credits_cancel(&xfer_credits);
+		return err;
+	}
+
+	if (IS_ENABLED(CONFIG_LCS_CONN_PARAMS)) {
+		conn_params_activity(x->conn, len);
+	}
+
+	x->offset += x->used;
+	x->used = 0;
+	return 0;
+}
+
+/* Append object bytes, skipping those before the resume offset */
+static int xfer_put(struct xfer *x, const void *data, size_t len)
+{
+	const uint8_t *src = data;
+
+	if (x->skip) {
+		size_t skipped = MIN(x->skip, len);
+
+		x->skip -= skipped;
+		x->offset += skipped;
+		src += skipped;
+		len -= skipped;
+	}
+
+	while (len && !x->err) {
+		size_t n = MIN(len, x->payload_len - x->used);
+
+		memcpy(&pdu[CHUNK_HDR_LEN + x->used], src, n);
+		x->used += n;
+		src += n;
+		len -= n;
+
+		if (x->used == x->payload_len) {
+			x->err = send_chunk(x);
+		}
+	}
+
+	return x->err;
+}
+
+static int xfer_flush(struct xfer *x)
+{
+	if (x->used && !x->err) {
+		x->err = send_chunk(x);
+	}
+
+	return x->err;
+}
+
+#if defined(CONFIG_FILE_SYSTEM)
+static void stream_list(struct xfer *x, const struct xfer_req *req)
+{
+	struct fs_dir_t dir;
+	struct fs_dirent entry;
+	char line[MAX_FILE_NAME + 16];
+	int len;
+
+	fs_dir_t_init(&dir);
+	x->err = fs_opendir(&dir, CONFIG_LCS_LOG_XFER_DIR);
+	if (x->err) {
+		return;
+	}
+
+	send_rsp(x->conn, LOG_TRANSFER_RSP_START, req->op, 0, UINT32_MAX);
+
+	while (!x->err && fs_readdir(&dir, &entry) == 0 && entry.name[0] != 0) {
+		if (entry.type != FS_DIR_ENTRY_FILE) {
+			continue;
+		}
+		len = snprintf(line, sizeof(line), "%s %zu\n", entry.name, entry.size);
+		xfer_put(x, line, MIN(len, sizeof(line) - 1));
+	}
+	fs_closedir(&dir);
+
+	xfer_flush(x);
+}
+
+static void stream_file(struct xfer *x, const struct xfer_req *req)
+{
+	char path[MAX_FILE_NAME + 1];
+	struct fs_dirent entry;
+	struct fs_file_t file;
+	ssize_t read;
+
+	snprintf(path, sizeof(path), "%s/%s", CONFIG_LCS_LOG_XFER_DIR, req->name);
+
+	x->err = fs_stat(path, &entry);
+	if (x->err) {
+		return;
+	}
+
+	fs_file_t_init(&file);
+	x->err = fs_open(&file, path, FS_O_READ);
+	if (x->err) {
+		return;
+	}
+
+	/* Seek instead of skipping through the file */
+	x->err = fs_seek(&file, MIN(req->offset, entry.size), FS_SEEK_SET);
+	if (x->err) {
+		fs_close(&file);
+		return;
+	}
+	x->offset = MIN(req->offset, entry.size);
+	x->skip = 0;
+
+	send_rsp(x->conn, LOG_TRANSFER_RSP_START, req->op, 0, entry.size);
+
+	while (!x->err) {
+		read = fs_read(&file, &pdu[CHUNK_HDR_LEN], x->payload_len);
+		if (read <= 0) {
+			x->err = read;
+			break;
+		}
+		x->used = read;
+		x->err = send_chunk(x);
+	}
+	fs_close(&file);
+}
+#endif
+
+#if IS_ENABLED(CONFIG_LCS_TELEMETRY)
+struct telemetry_ctx {
+	struct xfer *x;
+	const struct xfer_req *req;
+};
+
+static bool telemetry_cb(const struct telemetry_record *record, void *user_data)
+{
+	struct telemetry_ctx *ctx = user_data;
+
+	if (record->timestamp_ms < ctx->req->start_ms ||
+	    (ctx->req->end_ms && record->timestamp_ms > ctx->req->end_ms)) {
+		return true;
+	}
+
+	return xfer_put(ctx->x, record, sizeof(*record)) == 0;
+}
+
+static void stream_telemetry(struct xfer *x, const struct xfer_req *req)
+{
+	struct telemetry_ctx ctx = {
+		.x = x,
+		.req = req,
+	};
+	int err;
+
+	send_rsp(x->conn, LOG_TRANSFER_RSP_START, req->op, 0, UINT32_MAX);
+
+	err = telemetry_walk(0, telemetry_cb, &ctx);
+	if (err && !x->err) {
+		x->err = err;
+	}
+
+	xfer_flush(x);
+}
+#endif
+
+static void xfer_run(const struct xfer_req *req)
+{
+	uint16_t payload_len = bt_gatt_get_mtu(req->conn) - 3 - CHUNK_HDR_LEN -
+			       LOG_TRANSFER_CRC_LEN;
+	struct xfer x = {
+		.conn = req->conn,
+		.offset = 0,
+		.skip = req->offset,
+		.payload_len = MIN(payload_len, PAYLOAD_MAX_LEN),
+		.err = -ENOTSUP,
+	};
+
+	switch (req->op) {
+#if defined(CONFIG_FILE_SYSTEM)
+	case LOG_TRANSFER_OP_LIST:
+		x.err = 0;
+		stream_list(&x, req);
+		break;
+	case LOG_TRANSFER_OP_FILE:
+		x.err = 0;
+		stream_file(&x, req);
+		break;
+#endif
+#if IS_ENABLED(CONFIG_LCS_TELEMETRY)
+	case LOG_TRANSFER_OP_TELEMETRY:
+		x.err = 0;
+		stream_telemetry(&x, req);
+		break;
+#endif
+	default:
+		break;
+	}
+
+	LOG_INF("Transfer 0x%02x ended at offset %u (err %d)", req->op, x.offset, x.err);
+	send_rsp(req->conn, LOG_TRANSFER_RSP_DONE, req->op, x.err, x.offset);
+}
+
+int log_transfer_request(struct bt_conn *conn, const uint8_t *data, uint16_t len)
+{
+	struct xfer_req req = { 0 };
+	struct xfer_req old;
+
+	if (len < 1) {
+		return -EINVAL;
+	}
+	req.op = data[0];
+
+	if (req.op == LOG_TRANSFER_OP_ABORT) {
+		atomic_set(&xfer_abort, 1);
+		return 0;
+	}
+
+	if (len < 5) {
+		return -EINVAL;
+	}
+	req.offset = sys_get_le32(&data[1]);
+
+	switch (req.op) {
+	case LOG_TRANSFER_OP_LIST:
+		break;
+	case LOG_TRANSFER_OP_FILE:
+		if (len - 5 == 0 || len - 5 >= sizeof(req.name) ||
+		    memchr(&data[5], '/', len - 5)) {
+			return -EINVAL;
+		}
+		memcpy(req.name, &data[5], len - 5);
+		break;
+	case LOG_TRANSFER_OP_TELEMETRY:
+		if (len != 13) {
+			return -EINVAL;
+		}
+		req.start_ms = sys_get_le32(&data[5]);
+		req.end_ms = sys_get_le32(&data[9]);
+		break;
+	default:
+		return -ENOTSUP;
+	}
+
+	/* A valid request replaces the running one */
+	atomic_set(&xfer_abort, 1);
+
+	/* A newer request replaces one still queued, which holds a reference */
+	if (k_msgq_get(&xfer_msgq, &old, K_NO_WAIT) == 0) {
+		bt_conn_unref(old.conn);
+	}
+
+	req.conn = bt_conn_ref(conn);
+	if (k_msgq_put(&xfer_msgq, &req, K_NO_WAIT)) {
+		bt_conn_unref(req.conn);
+		return -EBUSY;
+	}
+
+	return 0;
+}
+
+static void log_transfer_thread_fn(void)
+{
+	struct xfer_req req;
+
+	while (true) {
+		k_msgq_get(&xfer_msgq, &req, K_FOREVER);
+
+		atomic_clear(&xfer_abort);
+		xfer_conn = req.conn;
+		xfer_run(&req);
+		xfer_conn = NULL;
+		bt_conn_unref(req.conn);
+	}
+}
+
+K_THREAD_DEFINE(log_transfer_thread, CONFIG_LCS_LOG_XFER_STACK_SIZE,
+		log_transfer_thread_fn, NULL, NULL, NULL,
+		CONFIG_LCS_LOG_XFER_THREAD_PRIORITY, 0, 0);
+
+static void disconnected(struct bt_conn *conn, uint8_t reason)
+{
+	if (conn == xfer_conn) {
+		atomic_set(&xfer_abort, 1);
+	}
+	tx_credits_disconnected(&xfer_credits, conn);
+}
+
+BT_CONN_CB_DEFINE(log_transfer_callbacks) = {
+	.disconnected = disconnected,
+};
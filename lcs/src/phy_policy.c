@@ -0,0 +1,277 @@
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gap.h>
+
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(phy_policy, LOG_LEVEL_INF);
+
+#include "link_control.h"
+#include "link_control_service.h"
+#include "phy_policy.h"
+
+/* Ordered from fastest to most robust */
+enum phy_level {
+	PHY_LEVEL_2M,
+	PHY_LEVEL_1M,
+	PHY_LEVEL_CODED_S2,
+	PHY_LEVEL_CODED_S8,
+};
+
+#define PHY_LEVEL_FASTEST \
+	(IS_ENABLED(CONFIG_BT_CTLR_PHY_2M) ? PHY_LEVEL_2M : PHY_LEVEL_1M)
+#define PHY_LEVEL_MOST_ROBUST \
+	(IS_ENABLED(CONFIG_BT_CTLR_PHY_CODED) ? PHY_LEVEL_CODED_S8 : PHY_LEVEL_1M)
+
+/* Upgrades that lose more than this share of throughput are reverted */
+#define THROUGHPUT_REGRESSION_PERCENT 10
+/* After a reverted upgrade, hold off upgrading for this many cooldowns */
+#define THROUGHPUT_HOLD_COOLDOWNS 6
+
+static const char *const level_str[] = {
+	[PHY_LEVEL_2M] = "2M",
+	[PHY_LEVEL_1M] = "1M",
+	[PHY_LEVEL_CODED_S2] = "Coded S2",
+	[PHY_LEVEL_CODED_S8] = "Coded S8",
+};
+
+static const char *const reason_str[] = {
+	[PHY_REASON_NONE] = "none",
+	[PHY_REASON_RSSI_HIGH] = "RSSI high",
+	[PHY_REASON_RSSI_LOW] = "RSSI low",
+	[PHY_REASON_PER_HIGH] = "packet errors",
+	[PHY_REASON_THROUGHPUT] = "throughput",
+};
+
+/* Lowest RSSI at which each level is kept */
+static const int8_t level_min_rssi[] = {
+	[PHY_LEVEL_2M] = CONFIG_LCS_PHY_2M_MIN_RSSI,
+	[PHY_LEVEL_1M] = CONFIG_LCS_PHY_1M_MIN_RSSI,
+	[PHY_LEVEL_CODED_S2] = CONFIG_LCS_PHY_S2_MIN_RSSI,
+	[PHY_LEVEL_CODED_S8] = INT8_MIN,
+};
+
+struct phy_link {
+	struct bt_conn *conn;
+	enum phy_level level;
+	enum phy_level target;
+	enum phy_policy_reason reason;
+	int8_t rssi;
+	uint8_t per_percent;
+	int64_t last_change_ms;
+	int64_t hold_upgrade_until_ms;
+	bool verify_upgrade;
+	uint32_t rate_before;
+	uint32_t window_bytes;
+	int64_t window_start_ms;
+	struct k_work work;
+};
+
+static struct phy_link phy_links[CONFIG_BT_MAX_CONN];
+
+static void fill_state(const struct phy_link *link, struct phy_policy_state *state)
+{
+	state->link_index = ARRAY_INDEX(phy_links, link);
+	state->phy = link->level == PHY_LEVEL_2M ? BT_GAP_LE_PHY_2M :
+		     link->level == PHY_LEVEL_1M ? BT_GAP_LE_PHY_1M : BT_GAP_LE_PHY_CODED;
+	state->coded_s8 = link->level == PHY_LEVEL_CODED_S8;
+	state->reason = link->reason;
+	state->rssi = link->rssi;
+	state->per_percent = link->per_percent;
+}
+
+static void phy_work_handler(struct k_work *work)
+{
+	struct phy_link *link = CONTAINER_OF(work, struct phy_link, work);
+	uint8_t phy;
+	uint16_t coded_opt = BT_CONN_LE_PHY_OPT_NONE;
+	int err;
+
+	if (!link->conn) {
+		return;
+	}
+
+	switch (link->target) {
+	case PHY_LEVEL_2M:
+		phy = BT_GAP_LE_PHY_2M;
+		break;
+	case PHY_LEVEL_1M:
+		phy = BT_GAP_LE_PHY_1M;
+		break;
+	case PHY_LEVEL_CODED_S2:
+		phy = BT_GAP_LE_PHY_CODED;
+		coded_opt = BT_CONN_LE_PHY_OPT_CODED_S2;
+		break;
+	default:
+		phy = BT_GAP_LE_PHY_CODED;
+		coded_opt = BT_CONN_LE_PHY_OPT_CODED_S8;
+		break;
+	}
+
+	err = update_phy_coding(link->conn, phy, coded_opt);
+	if (err) {
+		LOG_WRN("Link %u: PHY update failed (err %d)",
+			ARRAY_INDEX(phy_links, link), err);
+		link->target = link->level;
+	}
+}
+
+static void change_level(struct phy_link *link, enum phy_level target,
+			 enum phy_policy_reason reason, int64_t now)
+{
+	uint32_t elapsed = now - link->window_start_ms;
+
+	LOG_INF("Link %u: %s -> %s (%s, RSSI %d, PER %u%%)", ARRAY_INDEX(phy_links, link),
+		level_str[link->level], level_str[target], reason_str[reason],
+		link->rssi, link->per_percent);
+
+	link->verify_upgrade = target < link->level && reason != PHY_REASON_THROUGHPUT;
+	link->rate_before = elapsed ? (uint64_t)link->window_bytes * 1000 / elapsed : 0;
+	link->window_bytes = 0;
+	link->window_start_ms = now;
+	link->last_change_ms = now;
+	link->target = target;
+	link->reason = reason;
+
+	k_work_submit(&link->work);
+}
+
+void phy_policy_start(struct bt_conn *conn)
+{
+	struct phy_link *link = &phy_links[bt_conn_index(conn)];
+	int64_t now = k_uptime_get();
+
+	k_work_init(&link->work, phy_work_handler);
+	link->conn = bt_conn_ref(conn);
+	link->level = PHY_LEVEL_1M;
+	link->target = PHY_LEVEL_1M;
+	link->reason = PHY_REASON_NONE;
+	link->rssi = 0;
+	link->per_percent = 0;
+	link->last_change_ms = now;
+	link->hold_upgrade_until_ms = 0;
+	link->verify_upgrade = false;
+	link->window_bytes = 0;
+	link->window_start_ms = now;
+}
+
+void phy_policy_stop(struct bt_conn *conn)
+{
+	struct phy_link *link = &phy_links[bt_conn_index(conn)];
+	struct k_work_sync sync;
+
+	if (link->conn) {
+		/* Command status is handled off the RX thread, so waiting is safe here */
+		k_work_cancel_sync(&link->work, &sync);
+		bt_conn_unref(link->conn);
+		link->conn = NULL;
+	}
+}
+
+void phy_policy_update(struct bt_conn *conn, const struct phy_policy_sample *sample)
+{
+	struct phy_link *link = &phy_links[bt_conn_index(conn)];
+	int64_t now = k_uptime_get();
+	enum phy_level level;
+	uint32_t total;
+	bool cooled_down;
+
+	if (link->conn != conn) {
+		return;
+	}
+
+	level = link->level;
+	link->rssi = sample->rssi;
+	total = sample->rx_packets + sample->crc_errors;
+	link->per_percent = total ? sample->crc_errors * 100 / total : 0;
+	link->window_bytes += sample->tx_bytes;
+
+	cooled_down = now - link->last_change_ms >= CONFIG_LCS_PHY_COOLDOWN_MS;
+
+	/* Wait for the previous change to complete, give up if the peer never answers */
+	if (link->target != level) {
+		if (cooled_down) {
+			LOG_WRN("Link %u: PHY update not completed", ARRAY_INDEX(phy_links, link));
+			link->target = level;
+			link->verify_upgrade = false;
+		}
+		return;
+	}
+
+	if (!cooled_down) {
+		return;
+	}
+
+	if (link->verify_upgrade) {
+		uint32_t rate = (uint64_t)link->window_bytes * 1000 /
+				(now - link->window_start_ms);
+
+		link->verify_upgrade = false;
+		if (link->rate_before &&
+		    rate * 100 < link->rate_before * (100 - THROUGHPUT_REGRESSION_PERCENT)) {
+			link->hold_upgrade_until_ms = now +
+				THROUGHPUT_HOLD_COOLDOWNS * CONFIG_LCS_PHY_COOLDOWN_MS;
+			change_level(link, level + 1, PHY_REASON_THROUGHPUT, now);
+			return;
+		}
+	}
+
+	if (level < PHY_LEVEL_MOST_ROBUST) {
+		if (link->per_percent > CONFIG_LCS_PHY_PER_HIGH) {
+			change_level(link, level + 1, PHY_REASON_PER_HIGH, now);
+			return;
+		}
+		if (sample->rssi < level_min_rssi[level]) {
+			change_level(link, level + 1, PHY_REASON_RSSI_LOW, now);
+			return;
+		}
+	}
+
+	if (level > PHY_LEVEL_FASTEST && now >= link->hold_upgrade_until_ms &&
+	    link->per_percent <= CONFIG_LCS_PHY_PER_LOW &&
+	    sample->rssi >= level_min_rssi[level - 1] + CONFIG_LCS_PHY_HYSTERESIS_DB) {
+		change_level(link, level - 1, PHY_REASON_RSSI_HIGH, now);
+	}
+}
+
+void phy_policy_phy_updated(struct bt_conn *conn, uint8_t tx_phy)
+{
+	struct phy_link *link = &phy_links[bt_conn_index(conn)];
+	struct phy_policy_state state;
+
+	if (link->conn != conn) {
+		return;
+	}
+
+	switch (tx_phy) {
+	case BT_GAP_LE_PHY_2M:
+		link->level = PHY_LEVEL_2M;
+		break;
+	case BT_GAP_LE_PHY_CODED:
+		/* The coding is not reported, assume the requested one */
+		link->level = link->target >= PHY_LEVEL_CODED_S2 ?
+			      link->target : PHY_LEVEL_CODED_S8;
+		break;
+	default:
+		link->level = PHY_LEVEL_1M;
+		break;
+	}
+
+	/* The peer or the shell may have picked another PHY, follow it */
+	link->target = link->level;
+
+	fill_state(link, &state);
+	notify_phy_state(conn, &state, sizeof(state));
+}
+
+int phy_policy_get(struct bt_conn *conn, struct phy_policy_state *state)
+{
+	struct phy_link *link = &phy_links[bt_conn_index(conn)];
+
+	if (link->conn != conn) {
+		return -ENOTCONN;
+	}
+
+	fill_state(link, state);
+	return 0;
+}
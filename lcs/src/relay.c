@@ -0,0 +1,354 @@
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/net/buf.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gatt.h>
+
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(relay, LOG_LEVEL_INF);
+
+#include "link_control_service.h"
+#include "relay.h"
+#include "link_metrics.h"
+#include "conn_params.h"
+#include "tx_credits.h"
+
+#define RELAY_PDU_MAX_LEN (CONFIG_BT_L2CAP_TX_MTU - 3)
+#define RELAY_DEPTH CONFIG_LCS_RELAY_PIPELINE_DEPTH
+
+/*
+ * Packets travel from the notification callback to the relay thread in one
+ * of these buffers, which carries the index of the link it came from.
+ */
+NET_BUF_POOL_FIXED_DEFINE(relay_pool, CONFIG_LCS_RELAY_QUEUE_SIZE, RELAY_PDU_MAX_LEN,
+			  sizeof(uint8_t), NULL);
+static K_FIFO_DEFINE(relay_fifo);
+
+/* One credit per notification that may be in flight upstream */
+TX_CREDITS_DEFINE(relay_credits, RELAY_DEPTH);
+
+struct relay_link {
+	struct bt_conn *conn;
+	uint16_t value_handle;
+	uint16_t ccc_handle;
+	bool subscribed;
+	struct bt_gatt_subscribe_params sub;
+	struct relay_hop_stats stats;
+};
+
+static struct relay_link links[CONFIG_BT_MAX_CONN];
+static struct relay_upstream_stats upstream_stats;
+static struct k_spinlock relay_lock;
+static struct bt_conn *upstream_conn;
+static atomic_t relay_enabled;
+
+static void hop_dropped(uint8_t link_index)
+{
+	k_spinlock_key_t key = k_spin_lock(&relay_lock);
+
+	links[link_index].stats.dropped++;
+	k_spin_unlock(&relay_lock, key);
+}
+
+/* Called from the Bluetooth RX thread for every downstream notification */
+static uint8_t relay_notify_cb(struct bt_conn *conn, struct bt_gatt_subscribe_params *params,
+			       const void *data, uint16_t length)
+{
+	struct relay_link *link = CONTAINER_OF(params, struct relay_link, sub);
+	uint8_t link_index = ARRAY_INDEX(links, link);
+	struct relay_hop_stats *s = &link->stats;
+	struct bt_conn *upstream = upstream_conn;
+	struct net_buf *buf;
+	k_spinlock_key_t key;
+
+	if (!data) {
+		link->subscribed = false;
+		return BT_GATT_ITER_STOP;
+	}
+
+	if (IS_ENABLED(CONFIG_LCS_LINK_METRICS)) {
+		link_metrics_rx(conn, length);
+	}
+	if (IS_ENABLED(CONFIG_LCS_CONN_PARAMS)) {
+		conn_params_activity(conn, length);
+	}
+
+	if (!atomic_get(&relay_enabled) || !upstream) {
+		return BT_GATT_ITER_CONTINUE;
+	}
+
+	if (length > bt_gatt_get_mtu(upstream) - 3 || length > RELAY_PDU_MAX_LEN) {
+		hop_dropped(link_index);
+		return BT_GATT_ITER_CONTINUE;
+	}
+
+	/*
+	 * Waiting for a buffer holds up the RX thread, so the host stops
+	 * taking packets from the controller and the peripheral's
+	 * notifications are held back over the air until the upstream link
+	 * catches up. The timeout bounds how long the other links and the
+	 * upstream CCC can be starved.
+	 */
+	buf = net_buf_alloc(&relay_pool, K_MSEC(CONFIG_LCS_RELAY_BACKPRESSURE_MS));
+	if (!buf) {
+		hop_dropped(link_index);
+		return BT_GATT_ITER_CONTINUE;
+	}
+
+	net_buf_add_mem(buf, data, length);
+	*(uint8_t *)net_buf_user_data(buf) = link_index;
+
+	key = k_spin_lock(&relay_lock);
+	s->packets++;
+	s->bytes += length;
+	s->queued++;
+	s->queued_max = MAX(s->queued_max, s->queued);
+	k_spin_unlock(&relay_lock, key);
+
+	net_buf_put(&relay_fifo, buf);
+	return BT_GATT_ITER_CONTINUE;
+}
+
+static void relay_sent(struct bt_conn *conn, void *user_data)
+{
+	uint16_t len = (uintptr_t)user_data;
+	k_spinlock_key_t key;
+
+	if (IS_ENABLED(CONFIG_LCS_LINK_METRICS)) {
+		link_metrics_tx(conn, len);
+	}
+	if (IS_ENABLED(CONFIG_LCS_CONN_PARAMS)) {
+		conn_params_activity(conn, len);
+	}
+
+	key = k_spin_lock(&relay_lock);
+	upstream_stats.packets++;
+	upstream_stats.bytes += len;
+	k_spin_unlock(&relay_lock, key);
+
+	tx_credits_release(&relay_credits, 1);
+}
+
+static struct bt_conn *upstream_get(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&relay_lock);
+	struct bt_conn *conn = upstream_conn ? bt_conn_ref(upstream_conn) : NULL;
+
+	k_spin_unlock(&relay_lock, key);
+	return conn;
+}
+
+/* Send one queued packet upstream, returns 0 once the host has taken it */
+static int relay_forward(struct net_buf *buf)
+{
+	uint32_t start = k_uptime_get_32();
+	struct bt_conn *conn;
+	k_spinlock_key_t key;
+	int err;
+
+	conn = upstream_get();
+	if (!conn) {
+		return -ENOTCONN;
+	}
+
+	/* Losing the upstream link gives back the credits waited for */
+	tx_credits_take(&relay_credits, conn, K_FOREVER);
+	do {
+		err = notify_relay(conn, buf->data, buf->len, relay_sent,
+				   (void *)(uintptr_t)buf->len);
+	} while (tx_credits_retry(err));
+	bt_conn_unref(conn);
+
+	key = k_spin_lock(&relay_lock);
+	upstream_stats.stall_ms += k_uptime_get_32() - start;
+	if (err) {
+		upstream_stats.errors++;
+	} else {
+		upstream_stats.in_flight_max = MAX(upstream_stats.in_flight_max,
+						   tx_credits_in_flight(&relay_credits));
+	}
+	k_spin_unlock(&relay_lock, key);
+
+	if (err) {
+		tx_credits_cancel(&relay_credits);
+	}
+	return err;
+}
+
+static void relay_thread_fn(void)
+{
+	struct net_buf *buf;
+	uint8_t link_index;
+	k_spinlock_key_t key;
+
+	while (true) {
+		buf = net_buf_get(&relay_fifo, K_FOREVER);
+		link_index = *(uint8_t *)net_buf_user_data(buf);
+
+		if (relay_forward(buf)) {
+			hop_dropped(link_index);
+		}
+
+		key = k_spin_lock(&relay_lock);
+		if (links[link_index].stats.queued) {
+			links[link_index].stats.queued--;
+		}
+		k_spin_unlock(&relay_lock, key);
+
+		/* The host copied the packet into its own PDU */
+		net_buf_unref(buf);
+	}
+}
+
+K_THREAD_DEFINE(relay_thread, CONFIG_LCS_RELAY_STACK_SIZE, relay_thread_fn, NULL, NULL, NULL,
+		CONFIG_LCS_RELAY_THREAD_PRIORITY, 0, 0);
+
+static void link_subscribe(struct relay_link *link)
+{
+	int err;
+
+	if (link->subscribed) {
+		return;
+	}
+
+	memset(&link->sub, 0, sizeof(link->sub));
+	link->sub.notify = relay_notify_cb;
+	link->sub.value = BT_GATT_CCC_NOTIFY;
+	link->sub.value_handle = link->value_handle;
+	link->sub.ccc_handle = link->ccc_handle;
+	/* Subscribe again on every connection instead of resuming on a bonded one */
+	atomic_set_bit(link->sub.flags, BT_GATT_SUBSCRIBE_FLAG_VOLATILE);
+
+	err = bt_gatt_subscribe(link->conn, &link->sub);
+	if (err && err != -EALREADY) {
+		LOG_ERR("Throughput subscribe failed (link %u, err %d)", ARRAY_INDEX(links, link),
+			err);
+		return;
+	}
+	link->subscribed = true;
+}
+
+static void link_unsubscribe(struct relay_link *link)
+{
+	int err;
+
+	if (!link->subscribed) {
+		return;
+	}
+
+	err = bt_gatt_unsubscribe(link->conn, &link->sub);
+	if (err) {
+		LOG_ERR("Throughput unsubscribe failed (link %u, err %d)",
+			ARRAY_INDEX(links, link), err);
+	}
+}
+
+void relay_link_ready(struct bt_conn *conn, uint16_t value_handle, uint16_t ccc_handle)
+{
+	struct relay_link *link = &links[bt_conn_index(conn)];
+	k_spinlock_key_t key;
+
+	if (!value_handle || !ccc_handle) {
+		LOG_WRN("No throughput characteristic on link %u", bt_conn_index(conn));
+		return;
+	}
+
+	link->conn = conn;
+	link->value_handle = value_handle;
+	link->ccc_handle = ccc_handle;
+	link->subscribed = false;
+
+	key = k_spin_lock(&relay_lock);
+	memset(&link->stats, 0, sizeof(link->stats));
+	link->stats.link_index = bt_conn_index(conn);
+	k_spin_unlock(&relay_lock, key);
+
+	if (atomic_get(&relay_enabled)) {
+		link_subscribe(link);
+	}
+}
+
+void relay_link_gone(struct bt_conn *conn)
+{
+	struct relay_link *link = &links[bt_conn_index(conn)];
+
+	if (link->conn != conn) {
+		return;
+	}
+
+	/* The host drops volatile subscriptions on disconnect */
+	link->conn = NULL;
+	link->subscribed = false;
+}
+
+void relay_set_upstream(struct bt_conn *conn)
+{
+	k_spinlock_key_t key = k_spin_lock(&relay_lock);
+	struct bt_conn *old = upstream_conn;
+
+	upstream_conn = conn;
+	k_spin_unlock(&relay_lock, key);
+
+	/* Only the notifications dropped with the old link give credits back */
+	if (old && old != conn) {
+		tx_credits_disconnected(&relay_credits, old);
+	}
+
+	if (!conn) {
+		/* Nobody left to receive the stream */
+		relay_set_enabled(false);
+	}
+}
+
+void relay_set_enabled(bool enabled)
+{
+	if (atomic_set(&relay_enabled, enabled) == enabled) {
+		return;
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(links); i++) {
+		if (!links[i].conn) {
+			continue;
+		}
+		if (enabled) {
+			link_subscribe(&links[i]);
+		} else {
+			link_unsubscribe(&links[i]);
+		}
+	}
+	LOG_INF("Relay %s", enabled ? "enabled" : "disabled");
+}
+
+size_t relay_stats_get(struct relay_upstream_stats *upstream, struct relay_hop_stats *hops,
+		       size_t max)
+{
+	k_spinlock_key_t key = k_spin_lock(&relay_lock);
+	size_t count = 0;
+
+	*upstream = upstream_stats;
+	upstream->in_flight = tx_credits_in_flight(&relay_credits);
+	for (size_t i = 0; i < ARRAY_SIZE(links) && count < max; i++) {
+		if (links[i].conn) {
+			hops[count++] = links[i].stats;
+		}
+	}
+	k_spin_unlock(&relay_lock, key);
+
+	return count;
+}
+
+void relay_stats_reset(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&relay_lock);
+
+	memset(&upstream_stats, 0, sizeof(upstream_stats));
+	for (size_t i = 0; i < ARRAY_SIZE(links); i++) {
+		uint8_t queued = links[i].stats.queued;
+
+		memset(&links[i].stats, 0, sizeof(links[i].stats));
+		links[i].stats.link_index = i;
+		links[i].stats.queued = queued;
+	}
+	k_spin_unlock(&relay_lock, key);
+}
@@ -0,0 +1,142 @@
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gatt.h>
+
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(rssi_history, LOG_LEVEL_INF);
+
+#include "link_control_service.h"
+#include "rssi_history.h"
+
+#define HISTORY_MAX_SAMPLES CONFIG_LCS_RSSI_HISTORY_MAX_SAMPLES
+
+BUILD_ASSERT(HISTORY_MAX_SAMPLES <= UINT8_MAX, "Sample count must fit in the header");
+
+static struct {
+	struct bt_conn *conn;
+	bool enabled;
+	uint32_t first_ms;
+	uint32_t last_ms;
+	uint8_t count;
+	int8_t prev;
+	uint8_t pdu[sizeof(struct rssi_history_hdr) + HISTORY_MAX_SAMPLES - 1];
+} history;
+
+static K_MUTEX_DEFINE(history_mutex);
+
+static void flush_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(flush_work, flush_work_handler);
+
+/* Samples that fit in one notification on the current connection */
+static uint8_t batch_capacity(struct bt_conn *conn)
+{
+	uint16_t payload = bt_gatt_get_mtu(conn) - 3;
+
+	if (payload <= sizeof(struct rssi_history_hdr)) {
+		return 1;
+	}
+	return MIN(HISTORY_MAX_SAMPLES, payload - sizeof(struct rssi_history_hdr) + 1);
+}
+
+static void reset_locked(void)
+{
+	history.count = 0;
+	if (history.conn) {
+		bt_conn_unref(history.conn);
+		history.conn = NULL;
+	}
+}
+
+static void flush_locked(void)
+{
+	struct rssi_history_hdr *hdr = (void *)history.pdu;
+	uint16_t len;
+	int err;
+
+	if (!history.count) {
+		return;
+	}
+
+	hdr->count = history.count;
+	hdr->period_ms = history.count > 1 ?
+		sys_cpu_to_le16((history.last_ms - history.first_ms) / (history.count - 1)) : 0;
+	len = sizeof(*hdr) + history.count - 1;
+
+	err = notify_rssi_history(history.conn, history.pdu, len);
+	if (err) {
+		LOG_WRN("Failed to send RSSI history (err %d)", err);
+	}
+
+	history.count = 0;
+	k_work_cancel_delayable(&flush_work);
+}
+
+static void flush_work_handler(struct k_work *work)
+{
+	k_mutex_lock(&history_mutex, K_FOREVER);
+	flush_locked();
+	k_mutex_unlock(&history_mutex);
+}
+
+void rssi_history_set_enabled(bool enabled)
+{
+	k_mutex_lock(&history_mutex, K_FOREVER);
+	history.enabled = enabled;
+	if (!enabled) {
+		reset_locked();
+	}
+	k_mutex_unlock(&history_mutex);
+}
+
+void rssi_history_add(struct bt_conn *conn, int8_t rssi, uint32_t time_ms)
+{
+	struct rssi_history_hdr *hdr = (void *)history.pdu;
+
+	k_mutex_lock(&history_mutex, K_FOREVER);
+
+	if (!history.enabled || !conn) {
+		goto unlock;
+	}
+
+	if (history.conn != conn) {
+		flush_locked();
+		reset_locked();
+		history.conn = bt_conn_ref(conn);
+	}
+
+	if (history.count == 0) {
+		history.first_ms = time_ms;
+		hdr->timestamp_ms = sys_cpu_to_le32(time_ms);
+		hdr->rssi = rssi;
+		history.prev = rssi;
+		k_work_schedule(&flush_work, K_MSEC(CONFIG_LCS_RSSI_HISTORY_FLUSH_MS));
+	} else {
+		/* Clamp and track the decoded value so errors do not accumulate */
+		int8_t delta = CLAMP(rssi - history.prev, INT8_MIN, INT8_MAX);
+
+		history.pdu[sizeof(*hdr) + history.count - 1] = delta;
+		history.prev += delta;
+	}
+
+	history.last_ms = time_ms;
+	history.count++;
+
+	if (history.count >= MIN(CONFIG_LCS_RSSI_HISTORY_WATERMARK, batch_capacity(conn))) {
+		flush_locked();
+	}
+
+unlock:
+	k_mutex_unlock(&history_mutex);
+}
+
+void rssi_history_clear(struct bt_conn *conn)
+{
+	k_mutex_lock(&history_mutex, K_FOREVER);
+	if (history.conn == conn) {
+		k_work_cancel_delayable(&flush_work);
+		reset_locked();
+	}
+	k_mutex_unlock(&history_mutex);
+}
@@ -0,0 +1,307 @@
+#include <stddef.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/hci.h>
+#include <zephyr/bluetooth/hci_vs.h>
+#include <sdc_hci_vs.h>
+
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(rssi_sampler, LOG_LEVEL_INF);
+
+#include "lcs_hci.h"
+#include "rssi_sampler.h"
+#include "rssi_history.h"
+#include "link_metrics.h"
+
+#if IS_ENABLED(CONFIG_LCS_RSSI_HISTORY)
+#define RING_SIZE CONFIG_LCS_RSSI_RING_SIZE
+#define RING_MASK (RING_SIZE - 1)
+
+BUILD_ASSERT((RING_SIZE & RING_MASK) == 0, "RSSI ring size must be a power of two");
+#endif
+
+/* EWMA is kept in 1/16 dB so small steps are not lost to rounding */
+#define EWMA_FRAC_BITS 4
+
+/* Samples since the last read of the sampler */
+struct rssi_agg {
+	int8_t min;
+	int8_t max;
+	int32_t sum;
+	uint32_t count;
+	uint16_t dropped;
+};
+
+/*
+ * Per connection state. The BT RX thread is the only writer of the aggregate,
+ * the EWMA, the counters and the ring head, for every connection event
+ * report, and takes no lock to do so. The one reader of each connection
+ * owns the ring tail and the read copies of the counters.
+ *
+ * The aggregate is double buffered: the reader points the writer at the
+ * other buffer, waits for an update in progress to finish, then reads and
+ * clears the old one. The ring only exists for the RSSI history; when it is
+ * full new samples are dropped and counted.
+ */
+struct rssi_ring {
+	atomic_t active;
+	uint16_t conn_handle;
+	struct rssi_agg agg[2];
+	atomic_t agg_index;
+	atomic_t agg_busy;
+	atomic_t ewma;
+	bool ewma_valid;
+	/* Running totals, the reader reports the difference to its last read */
+	atomic_t events;
+	atomic_t rx_packets;
+	atomic_t crc_errors;
+	uint32_t events_read;
+	uint32_t rx_packets_read;
+	uint32_t crc_errors_read;
+#if IS_ENABLED(CONFIG_LCS_RSSI_HISTORY)
+	atomic_t head;
+	atomic_t tail;
+	int8_t samples[RING_SIZE];
+	/* Uptime at which each sample's report arrived */
+	uint32_t times_ms[RING_SIZE];
+#endif
+};
+
+static struct rssi_ring rings[CONFIG_BT_MAX_CONN];
+
+static struct rssi_ring *ring_by_handle(uint16_t conn_handle)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(rings); i++) {
+		if (atomic_get(&rings[i].active) && rings[i].conn_handle == conn_handle) {
+			return &rings[i];
+		}
+	}
+	return NULL;
+}
+
+#if IS_ENABLED(CONFIG_LCS_RSSI_HISTORY)
+/* Called from the BT RX thread only, returns false if the ring is full */
+static bool history_push(struct rssi_ring *ring, int8_t rssi, uint32_t time_ms)
+{
+	uint32_t head = atomic_get(&ring->head);
+
+	if (head - (uint32_t)atomic_get(&ring->tail) >= RING_SIZE) {
+		return false;
+	}
+
+	ring->times_ms[head & RING_MASK] = time_ms;
+	ring->samples[head & RING_MASK] = rssi;
+	atomic_inc(&ring->head);
+	return true;
+}
+
+/* Hand the buffered samples to the RSSI history */
+static void history_drain(struct bt_conn *conn, struct rssi_ring *ring)
+{
+	uint32_t tail = atomic_get(&ring->tail);
+
+	while (tail != (uint32_t)atomic_get(&ring->head)) {
+		rssi_history_add(conn, ring->samples[tail & RING_MASK],
+				 ring->times_ms[tail & RING_MASK]);
+		atomic_inc(&ring->tail);
+		tail++;
+	}
+}
+#endif
+
+/* Called from the BT RX thread only */
+static void sample_add(struct rssi_ring *ring, int8_t rssi, uint32_t time_ms)
+{
+	struct rssi_agg *agg;
+
+	atomic_set(&ring->agg_busy, 1);
+	agg = &ring->agg[atomic_get(&ring->agg_index)];
+	if (!agg->count) {
+		agg->min = rssi;
+		agg->max = rssi;
+	} else {
+		agg->min = MIN(agg->min, rssi);
+		agg->max = MAX(agg->max, rssi);
+	}
+	agg->sum += rssi;
+	agg->count++;
+
+#if IS_ENABLED(CONFIG_LCS_RSSI_HISTORY)
+	if (!history_push(ring, rssi, time_ms)) {
+		agg->dropped++;
+	}
+#endif
+	atomic_set(&ring->agg_busy, 0);
+
+	if (!ring->ewma_valid) {
+		atomic_set(&ring->ewma, rssi * (1 << EWMA_FRAC_BITS));
+		ring->ewma_valid = true;
+	} else {
+		atomic_val_t ewma = atomic_get(&ring->ewma);
+
+		atomic_set(&ring->ewma, ewma + (((rssi * (1 << EWMA_FRAC_BITS)) - ewma) >>
+						CONFIG_LCS_RSSI_EWMA_SHIFT));
+	}
+}
+
+static bool on_vs_evt(struct net_buf_simple *buf)
+{
+	/* Reports arrive right after their event, close enough to time it */
+	uint32_t now_ms = k_uptime_get_32();
+	struct lcs_hci_qos_report report;
+	struct rssi_ring *ring;
+	int err;
+
+	err = lcs_hci_qos_report_decode(buf->data, buf->len, &report);
+	if (err == -ENOMSG) {
+		return false;
+	} else if (err) {
+		return true;
+	}
+
+	ring = ring_by_handle(report.conn_handle);
+	if (!ring) {
+		return true;
+	}
+
+	atomic_inc(&ring->events);
+	atomic_add(&ring->rx_packets, report.rx_packets);
+	atomic_add(&ring->crc_errors, report.crc_errors);
+
+	/* No packet received in this event, nothing was measured */
+	if (report.rx_packets) {
+		sample_add(ring, report.rssi, now_ms);
+	}
+
+	if (IS_ENABLED(CONFIG_LCS_LINK_METRICS)) {
+		link_metrics_report(ARRAY_INDEX(rings, ring), &report);
+	}
+
+	return true;
+}
+
+int rssi_sampler_init(void)
+{
+	sdc_hci_cmd_vs_qos_conn_event_report_enable_t *cmd_enable;
+	struct net_buf *buf;
+	int err;
+
+	err = bt_hci_register_vnd_evt_cb(on_vs_evt);
+	if (err) {
+		LOG_ERR("Failed to register vendor event callback (err %d)", err);
+		return err;
+	}
+
+	buf = bt_hci_cmd_create(SDC_HCI_OPCODE_CMD_VS_QOS_CONN_EVENT_REPORT_ENABLE,
+				sizeof(*cmd_enable));
+	if (!buf) {
+		LOG_ERR("Could not allocate command buffer");
+		return -ENOMEM;
+	}
+
+	cmd_enable = net_buf_add(buf, sizeof(*cmd_enable));
+	cmd_enable->enable = true;
+
+	err = bt_hci_cmd_send_sync(SDC_HCI_OPCODE_CMD_VS_QOS_CONN_EVENT_REPORT_ENABLE,
+				   buf, NULL);
+	if (err) {
+		LOG_ERR("Failed to enable connection event reports (err %d)", err);
+		return err;
+	}
+
+	return 0;
+}
+
+int rssi_sampler_start(struct bt_conn *conn)
+{
+	struct rssi_ring *ring = &rings[bt_conn_index(conn)];
+	uint16_t conn_handle;
+	int err;
+
+	err = bt_hci_get_conn_handle(conn, &conn_handle);
+	if (err) {
+		return err;
+	}
+
+	/* Inactive, so the BT RX thread does not touch it */
+	memset(ring, 0, sizeof(*ring));
+	ring->conn_handle = conn_handle;
+	atomic_set(&ring->active, 1);
+
+	return 0;
+}
+
+void rssi_sampler_stop(struct bt_conn *conn)
+{
+	atomic_set(&rings[bt_conn_index(conn)].active, 0);
+}
+
+/* Move the BT RX thread to the other aggregate and return the one it left */
+static struct rssi_agg *agg_take(struct rssi_ring *ring)
+{
+	atomic_val_t index = atomic_get(&ring->agg_index);
+
+	atomic_set(&ring->agg_index, !index);
+	/* The writer may be a lower priority thread preempted mid update */
+	while (atomic_get(&ring->agg_busy)) {
+		k_sleep(K_TICKS(1));
+	}
+
+	return &ring->agg[index];
+}
+
+int rssi_sampler_get(struct bt_conn *conn, struct rssi_stats *stats)
+{
+	struct rssi_ring *ring = &rings[bt_conn_index(conn)];
+	struct rssi_agg *agg;
+	int err = 0;
+
+	if (!atomic_get(&ring->active)) {
+		return -ENODATA;
+	}
+
+	agg = agg_take(ring);
+	if (!agg->count) {
+		err = -ENODATA;
+	} else {
+		stats->min = agg->min;
+		stats->max = agg->max;
+		stats->mean = agg->sum / (int32_t)agg->count;
+		stats->ewma = atomic_get(&ring->ewma) >> EWMA_FRAC_BITS;
+		stats->count = MIN(agg->count, UINT16_MAX);
+		stats->dropped = agg->dropped;
+	}
+	memset(agg, 0, sizeof(*agg));
+
+#if IS_ENABLED(CONFIG_LCS_RSSI_HISTORY)
+	history_drain(conn, ring);
+#endif
+
+	return err;
+}
+
+int rssi_sampler_get_counters(struct bt_conn *conn, struct conn_event_counters *counters)
+{
+	struct rssi_ring *ring = &rings[bt_conn_index(conn)];
+	uint32_t events, rx_packets, crc_errors;
+
+	if (!atomic_get(&ring->active)) {
+		return -ENOTCONN;
+	}
+
+	events = atomic_get(&ring->events);
+	rx_packets = atomic_get(&ring->rx_packets);
+	crc_errors = atomic_get(&ring->crc_errors);
+
+	counters->events = events - ring->events_read;
+	counters->rx_packets = rx_packets - ring->rx_packets_read;
+	counters->crc_errors = crc_errors - ring->crc_errors_read;
+	ring->events_read = events;
+	ring->rx_packets_read = rx_packets;
+	ring->crc_errors_read = crc_errors;
+
+	return 0;
+}
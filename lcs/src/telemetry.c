@@ -0,0 +1,426 @@
+#include <stdlib.h>
+#include <zephyr/kernel.h>
+#include <zephyr/fs/fcb.h>
+#include <zephyr/storage/flash_map.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gap.h>
+#include <zephyr/shell/shell.h>
+
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(telemetry, LOG_LEVEL_INF);
+
+#include "telemetry.h"
+
+/*
+ * Records are appended to a flash circular buffer on the telemetry
+ * partition. FCB keeps a CRC per entry, so a record torn by a power loss
+ * is skipped on the next boot, and erases the oldest sector when full.
+ * Records are queued from any context and written from the system work
+ * queue.
+ */
+
+#define TELEMETRY_PARTITION_ID FIXED_PARTITION_ID(telemetry_part)
+#define TELEMETRY_FCB_MAGIC    0x314D4C54
+#define TELEMETRY_FCB_VERSION  1
+
+static struct fcb fcb;
+static struct flash_sector sectors[CONFIG_LCS_TELEMETRY_MAX_SECTORS];
+static bool initialized;
+static uint32_t next_seq;
+static atomic_t dropped;
+
+/* Latest state of each link, copied into every record */
+static struct telemetry_record links[CONFIG_BT_MAX_CONN];
+static struct k_spinlock links_lock;
+
+K_MSGQ_DEFINE(telemetry_msgq, sizeof(struct telemetry_record),
+	      CONFIG_LCS_TELEMETRY_QUEUE_SIZE, 4);
+
+static int append(struct telemetry_record *record)
+{
+	struct fcb_entry loc;
+	int err;
+
+	record->seq = next_seq;
+
+	err = fcb_append(&fcb, sizeof(*record), &loc);
+	if (err == -ENOSPC) {
+		err = fcb_rotate(&fcb);
+		if (err == 0) {
+			err = fcb_append(&fcb, sizeof(*record), &loc);
+		}
+	}
+	if (err) {
+		return err;
+	}
+
+	err = flash_area_write(fcb.fap, FCB_ENTRY_FA_DATA_OFF(loc), record, sizeof(*record));
+	if (err) {
+		return err;
+	}
+
+	err = fcb_append_finish(&fcb, &loc);
+	if (err) {
+		return err;
+	}
+
+	next_seq++;
+	return 0;
+}
+
+static void telemetry_work_handler(struct k_work *work)
+{
+	struct telemetry_record record;
+	int err;
+
+	if (!initialized) {
+		return;
+	}
+
+	while (k_msgq_get(&telemetry_msgq, &record, K_NO_WAIT) == 0) {
+		err = append(&record);
+		if (err) {
+			LOG_ERR("Failed to append record (err %d)", err);
+			atomic_inc(&dropped);
+		}
+	}
+}
+
+static K_WORK_DEFINE(telemetry_work, telemetry_work_handler);
+
+static void record_link(uint8_t index, enum telemetry_type type)
+{
+	struct telemetry_record record;
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&links_lock);
+	record = links[index];
+	k_spin_unlock(&links_lock, key);
+
+	record.type = type;
+	record.conn_index = index;
+	record.timestamp_ms = k_uptime_get_32();
+
+	if (k_msgq_put(&telemetry_msgq, &record, K_NO_WAIT)) {
+		atomic_inc(&dropped);
+		return;
+	}
+
+	k_work_submit(&telemetry_work);
+}
+
+void telemetry_sample(struct bt_conn *conn, int8_t rssi,
+		      const struct conn_event_counters *counters)
+{
+	uint8_t index = bt_conn_index(conn);
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&links_lock);
+	links[index].rssi = rssi;
+	if (counters) {
+		links[index].events = MIN(counters->events, UINT16_MAX);
+		links[index].rx_packets = MIN(counters->rx_packets, UINT16_MAX);
+		links[index].crc_errors = MIN(counters->crc_errors, UINT16_MAX);
+	}
+	k_spin_unlock(&links_lock, key);
+
+	record_link(index, TELEMETRY_SAMPLE);
+}
+
+void telemetry_tx_power(uint8_t conn_index, int8_t tx_power)
+{
+	k_spinlock_key_t key;
+
+	if (conn_index >= ARRAY_SIZE(links)) {
+		return;
+	}
+
+	key = k_spin_lock(&links_lock);
+	links[conn_index].tx_power = tx_power;
+	k_spin_unlock(&links_lock, key);
+
+	record_link(conn_index, TELEMETRY_TX_POWER);
+}
+
+struct walk_ctx {
+	uint32_t first_seq;
+	telemetry_walk_cb_t cb;
+	void *user_data;
+};
+
+static int walk_cb(struct fcb_entry_ctx *loc_ctx, void *arg)
+{
+	struct walk_ctx *ctx = arg;
+	struct telemetry_record record;
+
+	if (loc_ctx->loc.fe_data_len != sizeof(record) ||
+	    flash_area_read(loc_ctx->fap, FCB_ENTRY_FA_DATA_OFF(loc_ctx->loc), &record,
+			    sizeof(record))) {
+		return 0;
+	}
+
+	if (record.seq < ctx->first_seq) {
+		return 0;
+	}
+
+	return ctx->cb(&record, ctx->user_data) ? 0 : 1;
+}
+
+int telemetry_walk(uint32_t first_seq, telemetry_walk_cb_t cb, void *user_data)
+{
+	struct walk_ctx ctx = {
+		.first_seq = first_seq,
+		.cb = cb,
+		.user_data = user_data,
+	};
+	int err;
+
+	if (!initialized) {
+		return -EAGAIN;
+	}
+
+	err = fcb_walk(&fcb, NULL, walk_cb, &ctx);
+	return err > 0 ? 0 : err;
+}
+
+static bool first_cb(const struct telemetry_record *record, void *user_data)
+{
+	*(uint32_t *)user_data = record->seq;
+	return false;
+}
+
+void telemetry_range(uint32_t *first_seq, uint32_t *next)
+{
+	*first_seq = next_seq;
+	telemetry_walk(0, first_cb, first_seq);
+	*next = next_seq;
+}
+
+int telemetry_clear(void)
+{
+	int err;
+
+	if (!initialized) {
+		return -EAGAIN;
+	}
+
+	k_work_cancel(&telemetry_work);
+	err = fcb_clear(&fcb);
+	next_seq = 0;
+	return err;
+}
+
+static bool last_cb(const struct telemetry_record *record, void *user_data)
+{
+	next_seq = record->seq + 1;
+	return true;
+}
+
+int telemetry_init(void)
+{
+	uint32_t sector_cnt = ARRAY_SIZE(sectors);
+	struct walk_ctx ctx = {
+		.cb = last_cb,
+	};
+	const struct flash_area *fa;
+	int err;
+
+	err = flash_area_get_sectors(TELEMETRY_PARTITION_ID, &sector_cnt, sectors);
+	if (err) {
+		LOG_ERR("Failed to get telemetry sectors (err %d)", err);
+		return err;
+	}
+
+	fcb.f_magic = TELEMETRY_FCB_MAGIC;
+	fcb.f_version = TELEMETRY_FCB_VERSION;
+	fcb.f_sector_cnt = sector_cnt;
+	fcb.f_scratch_cnt = 0;
+	fcb.f_sectors = sectors;
+
+	err = fcb_init(TELEMETRY_PARTITION_ID, &fcb);
+	if (err) {
+		/* Not an FCB of ours, start from an erased partition */
+		LOG_WRN("Formatting telemetry partition (err %d)", err);
+		err = flash_area_open(TELEMETRY_PARTITION_ID, &fa);
+		if (err == 0) {
+			err = flash_area_erase(fa, 0, fa->fa_size);
+			flash_area_close(fa);
+		}
+		if (err == 0) {
+			err = fcb_init(TELEMETRY_PARTITION_ID, &fcb);
+		}
+		if (err) {
+			LOG_ERR("Failed to init telemetry storage (err %d)", err);
+			return err;
+		}
+	}
+
+	/* Records are in order, the newest is in the active sector */
+	fcb_walk(&fcb, fcb.f_active.fe_sector, walk_cb, &ctx);
+	if (next_seq == 0) {
+		fcb_walk(&fcb, NULL, walk_cb, &ctx);
+	}
+
+	initialized = true;
+	LOG_INF("Telemetry: %u sectors, next record %u", sector_cnt, next_seq);
+
+	/* Write what was recorded before we were ready */
+	k_work_submit(&telemetry_work);
+	return 0;
+}
+
+static void connected(struct bt_conn *conn, uint8_t err)
+{
+	uint8_t index = bt_conn_index(conn);
+	struct bt_conn_info info;
+	k_spinlock_key_t key;
+
+	if (err || bt_conn_get_info(conn, &info)) {
+		return;
+	}
+
+	key = k_spin_lock(&links_lock);
+	/* The TX power is reported by the application, whose callback may run first */
+	links[index] = (struct telemetry_record) {
+		.tx_power = links[index].tx_power,
+		.phy = BT_GAP_LE_PHY_1M,
+		.interval = info.le.interval,
+		.latency = info.le.latency,
+	};
+	k_spin_unlock(&links_lock, key);
+
+	record_link(index, TELEMETRY_CONNECTED);
+}
+
+static void disconnected(struct bt_conn *conn, uint8_t reason)
+{
+	uint8_t index = bt_conn_index(conn);
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&links_lock);
+	links[index].reason = reason;
+	k_spin_unlock(&links_lock, key);
+
+	record_link(index, TELEMETRY_DISCONNECTED);
+}
+
+static void le_param_updated(struct bt_conn *conn, uint16_t interval, uint16_t latency,
+			     uint16_t timeout)
+{
+	uint8_t index = bt_conn_index(conn);
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&links_lock);
+	links[index].interval = interval;
+	links[index].latency = latency;
+	k_spin_unlock(&links_lock, key);
+
+	record_link(index, TELEMETRY_CONN_PARAMS);
+}
+
+#if IS_ENABLED(CONFIG_BT_USER_PHY_UPDATE)
+static void le_phy_updated(struct bt_conn *conn, struct bt_conn_le_phy_info *info)
+{
+	uint8_t index = bt_conn_index(conn);
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&links_lock);
+	links[index].phy = info->tx_phy;
+	k_spin_unlock(&links_lock, key);
+
+	record_link(index, TELEMETRY_PHY);
+}
+#endif
+
+BT_CONN_CB_DEFINE(telemetry_callbacks) = {
+	.connected = connected,
+	.disconnected = disconnected,
+	.le_param_updated = le_param_updated,
+#if IS_ENABLED(CONFIG_BT_USER_PHY_UPDATE)
+	.le_phy_updated = le_phy_updated,
+#endif
+};
+
+#if defined(CONFIG_SHELL)
+static const char *const type_str[] = {
+	[TELEMETRY_CONNECTED] = "conn",
+	[TELEMETRY_DISCONNECTED] = "disc",
+	[TELEMETRY_SAMPLE] = "sample",
+	[TELEMETRY_TX_POWER] = "txpwr",
+	[TELEMETRY_PHY] = "phy",
+	[TELEMETRY_CONN_PARAMS] = "params",
+};
+
+struct dump_ctx {
+	const struct shell *shell;
+	uint32_t remaining;
+};
+
+static bool dump_cb(const struct telemetry_record *r, void *user_data)
+{
+	struct dump_ctx *ctx = user_data;
+
+	shell_print(ctx->shell, "%u,%u,%s,%u,%d,%d,%u,%u,%u,%u,%u,%u,%u", r->seq,
+		    r->timestamp_ms, r->type < ARRAY_SIZE(type_str) ? type_str[r->type] : "?",
+		    r->conn_index, r->rssi, r->tx_power, r->phy, r->reason, r->interval,
+		    r->latency, r->events, r->rx_packets, r->crc_errors);
+
+	return --ctx->remaining > 0;
+}
+
+static int cmd_telemetry_info(const struct shell *shell, size_t argc, char **argv)
+{
+	uint32_t first, next;
+
+	telemetry_range(&first, &next);
+	shell_print(shell, "Records %u..%u (%u), %u sectors of %u bytes, %ld dropped", first,
+		    next, next - first, fcb.f_sector_cnt, sectors[0].fs_size,
+		    atomic_get(&dropped));
+	return 0;
+}
+
+static int cmd_telemetry_dump(const struct shell *shell, size_t argc, char **argv)
+{
+	uint32_t first, next;
+	struct dump_ctx ctx = {
+		.shell = shell,
+		.remaining = UINT32_MAX,
+	};
+
+	telemetry_range(&first, &next);
+	if (argc > 1) {
+		first = strtoul(argv[1], NULL, 0);
+	}
+	if (argc > 2) {
+		ctx.remaining = strtoul(argv[2], NULL, 0);
+	}
+	if (ctx.remaining == 0) {
+		return 0;
+	}
+
+	shell_print(shell, "seq,time_ms,type,conn,rssi,tx_power,phy,reason,interval,"
+		    "latency,events,rx_packets,crc_errors");
+	return telemetry_walk(first, dump_cb, &ctx);
+}
+
+static int cmd_telemetry_clear(const struct shell *shell, size_t argc, char **argv)
+{
+	int err = telemetry_clear();
+
+	if (err) {
+		shell_error(shell, "Failed to clear telemetry (err %d)", err);
+	}
+	return err;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(telemetry_cmds,
+	SHELL_CMD(info, NULL, "Show stored record range", cmd_telemetry_info),
+	SHELL_CMD_ARG(dump, NULL, "Dump records as CSV [first seq] [count]",
+		      cmd_telemetry_dump, 1, 2),
+	SHELL_CMD(clear, NULL, "Erase all records", cmd_telemetry_clear),
+	SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(telemetry, &telemetry_cmds, "Link telemetry commands", NULL);
+#endif
@@ -0,0 +1,432 @@
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/crc.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gatt.h>
+
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(throughput, LOG_LEVEL_INF);
+
+#include "link_control.h"
+#include "link_control_service.h"
+#include "throughput.h"
+#include "link_metrics.h"
+#include "conn_params.h"
+#include "tx_credits.h"
+
+#define THROUGHPUT_PAYLOAD_LEN (CONFIG_BT_L2CAP_TX_MTU - 3)
+#define THROUGHPUT_DEPTH       CONFIG_LCS_THROUGHPUT_PIPELINE_DEPTH
+
+BUILD_ASSERT(THROUGHPUT_DEPTH <= CONFIG_BT_BUF_ACL_TX_COUNT,
+	     "Pipeline depth exceeds the number of ACL TX buffers");
+
+#define PKT_HDR_LEN sizeof(struct throughput_pkt_hdr)
+#define PKT_CRC_LEN offsetof(struct throughput_pkt_hdr, crc)
+
+/* Headers in front of a packet in the first LL fragment */
+#define NOTIFY_OVERHEAD  7 /* L2CAP header, ATT opcode and handle */
+#define SDU_OVERHEAD     6 /* L2CAP header and SDU length */
+#define DATA_LEN_DEFAULT 27
+
+BUILD_ASSERT(THROUGHPUT_PAYLOAD_LEN >= PKT_HDR_LEN, "ATT MTU too small for the header");
+
+/*
+ * The filler is generated at build time (see CONFIG_LCS_THROUGHPUT_PATTERN)
+ * and only the header is written per packet. The host copies the packet into
+ * the ATT PDU inside bt_gatt_notify_cb(), so the same buffer can be reused
+ * immediately for the next notification. SDUs on an L2CAP channel are copied
+ * the same way. Packets are cut from the front of the buffer, so a shorter one
+ * carries the start of the pattern.
+ */
+static uint8_t payload[THROUGHPUT_PAYLOAD_LEN] = {
+#include "throughput_pattern.inc"
+};
+static uint32_t sequence;
+
+/*
+ * Queueing time and length of the notifications in flight. Completions come
+ * in order and there are at most THROUGHPUT_DEPTH in flight, so the slot of a
+ * sequence number is free again by the time it is reused.
+ */
+struct pending_pkt {
+	uint32_t queued_at;
+	uint16_t len;
+};
+
+static struct pending_pkt pending[THROUGHPUT_DEPTH];
+
+/* Maximum LL payload of each link towards its peer */
+static atomic_t tx_octets[CONFIG_BT_MAX_CONN];
+
+/* One credit per packet that may be in flight, notification or SDU */
+TX_CREDITS_DEFINE(tx_credits, THROUGHPUT_DEPTH);
+static K_SEM_DEFINE(tx_start, 0, 1);
+static atomic_t tx_enabled;
+static atomic_t bytes_sent;
+
+struct link_stats {
+	struct throughput_stats s;
+	int64_t start;
+	uint64_t latency_sum_us;
+};
+
+struct link_rx_stats {
+	struct throughput_rx_stats s;
+	int64_t first;
+	bool started;
+};
+
+static struct link_stats link_stats[CONFIG_BT_MAX_CONN];
+static struct link_rx_stats link_rx_stats[CONFIG_BT_MAX_CONN][THROUGHPUT_RX_PATHS];
+static struct k_spinlock stats_lock;
+
+static void stats_reset(uint8_t index)
+{
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+	memset(&link_stats[index], 0, sizeof(link_stats[index]));
+	link_stats[index].s.link_index = index;
+	link_stats[index].start = k_uptime_get();
+
+	memset(link_rx_stats[index], 0, sizeof(link_rx_stats[index]));
+	for (int path = 0; path < THROUGHPUT_RX_PATHS; path++) {
+		link_rx_stats[index][path].s.link_index = index;
+		link_rx_stats[index][path].s.path = path;
+	}
+	k_spin_unlock(&stats_lock, key);
+}
+
+static void stats_queued(struct bt_conn *conn, uint16_t len, int err)
+{
+	struct throughput_stats *s = &link_stats[bt_conn_index(conn)].s;
+	k_spinlock_key_t key;
+
+	if (!IS_ENABLED(CONFIG_LCS_THROUGHPUT_STATS)) {
+		return;
+	}
+
+	key = k_spin_lock(&stats_lock);
+	if (err == 0) {
+		s->bytes_queued += len;
+		s->packets_queued++;
+	} else if (err == -ENOMEM) {
+		s->nomem_stalls++;
+	} else {
+		s->errors++;
+	}
+	k_spin_unlock(&stats_lock, key);
+}
+
+/* Called with the cycle count at which the notification was queued */
+static void stats_completed(struct bt_conn *conn, uint16_t len, uint32_t queued_at)
+{
+	struct link_stats *ls = &link_stats[bt_conn_index(conn)];
+	uint32_t latency_us = k_cyc_to_us_floor32(k_cycle_get_32() - queued_at);
+	uint32_t latency_ms = latency_us / USEC_PER_MSEC;
+	uint8_t bin = 0;
+	k_spinlock_key_t key;
+
+	if (!IS_ENABLED(CONFIG_LCS_THROUGHPUT_STATS)) {
+		return;
+	}
+
+	if (latency_ms) {
+		bin = MIN(32 - __builtin_clz(latency_ms), THROUGHPUT_LATENCY_BINS - 1);
+	}
+
+	key = k_spin_lock(&stats_lock);
+	ls->s.bytes_completed += len;
+	ls->s.packets_completed++;
+	ls->s.latency_max_us = MAX(ls->s.latency_max_us, latency_us);
+	ls->s.latency_hist[bin]++;
+	ls->latency_sum_us += latency_us;
+	k_spin_unlock(&stats_lock, key);
+}
+
+int throughput_stats_get(struct bt_conn *conn, struct throughput_stats *stats)
+{
+	struct link_stats *ls = &link_stats[bt_conn_index(conn)];
+	k_spinlock_key_t key;
+
+	if (!IS_ENABLED(CONFIG_LCS_THROUGHPUT_STATS)) {
+		return -ENOTSUP;
+	}
+
+	key = k_spin_lock(&stats_lock);
+	*stats = ls->s;
+	stats->duration_ms = k_uptime_get() - ls->start;
+	if (ls->s.packets_completed) {
+		stats->latency_avg_us = ls->latency_sum_us / ls->s.packets_completed;
+	}
+	k_spin_unlock(&stats_lock, key);
+
+	return 0;
+}
+
+void throughput_stats_reset(struct bt_conn *conn)
+{
+	stats_reset(bt_conn_index(conn));
+}
+
+static uint16_t pkt_crc(const uint8_t *data, uint16_t len)
+{
+	uint16_t crc = crc16_ccitt(0xffff, data, PKT_CRC_LEN);
+
+	return crc16_ccitt(crc, &data[PKT_HDR_LEN], len - PKT_HDR_LEN);
+}
+
+static bool pkt_valid(const uint8_t *data, uint16_t len)
+{
+	const struct throughput_pkt_hdr *hdr = (const void *)data;
+
+	if (len < PKT_HDR_LEN) {
+		return false;
+	}
+
+	return !(sys_le16_to_cpu(hdr->flags) & THROUGHPUT_PKT_CRC) ||
+	       pkt_crc(data, len) == sys_le16_to_cpu(hdr->crc);
+}
+
+void throughput_rx(struct bt_conn *conn, enum throughput_rx_path path, const uint8_t *data,
+		   uint16_t len)
+{
+	struct link_rx_stats *rx = &link_rx_stats[bt_conn_index(conn)][path];
+	const struct throughput_pkt_hdr *hdr = (const void *)data;
+	bool valid = pkt_valid(data, len);
+	int64_t now = k_uptime_get();
+	k_spinlock_key_t key;
+	uint32_t seq;
+
+	if (IS_ENABLED(CONFIG_LCS_LINK_METRICS)) {
+		link_metrics_rx(conn, len);
+	}
+	if (IS_ENABLED(CONFIG_LCS_CONN_PARAMS)) {
+		conn_params_activity(conn, len);
+	}
+
+	key = k_spin_lock(&stats_lock);
+	if (!valid) {
+		rx->s.bad++;
+		k_spin_unlock(&stats_lock, key);
+		return;
+	}
+
+	seq = sys_le32_to_cpu(hdr->seq);
+	if (!rx->started) {
+		rx->started = true;
+		rx->first = now;
+		rx->s.last_seq = seq;
+	} else if (seq > rx->s.last_seq) {
+		if (seq != rx->s.last_seq + 1) {
+			rx->s.gaps++;
+			rx->s.lost += seq - rx->s.last_seq - 1;
+		}
+		rx->s.last_seq = seq;
+	} else {
+		rx->s.late++;
+	}
+
+	rx->s.bytes += len;
+	rx->s.packets++;
+	rx->s.duration_ms = now - rx->first;
+	k_spin_unlock(&stats_lock, key);
+}
+
+void throughput_rx_stats_get(struct bt_conn *conn, struct throughput_rx_stats *stats)
+{
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+	for (int path = 0; path < THROUGHPUT_RX_PATHS; path++) {
+		stats[path] = link_rx_stats[bt_conn_index(conn)][path].s;
+	}
+	k_spin_unlock(&stats_lock, key);
+}
+
+static void notification_sent(struct bt_conn *conn, void *user_data)
+{
+	const struct pending_pkt *pkt = user_data;
+
+	atomic_add(&bytes_sent, pkt->len);
+	if (IS_ENABLED(CONFIG_LCS_LINK_METRICS)) {
+		link_metrics_tx(conn, pkt->len);
+	}
+	if (IS_ENABLED(CONFIG_LCS_CONN_PARAMS)) {
+		conn_params_activity(conn, pkt->len);
+	}
+	stats_completed(conn, pkt->len, pkt->queued_at);
+	tx_credits_release(&tx_credits, 1);
+}
+
+void throughput_l2cap_sent(struct bt_conn *conn, uint16_t len, uint32_t queued_at)
+{
+	atomic_add(&bytes_sent, len);
+	if (IS_ENABLED(CONFIG_LCS_LINK_METRICS)) {
+		link_metrics_tx(conn, len);
+	}
+	if (IS_ENABLED(CONFIG_LCS_CONN_PARAMS)) {
+		conn_params_activity(conn, len);
+	}
+	stats_completed(conn, len, queued_at);
+	tx_credits_release(&tx_credits, 1);
+}
+
+void throughput_l2cap_closed(struct bt_conn *conn, uint8_t dropped)
+{
+	/* SDUs still queued on the channel never complete */
+	tx_credits_release(&tx_credits, dropped);
+}
+
+void throughput_set_enabled(bool enabled)
+{
+	atomic_set(&tx_enabled, enabled);
+
+	if (enabled) {
+		k_sem_give(&tx_start);
+	}
+}
+
+uint32_t throughput_bytes_sent(void)
+{
+	return atomic_clear(&bytes_sent);
+}
+
+static void pkt_build(uint16_t len)
+{
+	struct throughput_pkt_hdr *hdr = (void *)payload;
+
+	hdr->seq = sys_cpu_to_le32(sequence);
+	hdr->timestamp_us = sys_cpu_to_le32((uint32_t)k_ticks_to_us_floor64(k_uptime_ticks()));
+	hdr->flags = sys_cpu_to_le16(IS_ENABLED(CONFIG_LCS_THROUGHPUT_CRC) ?
+				     THROUGHPUT_PKT_CRC : 0);
+	if (IS_ENABLED(CONFIG_LCS_THROUGHPUT_CRC)) {
+		hdr->crc = sys_cpu_to_le16(pkt_crc(payload, len));
+	}
+}
+
+/*
+ * Longest packet up to max that, after overhead bytes of headers, ends on an
+ * LL fragment boundary of conn. Packets shorter than one fragment are sent
+ * as they are.
+ */
+static uint16_t pkt_len(struct bt_conn *conn, uint16_t max, uint16_t overhead)
+{
+	uint16_t octets = atomic_get(&tx_octets[bt_conn_index(conn)]);
+	uint16_t len = MIN(max, sizeof(payload));
+	uint16_t aligned;
+
+	if (!IS_ENABLED(CONFIG_LCS_THROUGHPUT_ALIGN_FRAGMENTS) || !octets) {
+		return len;
+	}
+
+	aligned = (len + overhead) / octets * octets;
+	if (aligned < overhead + PKT_HDR_LEN) {
+		return len;
+	}
+	return aligned - overhead;
+}
+
+static void throughput_thread_fn(void)
+{
+	struct pending_pkt *pkt;
+	struct bt_conn *conn;
+	uint16_t len;
+	uint16_t coc_mtu;
+	int err;
+
+	while (true) {
+		conn = current_conn;
+		if (!atomic_get(&tx_enabled) || !conn) {
+			k_sem_take(&tx_start, K_FOREVER);
+			continue;
+		}
+
+		tx_credits_take(&tx_credits, conn, K_FOREVER);
+		if (!atomic_get(&tx_enabled) || conn != current_conn) {
+			tx_credits_cancel(&tx_credits);
+			continue;
+		}
+
+		/*
+		 * An open L2CAP channel carries the stream instead of
+		 * notifications. Sizes follow the MTU and data length in use,
+		 * so they adapt as soon as either is renegotiated.
+		 */
+		coc_mtu = IS_ENABLED(CONFIG_LCS_THROUGHPUT_L2CAP) ? throughput_l2cap_mtu(conn) : 0;
+		if (coc_mtu) {
+			len = pkt_len(conn, coc_mtu, SDU_OVERHEAD);
+		} else {
+			len = pkt_len(conn, bt_gatt_get_mtu(conn) - 3, NOTIFY_OVERHEAD);
+		}
+
+		pkt_build(len);
+
+		if (coc_mtu) {
+			err = throughput_l2cap_send(conn, payload, len);
+		} else {
+			/* The queueing time travels with the packet to measure completion latency */
+			pkt = &pending[sequence % THROUGHPUT_DEPTH];
+			pkt->queued_at = k_cycle_get_32();
+			pkt->len = len;
+			err = notify_throughput(conn, payload, len, notification_sent, pkt);
+		}
+		stats_queued(conn, len, err);
+		if (err == 0) {
+			sequence++;
+			continue;
+		}
+
+		tx_credits_cancel(&tx_credits);
+
+		if (!tx_credits_retry(err)) {
+			LOG_ERR("Failed to send notification (err %d)", err);
+			atomic_set(&tx_enabled, false);
+		}
+	}
+}
+
+K_THREAD_DEFINE(throughput_thread, CONFIG_LCS_THROUGHPUT_STACK_SIZE,
+		throughput_thread_fn, NULL, NULL, NULL,
+		CONFIG_LCS_THROUGHPUT_THREAD_PRIORITY, 0, 0);
+
+static void connected(struct bt_conn *conn, uint8_t err)
+{
+	struct bt_conn_info info;
+	uint16_t octets = DATA_LEN_DEFAULT;
+
+	if (err) {
+		return;
+	}
+
+	stats_reset(bt_conn_index(conn));
+
+#if IS_ENABLED(CONFIG_BT_USER_DATA_LEN_UPDATE)
+	if (!bt_conn_get_info(conn, &info)) {
+		octets = info.le.data_len->tx_max_len;
+	}
+#else
+	ARG_UNUSED(info);
+#endif
+	atomic_set(&tx_octets[bt_conn_index(conn)], octets);
+}
+
+#if IS_ENABLED(CONFIG_BT_USER_DATA_LEN_UPDATE)
+static void le_data_len_updated(struct bt_conn *conn, struct bt_conn_le_data_len_info *info)
+{
+	atomic_set(&tx_octets[bt_conn_index(conn)], info->tx_max_len);
+}
+#endif
+
+static void disconnected(struct bt_conn *conn, uint8_t reason)
+{
+	tx_credits_disconnected(&tx_credits, conn);
+}
+
+BT_CONN_CB_DEFINE(throughput_callbacks) = {
+	.connected = connected,
+	.disconnected = disconnected,
+#if IS_ENABLED(CONFIG_BT_USER_DATA_LEN_UPDATE)
+	.le_data_len_updated = le_data_len_updated,
+#endif
+};
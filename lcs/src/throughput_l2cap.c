@@ -0,0 +1,187 @@
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/net/buf.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/l2cap.h>
+
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(throughput_l2cap, LOG_LEVEL_INF);
+
+#include "throughput.h"
+
+#define SDU_TX_MAX_LEN (CONFIG_BT_L2CAP_TX_MTU - 3)
+#define SDU_DEPTH      CONFIG_LCS_THROUGHPUT_PIPELINE_DEPTH
+
+/* One buffer per credit of the throughput thread */
+NET_BUF_POOL_FIXED_DEFINE(sdu_tx_pool, SDU_DEPTH, BT_L2CAP_SDU_BUF_SIZE(SDU_TX_MAX_LEN),
+			  CONFIG_BT_CONN_TX_USER_DATA_SIZE, NULL);
+/* SDUs are reassembled one at a time per channel and counted in recv */
+NET_BUF_POOL_FIXED_DEFINE(sdu_rx_pool, CONFIG_BT_MAX_CONN,
+			  BT_L2CAP_SDU_BUF_SIZE(CONFIG_LCS_THROUGHPUT_L2CAP_RX_MTU), 8, NULL);
+
+struct pending_sdu {
+	uint16_t len;
+	uint32_t queued_at;
+};
+
+struct coc_link {
+	struct bt_l2cap_le_chan chan;
+	bool open;
+	/* SDUs in flight, the controller completes them in order */
+	struct pending_sdu pending[SDU_DEPTH];
+	uint8_t head;
+	uint8_t count;
+};
+
+static struct coc_link links[CONFIG_BT_MAX_CONN];
+static struct k_spinlock pending_lock;
+
+static struct coc_link *link_get(struct bt_l2cap_chan *chan)
+{
+	return CONTAINER_OF(BT_L2CAP_LE_CHAN(chan), struct coc_link, chan);
+}
+
+static struct net_buf *chan_alloc_buf(struct bt_l2cap_chan *chan)
+{
+	return net_buf_alloc(&sdu_rx_pool, K_NO_WAIT);
+}
+
+/* Returning 0 hands the buffer back and returns the credit to the peer */
+static int chan_recv(struct bt_l2cap_chan *chan, struct net_buf *buf)
+{
+	throughput_rx(chan->conn, THROUGHPUT_RX_L2CAP, buf->data, buf->len);
+	return 0;
+}
+
+static void chan_sent(struct bt_l2cap_chan *chan)
+{
+	struct coc_link *link = link_get(chan);
+	struct pending_sdu sdu;
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&pending_lock);
+	if (link->count == 0) {
+		k_spin_unlock(&pending_lock, key);
+		return;
+	}
+	sdu = link->pending[link->head];
+	link->head = (link->head + 1) % SDU_DEPTH;
+	link->count--;
+	k_spin_unlock(&pending_lock, key);
+
+	throughput_l2cap_sent(chan->conn, sdu.len, sdu.queued_at);
+}
+
+static void chan_connected(struct bt_l2cap_chan *chan)
+{
+	struct coc_link *link = link_get(chan);
+
+	link->head = 0;
+	link->count = 0;
+	link->open = true;
+	LOG_INF("Throughput channel open, tx mtu %u mps %u, rx mtu %u mps %u",
+		link->chan.tx.mtu, link->chan.tx.mps, link->chan.rx.mtu, link->chan.rx.mps);
+}
+
+static void chan_disconnected(struct bt_l2cap_chan *chan)
+{
+	struct coc_link *link = link_get(chan);
+	k_spinlock_key_t key = k_spin_lock(&pending_lock);
+	uint8_t dropped = link->count;
+
+	link->open = false;
+	link->count = 0;
+	k_spin_unlock(&pending_lock, key);
+
+	throughput_l2cap_closed(chan->conn, dropped);
+	LOG_INF("Throughput channel closed");
+}
+
+static const struct bt_l2cap_chan_ops chan_ops = {
+	.alloc_buf = chan_alloc_buf,
+	.recv = chan_recv,
+	.sent = chan_sent,
+	.connected = chan_connected,
+	.disconnected = chan_disconnected,
+};
+
+static int accept(struct bt_conn *conn, struct bt_l2cap_server *server,
+		  struct bt_l2cap_chan **chan)
+{
+	struct coc_link *link = &links[bt_conn_index(conn)];
+
+	if (link->open) {
+		LOG_WRN("Throughput channel already open");
+		return -ENOMEM;
+	}
+
+	memset(&link->chan, 0, sizeof(link->chan));
+	link->chan.chan.ops = &chan_ops;
+	link->chan.rx.mtu = CONFIG_LCS_THROUGHPUT_L2CAP_RX_MTU;
+	*chan = &link->chan.chan;
+
+	return 0;
+}
+
+static struct bt_l2cap_server server = {
+	.psm = CONFIG_LCS_THROUGHPUT_L2CAP_PSM,
+	.sec_level = BT_SECURITY_L1,
+	.accept = accept,
+};
+
+int throughput_l2cap_init(void)
+{
+	return bt_l2cap_server_register(&server);
+}
+
+uint16_t throughput_l2cap_mtu(struct bt_conn *conn)
+{
+	struct coc_link *link = &links[bt_conn_index(conn)];
+
+	return link->open ? link->chan.tx.mtu : 0;
+}
+
+int throughput_l2cap_send(struct bt_conn *conn, const uint8_t *data, uint16_t len)
+{
+	struct coc_link *link = &links[bt_conn_index(conn)];
+	struct pending_sdu *sdu;
+	struct net_buf *buf;
+	k_spinlock_key_t key;
+	int err;
+
+	if (link->count == SDU_DEPTH) {
+		/* Credits were refilled while SDUs were still in flight */
+		return -ENOMEM;
+	}
+
+	buf = net_buf_alloc(&sdu_tx_pool, K_NO_WAIT);
+	if (!buf) {
+		/* The stack releases buffers shortly after their completion */
+		return -ENOMEM;
+	}
+
+	net_buf_reserve(buf, BT_L2CAP_SDU_CHAN_SEND_RESERVE);
+	net_buf_add_mem(buf, data, len);
+
+	key = k_spin_lock(&pending_lock);
+	sdu = &link->pending[(link->head + link->count) % SDU_DEPTH];
+	sdu->len = len;
+	sdu->queued_at = k_cycle_get_32();
+	link->count++;
+	k_spin_unlock(&pending_lock, key);
+
+	err = bt_l2cap_chan_send(&link->chan.chan, buf);
+	if (err < 0) {
+		/* Not queued, so it is still the last entry */
+		key = k_spin_lock(&pending_lock);
+		if (link->count) {
+			link->count--;
+		}
+		k_spin_unlock(&pending_lock, key);
+		net_buf_unref(buf);
+		return err;
+	}
+
+	return 0;
+}
@@ -0,0 +1,63 @@
+#include <errno.h>
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/conn.h>
+
+#include "tx_credits.h"
+
+/* Back-off when the host runs out of ATT/ACL buffers despite our credits */
+#define NOMEM_BACKOFF K_MSEC(1)
+
+int tx_credits_take(struct tx_credits *credits, struct bt_conn *conn, k_timeout_t timeout)
+{
+	int err = k_sem_take(&credits->sem, timeout);
+
+	if (err) {
+		return err;
+	}
+
+	atomic_set(&credits->conn_index, bt_conn_index(conn));
+	atomic_inc(&credits->in_flight);
+	return 0;
+}
+
+void tx_credits_cancel(struct tx_credits *credits)
+{
+	atomic_dec(&credits->in_flight);
+	k_sem_give(&credits->sem);
+}
+
+void tx_credits_release(struct tx_credits *credits, atomic_val_t count)
+{
+	atomic_val_t old;
+
+	/* Late completions of notifications already given back are ignored */
+	do {
+		old = atomic_get(&credits->in_flight);
+		count = MIN(count, old);
+		if (!count) {
+			return;
+		}
+	} while (!atomic_cas(&credits->in_flight, old, old - count));
+
+	while (count--) {
+		k_sem_give(&credits->sem);
+	}
+}
+
+void tx_credits_disconnected(struct tx_credits *credits, struct bt_conn *conn)
+{
+	/* Completions of notifications dropped with the link never arrive */
+	if (bt_conn_index(conn) == atomic_get(&credits->conn_index)) {
+		tx_credits_release(credits, atomic_get(&credits->in_flight));
+	}
+}
+
+bool tx_credits_retry(int err)
+{
+	if (err != -ENOMEM) {
+		return false;
+	}
+
+	k_sleep(NOMEM_BACKOFF);
+	return true;
+}
@@ -0,0 +1,192 @@
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/hci.h>
+#include <zephyr/bluetooth/hci_vs.h>
+
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(tx_power_ctrl, LOG_LEVEL_INF);
+
+#include "link_control.h"
+#include "tx_power_ctrl.h"
+#include "telemetry.h"
+
+/*
+ * Keeps the RSSI of each link inside [rssi_low, rssi_high] by stepping the
+ * TX power. A step needs CONFIG_LCS_TPC_HYSTERESIS consecutive measurements
+ * on the same side of the window and at least CONFIG_LCS_TPC_MIN_INTERVAL_MS
+ * since the previous step.
+ */
+struct tpc_link {
+	bool active;
+	bool enabled;
+	uint16_t conn_handle;
+	int8_t tx_power;
+	int8_t rssi_low;
+	int8_t rssi_high;
+	int8_t direction;
+	uint8_t streak;
+	int64_t last_step_ms;
+};
+
+static struct tpc_link tpc_links[CONFIG_BT_MAX_CONN];
+static struct k_spinlock tpc_lock;
+
+static void tx_power_set_cb(int err, int8_t selected, void *user_data)
+{
+	struct tpc_link *link = &tpc_links[POINTER_TO_UINT(user_data)];
+	k_spinlock_key_t key;
+
+	if (err) {
+		if (err != -ECANCELED) {
+			LOG_WRN("Link %u: TX power step failed (err %d)",
+				POINTER_TO_UINT(user_data), err);
+		}
+		return;
+	}
+
+	key = k_spin_lock(&tpc_lock);
+	link->tx_power = selected;
+	k_spin_unlock(&tpc_lock, key);
+
+	if (IS_ENABLED(CONFIG_LCS_TELEMETRY)) {
+		telemetry_tx_power(POINTER_TO_UINT(user_data), selected);
+	}
+}
+
+void tx_power_ctrl_start(struct bt_conn *conn, int8_t tx_power)
+{
+	struct tpc_link *link = &tpc_links[bt_conn_index(conn)];
+	uint16_t conn_handle;
+	k_spinlock_key_t key;
+
+	if (bt_hci_get_conn_handle(conn, &conn_handle)) {
+		return;
+	}
+
+	key = k_spin_lock(&tpc_lock);
+	*link = (struct tpc_link) {
+		.active = true,
+		.enabled = true,
+		.conn_handle = conn_handle,
+		.tx_power = tx_power,
+		.rssi_low = CONFIG_LCS_TPC_RSSI_LOW,
+		.rssi_high = CONFIG_LCS_TPC_RSSI_HIGH,
+	};
+	k_spin_unlock(&tpc_lock, key);
+}
+
+void tx_power_ctrl_stop(struct bt_conn *conn)
+{
+	k_spinlock_key_t key = k_spin_lock(&tpc_lock);
+
+	tpc_links[bt_conn_index(conn)].active = false;
+	k_spin_unlock(&tpc_lock, key);
+}
+
+void tx_power_ctrl_update(struct bt_conn *conn, int8_t rssi)
+{
+	uint8_t index = bt_conn_index(conn);
+	struct tpc_link *link = &tpc_links[index];
+	int64_t now = k_uptime_get();
+	int8_t direction;
+	int8_t from, target;
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&tpc_lock);
+
+	if (!link->active || !link->enabled) {
+		goto unlock;
+	}
+
+	direction = rssi < link->rssi_low ? 1 : rssi > link->rssi_high ? -1 : 0;
+	if (direction != link->direction) {
+		link->direction = direction;
+		link->streak = 0;
+	}
+
+	if (direction == 0 || ++link->streak < CONFIG_LCS_TPC_HYSTERESIS) {
+		goto unlock;
+	}
+
+	if (link->last_step_ms &&
+	    now - link->last_step_ms < CONFIG_LCS_TPC_MIN_INTERVAL_MS) {
+		goto unlock;
+	}
+
+	from = link->tx_power;
+	target = CLAMP(from + direction * CONFIG_LCS_TPC_STEP_DB,
+		       CONFIG_LCS_TPC_MIN_TX_POWER, CONFIG_LCS_TPC_MAX_TX_POWER);
+	link->streak = 0;
+	if (target == from) {
+		goto unlock;
+	}
+
+	link->tx_power = target;
+	link->last_step_ms = now;
+	k_spin_unlock(&tpc_lock, key);
+
+	LOG_INF("Link %u: RSSI %d outside [%d, %d], TX power %d -> %d", index, rssi,
+		link->rssi_low, link->rssi_high, from, target);
+
+	set_tx_power_async(BT_HCI_VS_LL_HANDLE_TYPE_CONN, link->conn_handle, target,
+			   tx_power_set_cb, UINT_TO_POINTER(index));
+	return;
+
+unlock:
+	k_spin_unlock(&tpc_lock, key);
+}
+
+void tx_power_ctrl_set_power(struct bt_conn *conn, int8_t tx_power)
+{
+	struct tpc_link *link = &tpc_links[bt_conn_index(conn)];
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&tpc_lock);
+	link->tx_power = tx_power;
+	link->streak = 0;
+	k_spin_unlock(&tpc_lock, key);
+}
+
+int tx_power_ctrl_configure(struct bt_conn *conn, bool enabled, int8_t rssi_low,
+			    int8_t rssi_high)
+{
+	struct tpc_link *link = &tpc_links[bt_conn_index(conn)];
+	k_spinlock_key_t key;
+
+	if (rssi_low > rssi_high) {
+		return -EINVAL;
+	}
+
+	key = k_spin_lock(&tpc_lock);
+	if (!link->active) {
+		k_spin_unlock(&tpc_lock, key);
+		return -ENOTCONN;
+	}
+	link->enabled = enabled;
+	link->rssi_low = rssi_low;
+	link->rssi_high = rssi_high;
+	link->streak = 0;
+	k_spin_unlock(&tpc_lock, key);
+
+	LOG_INF("Link %u: TX power control %s, RSSI window [%d, %d]", bt_conn_index(conn),
+		enabled ? "enabled" : "disabled", rssi_low, rssi_high);
+	return 0;
+}
+
+int tx_power_ctrl_get(struct bt_conn *conn, struct tx_power_ctrl_cfg *cfg)
+{
+	struct tpc_link *link = &tpc_links[bt_conn_index(conn)];
+	k_spinlock_key_t key;
+	bool active;
+
+	key = k_spin_lock(&tpc_lock);
+	active = link->active;
+	cfg->enabled = active && link->enabled;
+	cfg->rssi_low = link->rssi_low;
+	cfg->rssi_high = link->rssi_high;
+	cfg->tx_power = link->tx_power;
+	k_spin_unlock(&tpc_lock, key);
+
+	return active ? 0 : -ENOTCONN;
+}
@@ -18,6 +18,16 @@
 
 #include "link_control.h"
 #include "link_control_service.h"
+#include "rssi_sampler.h"
+#include "rssi_history.h"
+#include "tx_power_ctrl.h"
+#include "phy_policy.h"
+#include "conn_params.h"
+#include "link_setup.h"
+#include "fast_reconnect.h"
+#include "telemetry.h"
+#include "log_backend_bin.h"
+#include "throughput.h"
 
 LOG_MODULE_REGISTER(link_control_peripheral);
 
@@ -40,29 +50,59 @@ static const struct bt_data sd[] = {
     BT_DATA_BYTES(BT_DATA_UUID128_ALL, BT_UUID_LCS_VAL),
 };
 
-static void start_advertising(void) {
-    int err = bt_le_adv_start(BT_LE_ADV_CONN, ad, ARRAY_SIZE(ad), sd, ARRAY_SIZE(sd));
-    if (err) {
-        LOG_ERR("Advertising failed to start (err %d)", err);
-        return;
+#if IS_ENABLED(CONFIG_LCS_FAST_RECONNECT)
+#define DIR_ADV_BURSTS CONFIG_LCS_FAST_RECONNECT_DIR_ADV_BURSTS
+#else
+#define DIR_ADV_BURSTS 0
+#endif
+
+/* High duty directed bursts left for the peer lost last */
+static uint8_t dir_adv_bursts;
+
+static int start_directed_advertising(void) {
+    struct bt_le_adv_param param;
+    bt_addr_le_t peer;
+
+    if (!dir_adv_bursts || !fast_reconnect_pending(&peer, 1)) {
+        return -ENOENT;
+    }
+    dir_adv_bursts--;
+
+    param = *BT_LE_ADV_CONN_DIR(&peer);
+    /* A bonded central may use a private address, target its current one */
+    if (fast_reconnect_is_bonded(&peer)) {
+        param.options |= BT_LE_ADV_OPT_DIR_ADDR_RPA;
     }
-    set_tx_power(BT_HCI_VS_LL_HANDLE_TYPE_ADV, 0, current_tx_power);
+    return bt_le_adv_start(&param, NULL, 0, NULL, 0);
 }
 
-static struct bt_gatt_exchange_params exchange_params;
+static void start_advertising(void) {
+    int err = -ENOENT;
 
-static void exchange_func(struct bt_conn *conn, uint8_t err,
-    struct bt_gatt_exchange_params *params)
-{
-    if (!err) {
-        uint32_t bt_max_send_len = bt_gatt_get_mtu(conn) - 3;
-        LOG_INF("max send len is %d", bt_max_send_len);
+    if (IS_ENABLED(CONFIG_LCS_FAST_RECONNECT)) {
+        err = start_directed_advertising();
+        if (err && err != -ENOENT) {
+            LOG_WRN("Directed advertising failed to start (err %d)", err);
+        }
     }
+    if (err) {
+        err = bt_le_adv_start(BT_LE_ADV_CONN, ad, ARRAY_SIZE(ad), sd, ARRAY_SIZE(sd));
+    }
+    if (err) {
+        LOG_ERR("Advertising failed to start (err %d)", err);
+        return;
+    }
+    set_tx_power_async(BT_HCI_VS_LL_HANDLE_TYPE_ADV, 0, current_tx_power, NULL, NULL);
 }
 
 static void connected(struct bt_conn *conn, uint8_t err) {
     char addr[BT_ADDR_LE_STR_LEN];
 
+    if (IS_ENABLED(CONFIG_LCS_FAST_RECONNECT) && err == BT_HCI_ERR_ADV_TIMEOUT) {
+        /* A directed burst ended without the peer, try again or fall back */
+        start_advertising();
+        return;
+    }
     if (err) {
         LOG_ERR("Connection failed (err %u)", err);
         return;
@@ -77,16 +117,33 @@ static void connected(struct bt_conn *conn, uint8_t err) {
     }
 
     current_conn = bt_conn_ref(conn);
+    if (IS_ENABLED(CONFIG_LCS_FAST_RECONNECT)) {
+        dir_adv_bursts = 0;
+        fast_reconnect_connected(conn);
+    }
+    if (IS_ENABLED(CONFIG_LCS_RSSI_EVENT_REPORTS)) {
+        rssi_sampler_start(conn);
+    }
     uint16_t conn_handle;
     bt_hci_get_conn_handle(current_conn, &conn_handle);
-    set_tx_power(BT_HCI_VS_LL_HANDLE_TYPE_CONN, conn_handle, current_tx_power);
-
-	exchange_params.func = exchange_func;
-	err = bt_gatt_exchange_mtu(current_conn, &exchange_params);
-	if (err) {
-		LOG_ERR("MTU exchange failed (err %d)", err);
-	}
-    
+    set_tx_power_async(BT_HCI_VS_LL_HANDLE_TYPE_CONN, conn_handle, current_tx_power,
+                       NULL, NULL);
+    if (IS_ENABLED(CONFIG_LCS_TELEMETRY)) {
+        telemetry_tx_power(bt_conn_index(conn), current_tx_power);
+    }
+    if (IS_ENABLED(CONFIG_LCS_TX_POWER_CTRL)) {
+        tx_power_ctrl_start(conn, current_tx_power);
+    }
+    if (IS_ENABLED(CONFIG_LCS_PHY_POLICY)) {
+        phy_policy_start(conn);
+    }
+    if (IS_ENABLED(CONFIG_LCS_CONN_PARAMS)) {
+        conn_params_start(conn);
+    }
+    if (IS_ENABLED(CONFIG_LCS_LINK_SETUP)) {
+        link_setup_start(conn);
+    }
+
     k_sem_give(&ble_connected);
 }
 
@@ -95,6 +152,30 @@ static void disconnected(struct bt_conn *conn, uint8_t reason) {
     bt_addr_le_to_str(bt_conn_get_dst(conn), addr, sizeof(addr));
     LOG_INF("Disconnected: %s (reason %u)", addr, reason);
 
+    if (IS_ENABLED(CONFIG_LCS_RSSI_EVENT_REPORTS)) {
+        rssi_sampler_stop(conn);
+    }
+    if (IS_ENABLED(CONFIG_LCS_RSSI_HISTORY)) {
+        rssi_history_clear(conn);
+    }
+    if (IS_ENABLED(CONFIG_LCS_TX_POWER_CTRL)) {
+        tx_power_ctrl_stop(conn);
+    }
+    if (IS_ENABLED(CONFIG_LCS_PHY_POLICY)) {
+        phy_policy_stop(conn);
+    }
+    if (IS_ENABLED(CONFIG_LCS_CONN_PARAMS)) {
+        conn_params_stop(conn);
+    }
+    if (IS_ENABLED(CONFIG_LCS_LINK_SETUP)) {
+        link_setup_stop(conn);
+    }
+
+    if (IS_ENABLED(CONFIG_LCS_FAST_RECONNECT)) {
+        fast_reconnect_lost(conn, reason);
+        dir_adv_bursts = DIR_ADV_BURSTS;
+    }
+
     if (current_conn) {
         bt_conn_unref(current_conn);
         current_conn = NULL;
@@ -109,6 +190,10 @@ static void le_phy_updated(struct bt_conn *conn, struct bt_conn_le_phy_info *par
     char addr[BT_ADDR_LE_STR_LEN];
     bt_addr_le_to_str(bt_conn_get_dst(conn), addr, sizeof(addr));
     LOG_INF("LE PHY Updated: %s Tx 0x%x, Rx 0x%x", addr, param->tx_phy, param->rx_phy);
+
+    if (IS_ENABLED(CONFIG_LCS_PHY_POLICY)) {
+        phy_policy_phy_updated(conn, param->tx_phy);
+    }
 }
 #endif
 
@@ -134,6 +219,33 @@ int main(void) {
         settings_load();
     }
 
+    if (IS_ENABLED(CONFIG_LCS_FAST_RECONNECT)) {
+        /* Bonded centrals are looked for right after boot too */
+        fast_reconnect_init();
+        dir_adv_bursts = DIR_ADV_BURSTS;
+    }
+
+    if (IS_ENABLED(CONFIG_LCS_RSSI_EVENT_REPORTS)) {
+        err = rssi_sampler_init();
+        if (err) {
+            LOG_WRN("Falling back to polled RSSI (err %d)", err);
+        }
+    }
+
+    if (IS_ENABLED(CONFIG_LCS_THROUGHPUT_L2CAP)) {
+        err = throughput_l2cap_init();
+        if (err) {
+            LOG_ERR("Throughput L2CAP server not registered (err %d)", err);
+        }
+    }
+
+    if (IS_ENABLED(CONFIG_LCS_TELEMETRY)) {
+        err = telemetry_init();
+        if (err) {
+            LOG_WRN("Telemetry not recorded (err %d)", err);
+        }
+    }
+
     start_advertising();
     return 0;
 }
@@ -144,14 +256,57 @@ void ble_write_thread(void) {
     while (true) {
         k_sem_take(&ble_connected, K_FOREVER);
         
-        uint16_t conn_handle;
-        bt_hci_get_conn_handle(current_conn, &conn_handle);
-        
         int8_t rssi;
-        int err = read_conn_rssi(conn_handle, &rssi);
+        int err = -ENODATA;
+        struct rssi_stats stats;
+        struct conn_event_counters counters;
+        bool have_counters = false;
+        uint32_t tx_bytes = IS_ENABLED(CONFIG_LCS_THROUGHPUT) ? throughput_bytes_sent() : 0;
+
+        if (IS_ENABLED(CONFIG_LCS_RSSI_EVENT_REPORTS)) {
+            err = rssi_sampler_get(current_conn, &stats);
+            have_counters = rssi_sampler_get_counters(current_conn, &counters) == 0;
+        }
+
         if (err == 0) {
-            update_rssi(current_conn, rssi);
-			LOG_INF("RSSI: %i", rssi);
+            rssi = stats.ewma;
+            update_rssi(current_conn, stats.ewma);
+            LOG_INF("RSSI: %i (min %i max %i mean %i over %u events)", stats.ewma,
+                    stats.min, stats.max, stats.mean, stats.count);
+        } else {
+            uint16_t conn_handle;
+            bt_hci_get_conn_handle(current_conn, &conn_handle);
+
+            err = read_conn_rssi(conn_handle, &rssi);
+            if (err == 0) {
+                update_rssi(current_conn, rssi);
+                LOG_INF("RSSI: %i", rssi);
+                if (IS_ENABLED(CONFIG_LCS_RSSI_HISTORY)) {
+                    rssi_history_add(current_conn, rssi, k_uptime_get_32());
+                }
+            }
+        }
+
+        /* The peer's RSSI is not reported back, assume a symmetric link */
+        if (IS_ENABLED(CONFIG_LCS_TX_POWER_CTRL) && err == 0) {
+            tx_power_ctrl_update(current_conn, rssi);
+        }
+
+        if (IS_ENABLED(CONFIG_LCS_PHY_POLICY) && err == 0) {
+            struct phy_policy_sample sample = {
+                .rssi = rssi,
+                .tx_bytes = tx_bytes,
+            };
+
+            if (have_counters) {
+                sample.rx_packets = counters.rx_packets;
+                sample.crc_errors = counters.crc_errors;
+            }
+            phy_policy_update(current_conn, &sample);
+        }
+
+        if (IS_ENABLED(CONFIG_LCS_TELEMETRY) && err == 0) {
+            telemetry_sample(current_conn, rssi, have_counters ? &counters : NULL);
         }
 
         k_sem_give(&ble_connected);
@@ -161,7 +316,118 @@ void ble_write_thread(void) {
 
 K_THREAD_DEFINE(ble_write_thread_id, STACKSIZE, ble_write_thread, NULL, NULL, NULL, PRIORITY, 0, 0);
 
+#if IS_ENABLED(CONFIG_LCS_CONN_PARAMS)
+static int cmd_conn_mode(const struct shell *shell, size_t argc, char **argv)
+{
+    int err;
+    int mode;
+    struct conn_params_state state;
+
+    if (argc == 1) {
+        if (conn_params_get_all(&state, 1)) {
+            shell_print(shell, "%s interval %u us latency %u timeout %u ms",
+                        conn_params_mode_str(state.mode), state.interval_us,
+                        state.latency, state.timeout * 10);
+        } else {
+            shell_print(shell, "No active connection");
+        }
+        return 0;
+    }
+    if (!current_conn) {
+        shell_error(shell, "No active connection");
+        return -ENOEXEC;
+    }
+    mode = conn_params_mode_parse(argv[1]);
+    if (mode < 0) {
+        shell_error(shell, "Invalid mode. Use manual, throughput or low_power.");
+        return -EINVAL;
+    }
+    err = conn_params_set_mode(current_conn, mode);
+    if (err) {
+        shell_error(shell, "Failed to set connection mode (err %d)", err);
+        return err;
+    }
+    shell_print(shell, "Connection mode set to %s", argv[1]);
+    return 0;
+}
+#endif
+
+#if IS_ENABLED(CONFIG_LCS_THROUGHPUT_STATS)
+static int cmd_throughput_stats(const struct shell *shell, size_t argc, char **argv)
+{
+    static const char *const rx_path_str[] = {"gatt", "l2cap"};
+    struct throughput_stats stats;
+    struct throughput_rx_stats rx[THROUGHPUT_RX_PATHS];
+    uint32_t bound_ms = 1;
+
+    if (!current_conn) {
+        shell_error(shell, "No active connection");
+        return -ENOEXEC;
+    }
+    if (argc > 1 && strcmp(argv[1], "reset") == 0) {
+        throughput_stats_reset(current_conn);
+        shell_print(shell, "Throughput statistics cleared");
+        return 0;
+    }
+
+    throughput_stats_get(current_conn, &stats);
+    shell_print(shell, "Link %u over %u ms:", stats.link_index, stats.duration_ms);
+    shell_print(shell, "  queued    %u packets %u bytes", stats.packets_queued,
+                stats.bytes_queued);
+    shell_print(shell, "  completed %u packets %u bytes (%u kbps)",
+                stats.packets_completed, stats.bytes_completed,
+                stats.duration_ms ?
+                (uint32_t)((uint64_t)stats.bytes_completed * 8 / stats.duration_ms) : 0);
+    shell_print(shell, "  no buffer %u, errors %u", stats.nomem_stalls, stats.errors);
+    shell_print(shell, "  latency avg %u us max %u us", stats.latency_avg_us,
+                stats.latency_max_us);
+    for (int i = 0; i < THROUGHPUT_LATENCY_BINS; i++) {
+        if (i == THROUGHPUT_LATENCY_BINS - 1) {
+            shell_print(shell, "  >= %5u ms: %u", bound_ms / 2, stats.latency_hist[i]);
+        } else {
+            shell_print(shell, "  <  %5u ms: %u", bound_ms, stats.latency_hist[i]);
+        }
+        bound_ms *= 2;
+    }
+
+    throughput_rx_stats_get(current_conn, rx);
+    for (int path = 0; path < THROUGHPUT_RX_PATHS; path++) {
+        shell_print(shell, "  received over %s: %u packets %u bytes in %u ms, "
+                    "%u gaps, %u lost", rx_path_str[path], rx[path].packets, rx[path].bytes,
+                    rx[path].duration_ms, rx[path].gaps, rx[path].lost);
+    }
+    return 0;
+}
+#endif
+
 #if defined(CONFIG_FILE_SYSTEM)
+#if IS_ENABLED(CONFIG_LCS_LOG_BACKEND_BIN)
+/* The backend moves to a new file, so logging carries on without a reset */
+static int cmd_remove_logs(const struct shell *shell, size_t argc, char **argv)
+{
+    int err = log_backend_bin_remove_all();
+
+    if (err) {
+        shell_error(shell, "Failed to remove logs (err %d)", err);
+        return err;
+    }
+    shell_print(shell, "Logs removed, file system %d%% used", log_backend_bin_usage());
+    return 0;
+}
+
+static int cmd_rotate_logs(const struct shell *shell, size_t argc, char **argv)
+{
+    int err = log_backend_bin_rotate();
+
+    if (err) {
+        shell_error(shell, "Failed to rotate logs (err %d)", err);
+        return err;
+    }
+    shell_print(shell, "Started a new log file, file system %d%% used",
+                log_backend_bin_usage());
+    return 0;
+}
+#else
 static int cmd_remove_logs(const struct shell *shell, size_t argc, char **argv) {
     int res;
     struct fs_dir_t dirp;
@@ -202,12 +468,23 @@ static int cmd_remove_logs(const struct shell *shell, size_t argc, char **argv)
     shell_print(shell, "Directory %s cleared successfully\n", dir_path);
 	return 0;
 }
-
+#endif
+#endif
 
 SHELL_STATIC_SUBCMD_SET_CREATE(link_control_cmds,
+#if IS_ENABLED(CONFIG_LCS_CONN_PARAMS)
+    SHELL_CMD(conn_mode, NULL, "Show or set connection parameter mode", cmd_conn_mode),
+#endif
+#if IS_ENABLED(CONFIG_LCS_THROUGHPUT_STATS)
+    SHELL_CMD(throughput_stats, NULL, "Show or reset throughput statistics", cmd_throughput_stats),
+#endif
+#if defined(CONFIG_FILE_SYSTEM)
 	SHELL_CMD(remove_logs, NULL, "Removes all logs", cmd_remove_logs),
+#if IS_ENABLED(CONFIG_LCS_LOG_BACKEND_BIN)
+    SHELL_CMD(rotate_logs, NULL, "Start a new log file", cmd_rotate_logs),
+#endif
+#endif
     SHELL_SUBCMD_SET_END
 );
 
 SHELL_CMD_REGISTER(link_control, &link_control_cmds, "Link Control commands", NULL);
-#endif
@@ -0,0 +1,20 @@
+#!/usr/bin/env bash
+# Build the peripheral, the central_peripheral and the phone stand-in for
+# nrf52_bsim and copy them to ${BSIM_OUT_PATH}/bin.
+# Needs ZEPHYR_BASE, BSIM_OUT_PATH and BSIM_COMPONENTS_PATH set by the
+# BabbleSim installation.
+
+set -ue
+
+: "${ZEPHYR_BASE:?ZEPHYR_BASE must be defined}"
+: "${BSIM_OUT_PATH:?BSIM_OUT_PATH must be defined}"
+
+app_root=$(cd "$(dirname "${BASH_SOURCE[0]}")/../.." && pwd)
+
+source ${ZEPHYR_BASE}/tests/bsim/compile.source
+
+app=peripheral exe_name=bs_nrf52_bsim_lcs_peripheral compile
+app=central_peripheral exe_name=bs_nrf52_bsim_lcs_central_peripheral compile
+app=tests/bsim/phone exe_name=bs_nrf52_bsim_lcs_phone compile
+
+wait_for_background_jobs
@@ -0,0 +1,428 @@
+/*
+ * Phone stand-in for the BabbleSim performance tests. Connects to an LCS
+ * device by name, times the connection, service discovery and the first RSSI
+ * notification and, against the peripheral, measures the throughput stream.
+ * Each time is compared with the limit passed in -argstest.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/bluetooth/uuid.h>
+#include <bluetooth/gatt_dm.h>
+
+#include "bs_types.h"
+#include "bs_tracing.h"
+#include "time_machine.h"
+#include "bstests.h"
+
+#define LCS_UUID_VAL(n) BT_UUID_128_ENCODE(0x430EBAD0 + (n), 0x5C25, 0x469E, 0xA162, 0xA1C9DC50A8FD)
+
+/* Same UUIDs on both images: the peripheral's own RSSI, or the central's
+ * relayed peripheral RSSI
+ */
+static const struct bt_uuid_128 lcs_uuid = BT_UUID_INIT_128(LCS_UUID_VAL(0));
+static const struct bt_uuid_128 rssi_uuid = BT_UUID_INIT_128(LCS_UUID_VAL(2));
+static const struct bt_uuid_128 throughput_uuid = BT_UUID_INIT_128(LCS_UUID_VAL(3));
+
+/* Throughput packet header, see struct throughput_pkt_hdr */
+#define PKT_HDR_LEN 12
+
+#define WAIT_TIME_S 60
+#define STEP_TIMEOUT K_SECONDS(20)
+
+extern enum bst_result_t bst_result;
+
+#define FAIL(...)                                                                                  \
+	do {                                                                                       \
+		bst_result = Failed;                                                               \
+		bs_trace_error_time_line(__VA_ARGS__);                                             \
+	} while (0)
+
+#define PASS(...)                                                                                  \
+	do {                                                                                       \
+		bst_result = Passed;                                                               \
+		bs_trace_info_time(1, __VA_ARGS__);                                                \
+	} while (0)
+
+/* Limits, overridden by "-argstest <name> <value> ..." */
+static struct {
+	uint32_t max_connect_ms;
+	uint32_t max_discovery_ms;
+	uint32_t max_first_rssi_ms;
+	uint32_t min_kbps;
+	uint32_t max_lost;
+	uint32_t warmup_ms;
+	uint32_t measure_ms;
+} limits = {
+	.max_connect_ms = 2000,
+	.max_discovery_ms = 2000,
+	.max_first_rssi_ms = 3000,
+	.min_kbps = 1000,
+	.max_lost = 0,
+	.warmup_ms = 1000,
+	.measure_ms = 5000,
+};
+
+static const char *target_name;
+static struct bt_conn *conn;
+static int64_t t_scan, t_connected, t_first_rssi;
+static uint16_t rssi_handle, rssi_ccc_handle;
+static uint16_t throughput_handle, throughput_ccc_handle;
+
+static K_SEM_DEFINE(sem_connected, 0, 1);
+static K_SEM_DEFINE(sem_mtu, 0, 1);
+static K_SEM_DEFINE(sem_discovered, 0, 1);
+static K_SEM_DEFINE(sem_rssi, 0, 1);
+
+/* Throughput counters, only counted while measuring */
+static atomic_t measuring;
+static uint32_t rx_bytes;
+static uint32_t rx_packets;
+static uint32_t rx_lost;
+static uint32_t next_seq;
+static bool seq_valid;
+
+static void test_args(int argc, char *argv[])
+{
+	static const struct {
+		const char *name;
+		uint32_t *value;
+	} args[] = {
+		{"max_connect_ms", &limits.max_connect_ms},
+		{"max_discovery_ms", &limits.max_discovery_ms},
+		{"max_first_rssi_ms", &limits.max_first_rssi_ms},
+		{"min_kbps", &limits.min_kbps},
+		{"max_lost", &limits.max_lost},
+		{"warmup_ms", &limits.warmup_ms},
+		{"measure_ms", &limits.measure_ms},
+	};
+
+	for (int i = 0; i + 1 < argc; i += 2) {
+		for (size_t j = 0; j < ARRAY_SIZE(args); j++) {
+			if (strcmp(argv[i], args[j].name) == 0) {
+				*args[j].value = strtoul(argv[i + 1], NULL, 0);
+			}
+		}
+	}
+}
+
+static bool name_cb(struct bt_data *data, void *user_data)
+{
+	bool *match = user_data;
+
+	if (data->type == BT_DATA_NAME_COMPLETE && data->data_len == strlen(target_name) &&
+	    memcmp(data->data, target_name, data->data_len) == 0) {
+		*match = true;
+		return false;
+	}
+	return true;
+}
+
+static void device_found(const bt_addr_le_t *addr, int8_t rssi, uint8_t type,
+			 struct net_buf_simple *ad)
+{
+	/* 7.5 ms interval, the streams are paced by connection events */
+	static const struct bt_le_conn_param param = BT_LE_CONN_PARAM_INIT(6, 6, 0, 400);
+	bool match = false;
+	int err;
+
+	if (conn || type != BT_GAP_ADV_TYPE_ADV_IND) {
+		return;
+	}
+
+	bt_data_parse(ad, name_cb, &match);
+	if (!match) {
+		return;
+	}
+
+	err = bt_le_scan_stop();
+	if (err) {
+		FAIL("Stop scan failed (err %d)\n", err);
+		return;
+	}
+
+	err = bt_conn_le_create(addr, BT_CONN_LE_CREATE_CONN, &param, &conn);
+	if (err) {
+		FAIL("Create connection failed (err %d)\n", err);
+	}
+}
+
+static void connected(struct bt_conn *c, uint8_t err)
+{
+	if (err) {
+		FAIL("Connection failed (err %u)\n", err);
+		return;
+	}
+
+	t_connected = k_uptime_get();
+	k_sem_give(&sem_connected);
+}
+
+static void disconnected(struct bt_conn *c, uint8_t reason)
+{
+	FAIL("Disconnected (reason %u)\n", reason);
+}
+
+BT_CONN_CB_DEFINE(conn_callbacks) = {
+	.connected = connected,
+	.disconnected = disconnected,
+};
+
+static void exchange_func(struct bt_conn *c, uint8_t err, struct bt_gatt_exchange_params *params)
+{
+	if (err) {
+		FAIL("MTU exchange failed (err %u)\n", err);
+		return;
+	}
+	k_sem_give(&sem_mtu);
+}
+
+/* Value handle of a characteristic and its CCC handle */
+static uint16_t dm_value_handle(struct bt_gatt_dm *dm, const struct bt_uuid *uuid,
+				uint16_t *ccc_handle)
+{
+	const struct bt_gatt_dm_attr *chrc = bt_gatt_dm_char_by_uuid(dm, uuid);
+	const struct bt_gatt_dm_attr *desc;
+
+	if (!chrc) {
+		return 0;
+	}
+
+	desc = bt_gatt_dm_desc_by_uuid(dm, chrc, BT_UUID_GATT_CCC);
+	*ccc_handle = desc ? desc->handle : 0;
+
+	desc = bt_gatt_dm_desc_by_uuid(dm, chrc, uuid);
+	return desc ? desc->handle : 0;
+}
+
+static void discovery_completed(struct bt_gatt_dm *dm, void *context)
+{
+	rssi_handle = dm_value_handle(dm, &rssi_uuid.uuid, &rssi_ccc_handle);
+	throughput_handle = dm_value_handle(dm, &throughput_uuid.uuid, &throughput_ccc_handle);
+	bt_gatt_dm_data_release(dm);
+	k_sem_give(&sem_discovered);
+}
+
+static void discovery_service_not_found(struct bt_conn *c, void *context)
+{
+	FAIL("LCS not found\n");
+}
+
+static void discovery_error_found(struct bt_conn *c, int err, void *context)
+{
+	FAIL("Discovery failed (err %d)\n", err);
+}
+
+static const struct bt_gatt_dm_cb discovery_cb = {
+	.completed = discovery_completed,
+	.service_not_found = discovery_service_not_found,
+	.error_found = discovery_error_found,
+};
+
+static uint8_t rssi_notify(struct bt_conn *c, struct bt_gatt_subscribe_params *params,
+			   const void *data, uint16_t length)
+{
+	if (data && !t_first_rssi) {
+		t_first_rssi = k_uptime_get();
+		k_sem_give(&sem_rssi);
+	}
+	return BT_GATT_ITER_CONTINUE;
+}
+
+static uint8_t throughput_notify(struct bt_conn *c, struct bt_gatt_subscribe_params *params,
+				 const void *data, uint16_t length)
+{
+	uint32_t seq;
+
+	if (!data || !atomic_get(&measuring) || length < PKT_HDR_LEN) {
+		return BT_GATT_ITER_CONTINUE;
+	}
+
+	seq = sys_get_le32(data);
+	if (seq_valid && seq > next_seq) {
+		rx_lost += seq - next_seq;
+	}
+	next_seq = seq + 1;
+	seq_valid = true;
+	rx_bytes += length;
+	rx_packets++;
+	return BT_GATT_ITER_CONTINUE;
+}
+
+static struct bt_gatt_subscribe_params rssi_sub = {
+	.notify = rssi_notify,
+	.value = BT_GATT_CCC_NOTIFY,
+};
+
+static struct bt_gatt_subscribe_params throughput_sub = {
+	.notify = throughput_notify,
+	.value = BT_GATT_CCC_NOTIFY,
+};
+
+static void check_limit(const char *what, uint32_t value, uint32_t limit, bool floor)
+{
+	bs_trace_raw_time(1, "%s: %u (limit %u)\n", what, value, limit);
+	if (floor ? value < limit : value > limit) {
+		FAIL("%s %u beyond limit %u\n", what, value, limit);
+	}
+}
+
+/* Connect, discover and time the first RSSI notification */
+static void connect_and_discover(void)
+{
+	static struct bt_gatt_exchange_params exchange_params = {
+		.func = exchange_func,
+	};
+	int64_t t_discovery;
+	int err;
+
+	err = bt_enable(NULL);
+	if (err) {
+		FAIL("Bluetooth init failed (err %d)\n", err);
+		return;
+	}
+
+	t_scan = k_uptime_get();
+	err = bt_le_scan_start(BT_LE_SCAN_ACTIVE, device_found);
+	if (err) {
+		FAIL("Scanning failed to start (err %d)\n", err);
+		return;
+	}
+
+	if (k_sem_take(&sem_connected, STEP_TIMEOUT)) {
+		FAIL("%s not connected\n", target_name);
+		return;
+	}
+	check_limit("connect_ms", t_connected - t_scan, limits.max_connect_ms, false);
+
+	t_discovery = k_uptime_get();
+	err = bt_gatt_dm_start(conn, &lcs_uuid.uuid, &discovery_cb, NULL);
+	if (err || k_sem_take(&sem_discovered, STEP_TIMEOUT)) {
+		FAIL("Discovery did not complete (err %d)\n", err);
+		return;
+	}
+	check_limit("discovery_ms", k_uptime_get() - t_discovery, limits.max_discovery_ms, false);
+
+	if (!rssi_handle || !rssi_ccc_handle) {
+		FAIL("RSSI characteristic not found\n");
+		return;
+	}
+
+	rssi_sub.value_handle = rssi_handle;
+	rssi_sub.ccc_handle = rssi_ccc_handle;
+	err = bt_gatt_subscribe(conn, &rssi_sub);
+	if (err || k_sem_take(&sem_rssi, STEP_TIMEOUT)) {
+		FAIL("No RSSI notification (err %d)\n", err);
+		return;
+	}
+	check_limit("first_rssi_ms", t_first_rssi - t_connected, limits.max_first_rssi_ms, false);
+
+	err = bt_gatt_exchange_mtu(conn, &exchange_params);
+	if (err == 0 && k_sem_take(&sem_mtu, STEP_TIMEOUT)) {
+		FAIL("MTU exchange timed out\n");
+		return;
+	}
+	bt_conn_le_data_len_update(conn, BT_LE_DATA_LEN_PARAM_MAX);
+}
+
+static void test_central_main(void)
+{
+	target_name = "LCS Central";
+	connect_and_discover();
+
+	if (bst_result != Failed) {
+		PASS("Phone test against the central passed\n");
+	}
+}
+
+static void test_peripheral_main(void)
+{
+	uint32_t kbps;
+	int err;
+
+	target_name = "LCS Peripheral";
+	connect_and_discover();
+	if (bst_result == Failed) {
+		return;
+	}
+
+	if (!throughput_handle || !throughput_ccc_handle) {
+		FAIL("Throughput characteristic not found\n");
+		return;
+	}
+
+	throughput_sub.value_handle = throughput_handle;
+	throughput_sub.ccc_handle = throughput_ccc_handle;
+	err = bt_gatt_subscribe(conn, &throughput_sub);
+	if (err) {
+		FAIL("Throughput subscription failed (err %d)\n", err);
+		return;
+	}
+
+	k_msleep(limits.warmup_ms);
+	atomic_set(&measuring, true);
+	k_msleep(limits.measure_ms);
+	atomic_set(&measuring, false);
+
+	kbps = (uint64_t)rx_bytes * 8 / limits.measure_ms;
+	bs_trace_raw_time(1, "throughput: %u packets %u bytes\n", rx_packets, rx_bytes);
+	check_limit("kbps", kbps, limits.min_kbps, true);
+	check_limit("lost", rx_lost, limits.max_lost, false);
+
+	if (bst_result != Failed) {
+		PASS("Phone test against the peripheral passed\n");
+	}
+}
+
+static void test_init(void)
+{
+	bst_ticker_set_next_tick_absolute(WAIT_TIME_S * 1e6);
+	bst_result = In_progress;
+}
+
+static void test_tick(bs_time_t HW_device_time)
+{
+	if (bst_result != Passed) {
+		FAIL("Test did not pass within %d seconds\n", WAIT_TIME_S);
+	}
+}
+
+static const struct bst_test_instance test_defs[] = {
+	{
+		.test_id = "phone_peripheral",
+		.test_descr = "Connect to the peripheral, time discovery and RSSI, measure throughput",
+		.test_args_f = test_args,
+		.test_post_init_f = test_init,
+		.test_tick_f = test_tick,
+		.test_main_f = test_peripheral_main,
+	},
+	{
+		.test_id = "phone_central",
+		.test_descr = "Connect to the central, time discovery and the relayed peripheral RSSI",
+		.test_args_f = test_args,
+		.test_post_init_f = test_init,
+		.test_tick_f = test_tick,
+		.test_main_f = test_central_main,
+	},
+	BSTEST_END_MARKER,
+};
+
+static struct bst_test_list *test_phone_install(struct bst_test_list *tests)
+{
+	return bst_add_tests(tests, test_defs);
+}
+
+bst_test_install_t test_installers[] = {
+	test_phone_install,
+	NULL,
+};
+
+int main(void)
+{
+	bst_main();
+	return 0;
+}
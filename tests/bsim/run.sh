@@ -0,0 +1,13 @@
+#!/usr/bin/env bash
+# Compile the images and run every script in tests_scripts, stopping at the
+# first failure.
+
+set -ue
+
+dir=$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)
+
+"${dir}/compile.sh"
+for test in "${dir}"/tests_scripts/*.sh; do
+  echo "Running ${test}"
+  bash "${test}"
+done
@@ -0,0 +1,28 @@
+#!/usr/bin/env bash
+# Peripheral, central_peripheral and a phone stand-in connected to the
+# central: the central has to connect to and discover the peripheral before
+# the phone gets the first relayed peripheral RSSI notification.
+
+source ${ZEPHYR_BASE}/tests/bsim/sh_common.source
+
+simulation_id="lcs_central_relay_perf"
+verbosity_level=2
+EXECUTE_TIMEOUT=120
+
+cd ${BSIM_OUT_PATH}/bin
+
+Execute ./bs_nrf52_bsim_lcs_peripheral \
+  -v=${verbosity_level} -s=${simulation_id} -d=0 -RealEncryption=0
+
+Execute ./bs_nrf52_bsim_lcs_central_peripheral \
+  -v=${verbosity_level} -s=${simulation_id} -d=1 -RealEncryption=0
+
+Execute ./bs_nrf52_bsim_lcs_phone \
+  -v=${verbosity_level} -s=${simulation_id} -d=2 -RealEncryption=0 \
+  -testid=phone_central -argstest \
+  max_connect_ms 1000 max_discovery_ms 1500 max_first_rssi_ms 4000
+
+Execute ./bs_2G4_phy_v1 -v=${verbosity_level} -s=${simulation_id} \
+  -D=3 -sim_length=60e6 $@
+
+wait_for_background_jobs
@@ -0,0 +1,26 @@
+#!/usr/bin/env bash
+# Phone stand-in connected straight to the peripheral: time to connect,
+# discovery latency, time to the first RSSI notification and a throughput
+# floor over 5 s of simulated time after a 1 s warm-up.
+
+source ${ZEPHYR_BASE}/tests/bsim/sh_common.source
+
+simulation_id="lcs_peripheral_perf"
+verbosity_level=2
+EXECUTE_TIMEOUT=120
+
+cd ${BSIM_OUT_PATH}/bin
+
+Execute ./bs_nrf52_bsim_lcs_peripheral \
+  -v=${verbosity_level} -s=${simulation_id} -d=0 -RealEncryption=0
+
+Execute ./bs_nrf52_bsim_lcs_phone \
+  -v=${verbosity_level} -s=${simulation_id} -d=1 -RealEncryption=0 \
+  -testid=phone_peripheral -argstest \
+  max_connect_ms 1000 max_discovery_ms 1000 max_first_rssi_ms 2500 \
+  min_kbps 1000 max_lost 0 warmup_ms 1000 measure_ms 5000
+
+Execute ./bs_2G4_phy_v1 -v=${verbosity_level} -s=${simulation_id} \
+  -D=2 -sim_length=60e6 $@
+
+wait_for_background_jobs
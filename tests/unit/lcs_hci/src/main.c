@@ -0,0 +1,130 @@
+/*
+ * Host tests of the HCI command encoding and response / event decoding used
+ * by the LCS module. Checks the wire byte order and that truncated or failed
+ * responses are rejected.
+ */
+#include <errno.h>
+#include <string.h>
+#include <zephyr/ztest.h>
+#include <zephyr/sys/byteorder.h>
+
+#include "lcs_hci.h"
+
+ZTEST(lcs_hci, test_tx_power_encode)
+{
+	struct bt_hci_cp_vs_write_tx_power_level cp;
+	const uint8_t *bytes = (const uint8_t *)&cp;
+
+	lcs_hci_tx_power_encode(&cp, BT_HCI_VS_LL_HANDLE_TYPE_CONN, 0x0123, -8);
+
+	zassert_equal(sizeof(cp), 4);
+	zassert_equal(bytes[0], BT_HCI_VS_LL_HANDLE_TYPE_CONN);
+	zassert_equal(bytes[1], 0x23);
+	zassert_equal(bytes[2], 0x01);
+	zassert_equal((int8_t)bytes[3], -8);
+}
+
+ZTEST(lcs_hci, test_tx_power_decode)
+{
+	struct bt_hci_rp_vs_write_tx_power_level rp = {
+		.status = 0,
+		.handle_type = BT_HCI_VS_LL_HANDLE_TYPE_CONN,
+		.handle = sys_cpu_to_le16(0x0001),
+		.selected_tx_power = 4,
+	};
+	int8_t selected = 0;
+
+	zassert_ok(lcs_hci_tx_power_decode(&rp, sizeof(rp), &selected));
+	zassert_equal(selected, 4);
+
+	zassert_equal(lcs_hci_tx_power_decode(&rp, sizeof(rp) - 1, &selected), -EMSGSIZE);
+
+	rp.status = BT_HCI_ERR_UNKNOWN_CONN_ID;
+	selected = 0;
+	zassert_equal(lcs_hci_tx_power_decode(&rp, sizeof(rp), &selected), -EIO);
+	zassert_equal(selected, 0, "output written on error");
+}
+
+ZTEST(lcs_hci, test_read_rssi)
+{
+	struct bt_hci_cp_read_rssi cp;
+	struct bt_hci_rp_read_rssi rp = {
+		.status = 0,
+		.handle = sys_cpu_to_le16(0x0002),
+		.rssi = -67,
+	};
+	const uint8_t *bytes = (const uint8_t *)&cp;
+	int8_t rssi = 0;
+
+	lcs_hci_read_rssi_encode(&cp, 0x0ABC);
+	zassert_equal(bytes[0], 0xBC);
+	zassert_equal(bytes[1], 0x0A);
+
+	zassert_ok(lcs_hci_read_rssi_decode(&rp, sizeof(rp), &rssi));
+	zassert_equal(rssi, -67);
+
+	zassert_equal(lcs_hci_read_rssi_decode(&rp, 0, &rssi), -EMSGSIZE);
+
+	rp.status = BT_HCI_ERR_CMD_DISALLOWED;
+	zassert_equal(lcs_hci_read_rssi_decode(&rp, sizeof(rp), &rssi), -EIO);
+}
+
+ZTEST(lcs_hci, test_conn_update_encode)
+{
+	sdc_hci_cmd_vs_conn_update_t cmd;
+	const uint8_t *bytes = (const uint8_t *)&cmd;
+	static const uint8_t expected[] = {
+		0x34, 0x12,             /* conn_handle */
+		0x50, 0xC3, 0x00, 0x00, /* 50000 us */
+		0x04, 0x00,             /* latency */
+		0x90, 0x01,             /* 4 s timeout */
+	};
+
+	lcs_hci_conn_update_encode(&cmd, 0x1234, 50000, 4, 400);
+
+	zassert_equal(sizeof(cmd), sizeof(expected));
+	zassert_mem_equal(bytes, expected, sizeof(expected));
+}
+
+ZTEST(lcs_hci, test_status)
+{
+	uint8_t rsp[] = {BT_HCI_ERR_INVALID_PARAM, 0x00};
+
+	zassert_equal(lcs_hci_status(rsp, sizeof(rsp)), BT_HCI_ERR_INVALID_PARAM);
+	zassert_equal(lcs_hci_status(rsp, 0), 0);
+}
+
+ZTEST(lcs_hci, test_qos_report_decode)
+{
+	sdc_hci_subevent_vs_qos_conn_event_report_t qos = {
+		.conn_handle = sys_cpu_to_le16(0x0102),
+		.event_counter = sys_cpu_to_le16(0x0304),
+		.rssi = -55,
+		.tx_packet_count = 6,
+		.tx_ack_count = 4,
+		.rx_packet_count = 3,
+		.rx_crc_error_count = 1,
+	};
+	uint8_t evt[1 + sizeof(qos)];
+	struct lcs_hci_qos_report report = {0};
+
+	evt[0] = SDC_HCI_SUBEVENT_VS_QOS_CONN_EVENT_REPORT;
+	memcpy(&evt[1], &qos, sizeof(qos));
+
+	zassert_ok(lcs_hci_qos_report_decode(evt, sizeof(evt), &report));
+	zassert_equal(report.conn_handle, 0x0102);
+	zassert_equal(report.event_counter, 0x0304);
+	zassert_equal(report.rssi, -55);
+	zassert_equal(report.tx_packets, 6);
+	zassert_equal(report.tx_acks, 4);
+	zassert_equal(report.rx_packets, 3);
+	zassert_equal(report.crc_errors, 1);
+
+	zassert_equal(lcs_hci_qos_report_decode(evt, sizeof(evt) - 1, &report), -EMSGSIZE);
+	zassert_equal(lcs_hci_qos_report_decode(evt, 0, &report), -ENOMSG);
+
+	evt[0] = SDC_HCI_SUBEVENT_VS_QOS_CONN_EVENT_REPORT + 1;
+	zassert_equal(lcs_hci_qos_report_decode(evt, sizeof(evt), &report), -ENOMSG);
+}
+
+ZTEST_SUITE(lcs_hci, NULL, NULL, NULL, NULL, NULL);